@@ -0,0 +1,142 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// 基准测试公共部分：分批计时、分位数、文本与 JSON 输出
+// 每个基准程序把结果放进 bench_report，-j 指定时写成 JSON，便于不同提交之间对比：
+//   {"suite": "http", "rev": "a1b2c3d", "time": "...", "cpus": 8,
+//    "results": [{"name": "...", "ops": N, "ns_per_op": x, "p50_ns": x, "p99_ns": x, "ops_per_sec": x, ...}]}
+// rev 由 Makefile 以 -DBENCH_REV 传入（git rev-parse --short HEAD）
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifndef BENCH_REV
+#define BENCH_REV "unknown"
+#endif
+
+inline uint64_t bench_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// 防止被测结果被编译器优化掉
+template <typename T>
+inline void bench_keep(const T &value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+struct bench_result {
+    std::string name;
+    uint64_t ops = 0;
+    double ns_per_op = 0;
+    double p50_ns = -1;         // 分批计时时为各批平均值的分位数，未分批为 -1
+    double p99_ns = -1;
+    std::vector<std::pair<std::string, double>> extra;  // 各基准自己的附加字段
+
+    void add(const char *key, double value) { extra.push_back(std::make_pair(std::string(key), value)); }
+};
+
+// 分批计时：每批 batch 次调用计一次时，单次调用只有几十纳秒时计时开销也能忽略
+// fn(i) 为第 i 次调用；结果的 p50/p99 是各批平均耗时的分位数
+template <typename Fn>
+bench_result bench_run(const std::string &name, uint64_t iterations, uint64_t batch, Fn fn) {
+    if (batch == 0)
+        batch = 1;
+    std::vector<double> samples;
+    samples.reserve(iterations / batch + 1);
+    uint64_t done = 0;
+    uint64_t start = bench_now_ns();
+    while (done < iterations) {
+        uint64_t n = iterations - done < batch ? iterations - done : batch;
+        uint64_t t0 = bench_now_ns();
+        for (uint64_t i = 0; i < n; i++)
+            fn(done + i);
+        samples.push_back((double)(bench_now_ns() - t0) / n);
+        done += n;
+    }
+    uint64_t total = bench_now_ns() - start;
+
+    bench_result r;
+    r.name = name;
+    r.ops = iterations;
+    r.ns_per_op = iterations ? (double)total / iterations : 0;
+    if (!samples.empty()) {
+        std::sort(samples.begin(), samples.end());
+        r.p50_ns = samples[samples.size() / 2];
+        r.p99_ns = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+    }
+    return r;
+}
+
+class bench_report {
+public:
+    explicit bench_report(const char *suite) : m_suite(suite) {}
+
+    void add(const bench_result &r) {
+        m_results.push_back(r);
+        print(r);
+    }
+
+    // 附加说明（如依赖的服务不可用而跳过），写进 JSON 的 note 字段
+    void set_note(const std::string &note) {
+        m_note = note;
+        fprintf(stderr, "%s: %s\n", m_suite.c_str(), note.c_str());
+    }
+
+    // 逐条打印，长时间运行的基准可以边跑边看
+    static void print(const bench_result &r) {
+        printf("%-40s %12llu ops %12.1f ns/op", r.name.c_str(), (unsigned long long)r.ops, r.ns_per_op);
+        if (r.p50_ns >= 0)
+            printf("  p50 %.1f  p99 %.1f", r.p50_ns, r.p99_ns);
+        for (const auto &kv : r.extra)
+            printf("  %s %.6g", kv.first.c_str(), kv.second);
+        printf("\n");
+        fflush(stdout);
+    }
+
+    bool write_json(const char *path) const {
+        FILE *fp = fopen(path, "w");
+        if (!fp) {
+            perror(path);
+            return false;
+        }
+        char stamp[32];
+        time_t now = time(nullptr);
+        struct tm tm;
+        gmtime_r(&now, &tm);
+        strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", &tm);
+        fprintf(fp, "{\n  \"suite\": \"%s\",\n  \"rev\": \"%s\",\n  \"time\": \"%s\",\n  \"cpus\": %ld,\n",
+                m_suite.c_str(), BENCH_REV, stamp, sysconf(_SC_NPROCESSORS_ONLN));
+        if (!m_note.empty())
+            fprintf(fp, "  \"note\": \"%s\",\n", m_note.c_str());
+        fprintf(fp, "  \"results\": [");
+        for (size_t i = 0; i < m_results.size(); i++) {
+            const bench_result &r = m_results[i];
+            fprintf(fp, "%s\n    {\"name\": \"%s\", \"ops\": %llu, \"ns_per_op\": %.2f, \"ops_per_sec\": %.1f",
+                    i ? "," : "", r.name.c_str(), (unsigned long long)r.ops, r.ns_per_op,
+                    r.ns_per_op > 0 ? 1e9 / r.ns_per_op : 0.0);
+            if (r.p50_ns >= 0)
+                fprintf(fp, ", \"p50_ns\": %.2f, \"p99_ns\": %.2f", r.p50_ns, r.p99_ns);
+            for (const auto &kv : r.extra)
+                fprintf(fp, ", \"%s\": %.6g", kv.first.c_str(), kv.second);
+            fprintf(fp, "}");
+        }
+        fprintf(fp, "\n  ]\n}\n");
+        fclose(fp);
+        return true;
+    }
+
+private:
+    std::string m_suite;
+    std::string m_note;
+    std::vector<bench_result> m_results;
+};
+
+#endif
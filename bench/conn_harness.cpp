@@ -0,0 +1,453 @@
+// 连接测试台：不开端口、不连数据库，用 socketpair 把脚本化的字节流喂给 http_conn，
+// 统计每个请求的 CPU 耗时和系统调用次数
+//   -m reactor  起一个真实的 SubReactor 线程，服务端 fd 经 add_connection 交给它（默认）
+//   -m bare     本线程直接驱动一个 http_conn，按 SubReactor 的顺序调用 read_once / process / write
+// 用户表用 MemoryUserStore，资源目录用 -r 指定（默认 ./root），可在任意目录、任意机器上运行
+//
+// 场景（客户端发送方式）：
+//   keepalive     长连接逐个发送 GET
+//   fragmented    每个请求切成 8 字节的小块，块间隔 200us
+//   pipelined     8 个请求一次写入，期望 8 个响应
+//   post_split    登录 POST 的头部和请求体分两次写
+//   short         Connection: close，每个请求一个新连接
+//   oversized     请求头超过读缓冲区（8KB），期望服务器关闭连接
+//   slow          每 1ms 发送 1 个字节（慢速客户端）
+// 用法：./bench/conn_harness [-m reactor|bare] [-n 重复次数] [-s 场景,...] [-r 资源目录] [-j result.json]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "syscall_count.h"
+#include "../subreactor.h"
+#include "../userstore/memory_user_store.h"
+
+static const int RESPONSE_TIMEOUT_MS = 2000;
+
+static uint64_t cpu_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// ========== 场景 ==========
+
+struct script_step {
+    std::string data;
+    size_t chunk;           // 每次写入的字节数，0 为一次写完
+    int delay_us;           // 块之间（以及本步之后）的间隔
+    int expect;             // 本步之后应收到的响应数
+};
+
+struct scenario {
+    const char *name;
+    std::vector<script_step> steps;
+    bool new_connection;    // 每次重复都用新连接（短连接、期望被关闭）
+    bool expect_close;      // 最后应由服务器关闭连接
+    int repeat_div;         // 重复次数 = -n / repeat_div
+};
+
+static const char *const GET_KEEPALIVE = "GET /judge.html HTTP/1.1\r\nHost: harness\r\nConnection: keep-alive\r\n\r\n";
+static const char *const GET_CLOSE = "GET /judge.html HTTP/1.1\r\nHost: harness\r\nConnection: close\r\n\r\n";
+
+static std::vector<scenario> build_scenarios() {
+    std::vector<scenario> list;
+    list.push_back({"keepalive", {{GET_KEEPALIVE, 0, 0, 1}}, false, false, 1});
+    list.push_back({"fragmented", {{GET_KEEPALIVE, 8, 200, 1}}, false, false, 10});
+
+    std::string pipelined;
+    for (int i = 0; i < 8; i++)
+        pipelined += GET_KEEPALIVE;
+    list.push_back({"pipelined", {{pipelined, 0, 0, 8}}, false, false, 8});
+
+    std::string body = "user=test&password=test";
+    std::string post = "POST /2CGISQL.cgi HTTP/1.1\r\nHost: harness\r\nConnection: keep-alive\r\n"
+                       "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: " +
+                       std::to_string(body.size()) + "\r\n\r\n";
+    list.push_back({"post_split", {{post, 0, 200, 0}, {body, 0, 0, 1}}, false, false, 1});
+
+    list.push_back({"short", {{GET_CLOSE, 0, 0, 1}}, true, true, 10});
+
+    std::string oversized = "GET /judge.html HTTP/1.1\r\nHost: harness\r\nX-Padding: " + std::string(10000, 'a') +
+                            "\r\n\r\n";
+    list.push_back({"oversized", {{oversized, 0, 0, 0}}, true, true, 20});
+
+    list.push_back({"slow", {{GET_KEEPALIVE, 1, 1000, 1}}, false, false, 100});
+    return list;
+}
+
+// ========== 客户端：按 Content-Length 切分响应 ==========
+
+struct response_reader {
+    std::string buf;
+    int responses = 0;
+    int ok = 0;             // 2xx
+    bool closed = false;
+
+    // 解析缓冲区中完整的响应
+    void parse() {
+        while (true) {
+            size_t end = buf.find("\r\n\r\n");
+            if (end == std::string::npos)
+                return;
+            long length = 0;
+            size_t pos = buf.find("Content-Length:");
+            if (pos != std::string::npos && pos < end)
+                length = strtol(buf.c_str() + pos + 15, nullptr, 10);
+            if (buf.size() < end + 4 + length)
+                return;
+            int status = buf.size() > 12 ? atoi(buf.c_str() + 9) : 0;
+            if (status / 100 == 2)
+                ok++;
+            responses++;
+            buf.erase(0, end + 4 + length);
+        }
+    }
+
+    // 非阻塞地读出当前可读的数据
+    void drain(int fd) {
+        syscall_client_scope client;
+        char tmp[65536];
+        while (true) {
+            ssize_t n = recv(fd, tmp, sizeof(tmp), MSG_DONTWAIT);
+            if (n > 0) {
+                buf.append(tmp, n);
+                continue;
+            }
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR))
+                closed = true;
+            break;
+        }
+        parse();
+    }
+};
+
+// ========== 服务端驱动 ==========
+
+class server_driver {
+public:
+    virtual ~server_driver() {}
+    // 接管服务端 fd
+    virtual void attach(int fd) = 0;
+    // bare 模式下推进服务端；reactor 模式由 SubReactor 线程自己处理
+    virtual void pump() {}
+    // 等待客户端 fd 可读或服务端推进，返回是否还有希望等到数据
+    virtual bool wait(int client_fd, int timeout_ms) = 0;
+    // 服务端 CPU 时间（纳秒，累计）
+    virtual uint64_t server_cpu_ns() = 0;
+};
+
+// 真实的 SubReactor：服务端 CPU = 进程 CPU - 本（客户端）线程 CPU
+class reactor_driver : public server_driver {
+public:
+    reactor_driver(const char *root, UserStore *store)
+        : m_reactor(0, root, 0, 1, "", "", "", nullptr, 0, false, store, conn_deadlines{5000, 5000, 5000, 15000}, 0,
+                    0) {
+        m_reactor.start();
+    }
+    ~reactor_driver() { m_reactor.stop(); }
+
+    void attach(int fd) override {
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        m_reactor.add_connection(fd, addr);
+    }
+
+    bool wait(int client_fd, int timeout_ms) override {
+        syscall_client_scope client;
+        struct pollfd pfd = {client_fd, POLLIN, 0};
+        return poll(&pfd, 1, timeout_ms) > 0;
+    }
+
+    uint64_t server_cpu_ns() override {
+        return cpu_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu_ns(CLOCK_THREAD_CPUTIME_ID);
+    }
+
+private:
+    SubReactor m_reactor;
+};
+
+// 直接驱动 http_conn，调用顺序与 SubReactor::dealwithread / dealwithwrite 相同；服务端耗时只计这几个调用
+class bare_driver : public server_driver {
+public:
+    bare_driver(char *root, UserStore *store) : m_root(root), m_store(store), m_fd(-1), m_writing(false),
+                                                      m_server_ns(0) {
+        m_epollfd = epoll_create1(EPOLL_CLOEXEC);
+        LoopClock::set_current(&m_clock);
+    }
+    ~bare_driver() {
+        close_conn();
+        ::close(m_epollfd);
+    }
+
+    void attach(int fd) override {
+        close_conn();
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        m_fd = fd;
+        m_writing = false;
+        m_conn.init(fd, addr, m_root, 0, 1, "", "", "", m_epollfd, m_store, nullptr);
+    }
+
+    void pump() override {
+        while (m_fd >= 0) {
+            if (m_writing) {
+                uint64_t t0 = bench_now_ns();
+                int ret = m_conn.write();
+                m_server_ns += bench_now_ns() - t0;
+                if (ret == 0)
+                    return;         // 客户端读走后再继续
+                m_writing = false;
+                if (ret < 0 || m_conn.m_peer_closed || !m_conn.is_reset_for_next())
+                    close_conn();
+                continue;
+            }
+            if (!readable())
+                return;
+            uint64_t t0 = bench_now_ns();
+            int flag = m_conn.read_once();
+            http_conn::PROCESS_RESULT result = flag >= 0 ? m_conn.process() : http_conn::PROCESS_ERROR;
+            m_server_ns += bench_now_ns() - t0;
+            if (result == http_conn::PROCESS_ERROR || (flag == 0 && result == http_conn::PROCESS_CONTINUE)) {
+                close_conn();
+                return;
+            }
+            if (flag == 0)
+                m_conn.m_peer_closed = true;
+            if (result == http_conn::PROCESS_OK)
+                m_writing = true;
+        }
+    }
+
+    bool wait(int client_fd, int timeout_ms) override {
+        pump();
+        syscall_client_scope client;
+        struct pollfd pfd = {client_fd, POLLIN, 0};
+        if (poll(&pfd, 1, 0) > 0)
+            return true;
+        // 服务端无事可做且客户端没有数据：在 bare 模式下不会再有进展
+        (void)timeout_ms;
+        return false;
+    }
+
+    uint64_t server_cpu_ns() override { return m_server_ns; }
+
+private:
+    bool readable() {
+        syscall_client_scope client;
+        struct pollfd pfd = {m_fd, POLLIN, 0};
+        return poll(&pfd, 1, 0) > 0;
+    }
+
+    void close_conn() {
+        if (m_fd < 0)
+            return;
+        epoll_ctl(m_epollfd, EPOLL_CTL_DEL, m_fd, nullptr);
+        ::close(m_fd);
+        m_fd = -1;
+        m_writing = false;
+    }
+
+    char *m_root;
+    UserStore *m_store;
+    LoopClock m_clock;
+    http_conn m_conn;
+    int m_epollfd;
+    int m_fd;
+    bool m_writing;
+    uint64_t m_server_ns;
+};
+
+// ========== 运行 ==========
+
+struct run_stats {
+    uint64_t expected = 0;
+    uint64_t responses = 0;
+    uint64_t ok = 0;
+    uint64_t closes = 0;        // 服务器关闭连接的次数
+    bool stalled = false;       // 某一轮在超时内没收齐响应，后面的重复不再进行
+};
+
+static int open_connection(server_driver &server) {
+    int fds[2];
+    syscall_client_scope client;
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0) {
+        perror("socketpair");
+        exit(1);
+    }
+    // 与主 Reactor 的 accept4(SOCK_NONBLOCK) 一样，交给服务端的 fd 已是非阻塞
+    Utils::setnonblocking(fds[1]);
+    server.attach(fds[1]);
+    return fds[0];
+}
+
+static void send_step(server_driver &server, int fd, const script_step &step) {
+    size_t chunk = step.chunk ? step.chunk : step.data.size();
+    for (size_t off = 0; off < step.data.size(); off += chunk) {
+        size_t n = std::min(chunk, step.data.size() - off);
+        {
+            syscall_client_scope client;
+            if (send(fd, step.data.data() + off, n, MSG_NOSIGNAL) != (ssize_t)n)
+                return;     // 服务器已关闭
+        }
+        server.pump();
+        if (step.delay_us > 0)
+            usleep(step.delay_us);
+    }
+}
+
+// 读到期望数量的响应、连接被关闭或超时为止
+static void collect(server_driver &server, int fd, response_reader &reader, int target, bool until_close) {
+    while (!reader.closed && (reader.responses < target || until_close)) {
+        if (!server.wait(fd, RESPONSE_TIMEOUT_MS)) {
+            reader.drain(fd);
+            break;
+        }
+        reader.drain(fd);
+    }
+}
+
+static void run_scenario(server_driver &server, const scenario &sc, int repeat, run_stats &stats) {
+    int fd = -1;
+    response_reader reader;
+    for (int r = 0; r < repeat; r++) {
+        if (fd < 0 || sc.new_connection) {
+            if (fd >= 0) {
+                syscall_client_scope client;
+                close(fd);
+            }
+            fd = open_connection(server);
+            reader = response_reader();
+        }
+        int before = reader.responses;
+        int ok_before = reader.ok;
+        int expect = 0;
+        for (const script_step &step : sc.steps) {
+            send_step(server, fd, step);
+            expect += step.expect;
+            collect(server, fd, reader, before + expect, false);
+        }
+        if (sc.expect_close)
+            collect(server, fd, reader, before + expect, true);
+        stats.expected += expect;
+        stats.responses += reader.responses - before;
+        stats.ok += reader.ok - ok_before;
+        if (reader.responses - before < expect && !reader.closed) {
+            stats.stalled = true;
+            break;
+        }
+        if (reader.closed) {
+            stats.closes++;
+            if (!sc.new_connection)
+                break;      // 长连接被意外关闭，后面的重复没有意义
+        }
+    }
+    if (fd >= 0) {
+        syscall_client_scope client;
+        close(fd);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    std::string mode = "reactor";
+    int iterations = 2000;
+    std::string only;
+    char root[256] = "./root";
+    const char *json = nullptr;
+    int opt;
+    while ((opt = getopt(argc, argv, "m:n:s:r:j:")) != -1) {
+        switch (opt) {
+            case 'm': mode = optarg; break;
+            case 'n': iterations = atoi(optarg); break;
+            case 's': only = "," + std::string(optarg) + ","; break;
+            case 'r': snprintf(root, sizeof(root), "%s", optarg); break;
+            case 'j': json = optarg; break;
+            default:
+                fprintf(stderr, "usage: %s [-m reactor|bare] [-n iterations] [-s scenario,...] [-r doc_root] "
+                                "[-j result.json]\n", argv[0]);
+                return 1;
+        }
+    }
+    if ((mode != "reactor" && mode != "bare") || iterations <= 0) {
+        fprintf(stderr, "usage: %s [-m reactor|bare] [-n iterations] [-s scenario,...] [-r doc_root] "
+                        "[-j result.json]\n", argv[0]);
+        return 1;
+    }
+
+    Log::get_instance()->init("/dev/null", 1, 8192, 5000000, false);
+    MemoryUserStore store;
+    store.add_user("test", "test");
+
+    server_driver *server;
+    if (mode == "reactor")
+        server = new reactor_driver(root, &store);
+    else
+        server = new bare_driver(root, &store);
+
+    // 协程模式编译的测试台只有 SubReactor 走协程，结果名加后缀与回调模式区分
+    std::string label = mode;
+#ifdef USE_COROUTINE
+    if (mode == "reactor")
+        label = "reactor_coro";
+#endif
+
+    bench_report report("harness");
+    for (const scenario &sc : build_scenarios()) {
+        if (!only.empty() && only.find("," + std::string(sc.name) + ",") == std::string::npos)
+            continue;
+        int repeat = std::max(1, iterations / sc.repeat_div);
+
+        run_stats stats;
+        syscall_counts sc_before = syscall_snapshot();
+        uint64_t cpu_before = server->server_cpu_ns();
+        uint64_t wall_before = bench_now_ns();
+        run_scenario(*server, sc, repeat, stats);
+        uint64_t wall = bench_now_ns() - wall_before;
+        uint64_t cpu = server->server_cpu_ns() - cpu_before;
+        syscall_counts sc_after = syscall_snapshot();
+
+        // 没有响应的场景（oversized）按连接数计
+        uint64_t units = stats.expected ? stats.responses : (uint64_t)repeat;
+        double per = units ? 1.0 / units : 0.0;
+
+        bench_result r;
+        r.name = "harness." + label + "." + sc.name;
+        r.ops = units;
+        r.ns_per_op = cpu * per;
+        r.add("expected", (double)stats.expected);
+        r.add("ok", (double)stats.ok);
+        r.add("server_closes", (double)stats.closes);
+        r.add("stalled", stats.stalled ? 1 : 0);
+        r.add("wall_ms", wall / 1e6);
+        syscall_counts delta;
+        for (int i = 0; i < SC_COUNT; i++)
+            delta.n[i] = sc_after.n[i] - sc_before.n[i];
+        r.add("syscalls", delta.total() * per);
+        for (int i = 0; i < SC_COUNT; i++) {
+            if (delta.n[i])
+                r.add(SYSCALL_NAMES[i], delta.n[i] * per);
+        }
+        report.add(r);
+
+        // 响应不全不算运行失败，记在结果里（stalled）留给对比时发现
+        if (stats.stalled || (sc.expect_close && stats.closes == 0)) {
+            fprintf(stderr, "%s: %llu/%llu responses, %llu server closes%s\n", sc.name,
+                    (unsigned long long)stats.responses, (unsigned long long)stats.expected,
+                    (unsigned long long)stats.closes, stats.stalled ? ", stalled" : "");
+        }
+    }
+    delete server;
+
+    if (json && !report.write_json(json))
+        return 1;
+    return 0;
+}
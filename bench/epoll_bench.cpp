@@ -0,0 +1,116 @@
+// epoll 系统调用基准测试：Utils::modfd（每次读写切换都会调用的 EPOLL_CTL_MOD）等的单次耗时
+//   syscall.getppid     最便宜的系统调用，作为进出内核的下限
+//   epoll.modfd.N       N 个 fd 已注册时重新武装 EPOLLONESHOT，fd 不可读
+//   epoll.modfd_ready.N 同上，但 fd 已可读：MOD 会把它挂上就绪链表并唤醒等待者
+//   epoll.add_del.N     Utils::addfd（含 setnonblocking 的两次 fcntl）+ EPOLL_CTL_DEL
+//   fcntl.setnonblocking
+// 用法：./bench/epoll_bench [-n 次数] [-j result.json]
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "../utils/utils.h"
+
+int main(int argc, char *argv[]) {
+    uint64_t iterations = 1000000;
+    const char *json = nullptr;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:j:")) != -1) {
+        switch (opt) {
+            case 'n': iterations = strtoull(optarg, nullptr, 10); break;
+            case 'j': json = optarg; break;
+            default:
+                fprintf(stderr, "usage: %s [-n iterations] [-j result.json]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    // 注册大量 fd 需要放开软限制
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+    getrlimit(RLIMIT_NOFILE, &rl);
+
+    bench_report report("epoll");
+    report.add(bench_run("syscall.getppid", iterations, 256, [](uint64_t) {
+        bench_keep(syscall(SYS_getppid));
+    }));
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        perror("socketpair");
+        return 1;
+    }
+    report.add(bench_run("fcntl.setnonblocking", iterations, 256, [&](uint64_t) {
+        bench_keep(Utils::setnonblocking(fds[0]));
+    }));
+
+    const int populations[] = {1, 1000, 10000};
+    for (int population : populations) {
+        if ((rlim_t)population + 64 > rl.rlim_cur) {
+            fprintf(stderr, "skipping %d registered fds: RLIMIT_NOFILE is %llu\n", population,
+                    (unsigned long long)rl.rlim_cur);
+            continue;
+        }
+        // 其余 fd 用 eventfd 占位，模拟同一个 SubReactor 上的其他连接
+        int epollfd = epoll_create1(EPOLL_CLOEXEC);
+        std::vector<int> others;
+        for (int i = 1; i < population; i++) {
+            int efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (efd < 0)
+                break;
+            Utils::addfd(epollfd, efd, true, 0);
+            others.push_back(efd);
+        }
+        Utils::addfd(epollfd, fds[0], true, 0);
+        std::string suffix = "." + std::to_string(population);
+
+        report.add(bench_run("epoll.modfd" + suffix, iterations, 256, [&](uint64_t) {
+            Utils::modfd(epollfd, fds[0], EPOLLIN, 0);
+        }));
+
+        // 让 fds[0] 可读；每次 MOD 后就绪，需要 epoll_wait 取走才能回到同样的初始状态，这里连同取走一起计
+        char byte = 'x';
+        if (write(fds[1], &byte, 1) != 1) {
+            perror("write");
+            return 1;
+        }
+        epoll_event ev;
+        bench_result ready = bench_run("epoll.modfd_ready" + suffix, iterations, 256, [&](uint64_t) {
+            Utils::modfd(epollfd, fds[0], EPOLLIN, 0);
+            bench_keep(epoll_wait(epollfd, &ev, 1, 0));
+        });
+        ready.add("includes_epoll_wait", 1);
+        report.add(ready);
+        if (read(fds[0], &byte, 1) != 1) {
+            perror("read");
+            return 1;
+        }
+
+        epoll_ctl(epollfd, EPOLL_CTL_DEL, fds[0], nullptr);
+        report.add(bench_run("epoll.add_del" + suffix, iterations / 4, 64, [&](uint64_t) {
+            Utils::addfd(epollfd, fds[0], true, 0);
+            epoll_ctl(epollfd, EPOLL_CTL_DEL, fds[0], nullptr);
+        }));
+
+        for (int efd : others)
+            close(efd);
+        close(epollfd);
+    }
+    close(fds[0]);
+    close(fds[1]);
+
+    if (json && !report.write_json(json))
+        return 1;
+    return 0;
+}
@@ -0,0 +1,174 @@
+// HTTP 基准测试：http_conn 的请求解析（process_read）与响应头构建（process_write）
+// 请求直接放进读缓冲区，不经过 socket；process_read 包括路由、stat 和小文件 mmap，与服务器中一致
+// 每次解析后都要 unmap + init() 重置连接，单独给出 reset 一项便于扣除
+// 用法：./bench/http_bench [-n 每项次数] [-r 资源目录] [-j result.json]，在仓库根目录运行（默认资源目录 ./root）
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "../http/http_conn.h"
+#include "../utils/clock.h"
+#include "../userstore/memory_user_store.h"
+
+class http_conn_bench {
+public:
+    // 模拟一次读：把请求放进读缓冲区
+    static void load(http_conn &conn, const std::string &request) {
+        memcpy(conn.m_read_buf, request.data(), request.size());
+        conn.m_read_idx = (long)request.size();
+    }
+    static http_conn::HTTP_CODE parse(http_conn &conn) { return conn.process_read(); }
+    static bool build(http_conn &conn, http_conn::HTTP_CODE code) {
+        conn.m_write_idx = 0;
+        return conn.process_write(code);
+    }
+    static int header_bytes(http_conn &conn) { return conn.m_write_idx; }
+    // 写完一个响应后的重置，与 SubReactor 中长连接复用时相同
+    static void reset(http_conn &conn) {
+        conn.unmap();
+        conn.init();
+    }
+};
+
+struct corpus_entry {
+    const char *name;
+    std::string request;
+    http_conn::HTTP_CODE expect;
+};
+
+static std::vector<corpus_entry> build_corpus() {
+    std::vector<corpus_entry> corpus;
+    // wrk/loadgen 风格的最小请求
+    corpus.push_back({"get_root_min",
+                      "GET / HTTP/1.1\r\nHost: 127.0.0.1:9006\r\nConnection: keep-alive\r\n\r\n",
+                      http_conn::FILE_REQUEST});
+    // 浏览器请求：十来个头部，约 600 字节
+    corpus.push_back({"get_browser",
+                      "GET /judge.html HTTP/1.1\r\n"
+                      "Host: 127.0.0.1:9006\r\n"
+                      "Connection: keep-alive\r\n"
+                      "Cache-Control: max-age=0\r\n"
+                      "sec-ch-ua: \"Chromium\";v=\"124\", \"Google Chrome\";v=\"124\", \"Not-A.Brand\";v=\"99\"\r\n"
+                      "sec-ch-ua-mobile: ?0\r\n"
+                      "sec-ch-ua-platform: \"Linux\"\r\n"
+                      "Upgrade-Insecure-Requests: 1\r\n"
+                      "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) "
+                      "Chrome/124.0.0.0 Safari/537.36\r\n"
+                      "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+                      "Sec-Fetch-Site: same-origin\r\n"
+                      "Sec-Fetch-Mode: navigate\r\n"
+                      "Sec-Fetch-Dest: document\r\n"
+                      "Referer: http://127.0.0.1:9006/\r\n"
+                      "Accept-Encoding: gzip, deflate, br\r\n"
+                      "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+                      "\r\n",
+                      http_conn::FILE_REQUEST});
+    corpus.push_back({"get_404",
+                      "GET /missing.html HTTP/1.1\r\nHost: 127.0.0.1:9006\r\nConnection: keep-alive\r\n\r\n",
+                      http_conn::NO_RESOURCE});
+    corpus.push_back({"post_login",
+                      "POST /2CGISQL.cgi HTTP/1.1\r\nHost: 127.0.0.1:9006\r\nConnection: keep-alive\r\n"
+                      "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: 23\r\n\r\n"
+                      "user=test&password=test",
+                      http_conn::FILE_REQUEST});
+    // 请求头只到了一半：每次可读事件都会从头重新解析
+    corpus.push_back({"partial_header",
+                      "GET /judge.html HTTP/1.1\r\nHost: 127.0.0.1:9006\r\nConnection: keep-al",
+                      http_conn::NO_REQUEST});
+    return corpus;
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t iterations = 200000;
+    const char *json = nullptr;
+    char root[256] = "./root";
+    int opt;
+    while ((opt = getopt(argc, argv, "n:r:j:")) != -1) {
+        switch (opt) {
+            case 'n': iterations = strtoull(optarg, nullptr, 10); break;
+            case 'r': snprintf(root, sizeof(root), "%s", optarg); break;
+            case 'j': json = optarg; break;
+            default:
+                fprintf(stderr, "usage: %s [-n iterations] [-r doc_root] [-j result.json]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    Log::get_instance()->init("/dev/null", 1, 8192, 5000000, false);
+    LoopClock clock;
+    LoopClock::set_current(&clock);
+
+    // init() 会把 fd 加入 epoll，给它一对真实的 socket
+    int epollfd = epoll_create1(EPOLL_CLOEXEC);
+    int fds[2];
+    if (epollfd < 0 || socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        perror("setup");
+        return 1;
+    }
+    // 内存用户表，登录请求不依赖数据库
+    MemoryUserStore store;
+    store.add_user("test", "test");
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    http_conn *conn = new http_conn();      // 读写缓冲区 12KB，不放栈上
+    conn->init(fds[0], addr, root, 0, 1, "", "", "", epollfd, &store, nullptr);
+
+    bench_report report("http");
+
+    bench_result reset = bench_run("http.reset", iterations, 64, [&](uint64_t) {
+        http_conn_bench::reset(*conn);
+    });
+    report.add(reset);
+
+    for (const corpus_entry &entry : build_corpus()) {
+        http_conn_bench::load(*conn, entry.request);
+        http_conn::HTTP_CODE code = http_conn_bench::parse(*conn);
+        http_conn_bench::reset(*conn);
+        if (code != entry.expect) {
+            fprintf(stderr, "%s: process_read returned %d, expected %d (doc root %s)\n", entry.name, code,
+                    entry.expect, root);
+            return 1;
+        }
+
+        bench_result r = bench_run(std::string("http.parse.") + entry.name, iterations, 64, [&](uint64_t) {
+            http_conn_bench::load(*conn, entry.request);
+            bench_keep(http_conn_bench::parse(*conn));
+            http_conn_bench::reset(*conn);
+        });
+        r.add("request_bytes", (double)entry.request.size());
+        report.add(r);
+    }
+
+    // 响应头构建：先正常处理一次得到文件信息，再反复构建
+    http_conn_bench::load(*conn, build_corpus()[0].request);
+    if (http_conn_bench::parse(*conn) != http_conn::FILE_REQUEST) {
+        fprintf(stderr, "cannot serve %s/judge.html\n", root);
+        return 1;
+    }
+    bench_result build_ok = bench_run("http.build.200", iterations, 64, [&](uint64_t) {
+        bench_keep(http_conn_bench::build(*conn, http_conn::FILE_REQUEST));
+    });
+    build_ok.add("header_bytes", http_conn_bench::header_bytes(*conn));
+    report.add(build_ok);
+
+    bench_result build_err = bench_run("http.build.404", iterations, 64, [&](uint64_t) {
+        bench_keep(http_conn_bench::build(*conn, http_conn::BAD_REQUEST));
+    });
+    build_err.add("header_bytes", http_conn_bench::header_bytes(*conn));
+    report.add(build_err);
+    http_conn_bench::reset(*conn);
+
+    delete conn;
+    close(fds[0]);
+    close(fds[1]);
+    close(epollfd);
+
+    if (json && !report.write_json(json))
+        return 1;
+    return 0;
+}
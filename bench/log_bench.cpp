@@ -0,0 +1,179 @@
+// 日志基准测试：N 个生产者线程同时调用 LOG_INFO 的吞吐与单次调用耗时
+// 模式：sync（写日志的线程加锁写文件）、async（每线程环 + 写线程）、deferred（async 且由写线程格式化）
+// Log 是进程内单例，每种配置在单独的子进程里跑，结果经管道交回父进程
+// 用法：./bench/log_bench [-n 每线程行数] [-t 线程数列表，如 1,2,4,8] [-o 日志目录] [-j result.json]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench.h"
+#include "../log/log.h"
+
+struct log_mode {
+    const char *name;
+    bool async;
+    int defer_mode;
+};
+
+static const log_mode MODES[] = {
+    {"sync", false, Log::DEFER_OFF},
+    {"async", true, Log::DEFER_OFF},
+    {"deferred", true, Log::DEFER_TEXT},
+};
+
+// 子进程交回的结果
+struct child_result {
+    uint64_t ops;
+    double ns_per_op;       // 墙上时间 / 总行数，即合计吞吐
+    double p50_ns;          // 各线程分批平均耗时的分位数（单次调用延迟）
+    double p99_ns;
+    double drain_ms;        // async：生产者结束后写线程写完积压的时间
+    double dropped;
+};
+
+static const uint64_t BATCH = 64;
+
+static child_result run_child(const log_mode &mode, int threads, uint64_t lines, const std::string &dir) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s_%d.log", dir.c_str(), mode.name, threads);
+    Log *log = Log::get_instance();
+    log->set_rotation(0, 0, false);
+    log->init(path, 0, 8192, 1 << 30, mode.async, mode.defer_mode);
+
+    std::vector<std::vector<double>> samples(threads);
+    std::atomic<int> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> producers;
+    for (int t = 0; t < threads; t++) {
+        producers.emplace_back([&, t] {
+            std::vector<double> &mine = samples[t];
+            mine.reserve(lines / BATCH + 1);
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) {
+            }
+            // 与服务器中典型的访问类日志相当：几个整数和一个短字符串
+            for (uint64_t i = 0; i < lines; i += BATCH) {
+                uint64_t n = lines - i < BATCH ? lines - i : BATCH;
+                uint64_t t0 = bench_now_ns();
+                for (uint64_t j = 0; j < n; j++)
+                    LOG_INFO("client fd %d request %llu path %s status %d bytes %d", t, (unsigned long long)(i + j),
+                             "/judge.html", 200, 1024);
+                mine.push_back((double)(bench_now_ns() - t0) / n);
+            }
+        });
+    }
+    while (ready.load() != threads) {
+    }
+    uint64_t start = bench_now_ns();
+    go.store(true, std::memory_order_release);
+    for (std::thread &t : producers)
+        t.join();
+    uint64_t produced = bench_now_ns();
+
+    // 等写线程把各线程环写空
+    log->flush();
+    while (mode.async && log->queued_bytes() > 0) {
+        log->flush();
+        usleep(100);
+    }
+    uint64_t drained = bench_now_ns();
+
+    std::vector<double> all;
+    for (const std::vector<double> &s : samples)
+        all.insert(all.end(), s.begin(), s.end());
+    std::sort(all.begin(), all.end());
+
+    child_result r;
+    r.ops = lines * threads;
+    r.ns_per_op = (double)(produced - start) / r.ops;
+    r.p50_ns = all.empty() ? 0 : all[all.size() / 2];
+    r.p99_ns = all.empty() ? 0 : all[std::min(all.size() - 1, all.size() * 99 / 100)];
+    r.drain_ms = (drained - produced) / 1e6;
+    r.dropped = (double)log->dropped_lines();
+    return r;
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t lines = 200000;
+    std::string thread_list = "1,2,4,8";
+    std::string dir = "/tmp/log_bench";
+    const char *json = nullptr;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:t:o:j:")) != -1) {
+        switch (opt) {
+            case 'n': lines = strtoull(optarg, nullptr, 10); break;
+            case 't': thread_list = optarg; break;
+            case 'o': dir = optarg; break;
+            case 'j': json = optarg; break;
+            default:
+                fprintf(stderr, "usage: %s [-n lines_per_thread] [-t 1,2,4,8] [-o log_dir] [-j result.json]\n",
+                        argv[0]);
+                return 1;
+        }
+    }
+    std::vector<int> thread_counts;
+    for (const char *p = thread_list.c_str(); *p;) {
+        int n = atoi(p);
+        if (n <= 0) {
+            fprintf(stderr, "bad thread list: %s\n", thread_list.c_str());
+            return 1;
+        }
+        thread_counts.push_back(n);
+        p += strcspn(p, ",");
+        if (*p == ',')
+            p++;
+    }
+    mkdir(dir.c_str(), 0755);
+
+    bench_report report("log");
+    for (const log_mode &mode : MODES) {
+        for (int threads : thread_counts) {
+            int pipefd[2];
+            if (pipe(pipefd) < 0) {
+                perror("pipe");
+                return 1;
+            }
+            pid_t pid = fork();
+            if (pid == 0) {
+                close(pipefd[0]);
+                child_result r = run_child(mode, threads, lines, dir);
+                ssize_t n = write(pipefd[1], &r, sizeof(r));
+                // 不等单例析构，写线程随进程退出
+                _exit(n == (ssize_t)sizeof(r) ? 0 : 1);
+            }
+            close(pipefd[1]);
+            child_result r;
+            ssize_t n = read(pipefd[0], &r, sizeof(r));
+            close(pipefd[0]);
+            int status = 0;
+            waitpid(pid, &status, 0);
+            if (pid < 0 || n != (ssize_t)sizeof(r) || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                fprintf(stderr, "log.%s.%d: child failed\n", mode.name, threads);
+                return 1;
+            }
+
+            bench_result result;
+            result.name = std::string("log.") + mode.name + "." + std::to_string(threads) + "t";
+            result.ops = r.ops;
+            result.ns_per_op = r.ns_per_op;
+            result.p50_ns = r.p50_ns;
+            result.p99_ns = r.p99_ns;
+            result.add("threads", threads);
+            if (mode.async)
+                result.add("drain_ms", r.drain_ms);
+            result.add("dropped", r.dropped);
+            report.add(result);
+        }
+    }
+
+    if (json && !report.write_json(json))
+        return 1;
+    return 0;
+}
@@ -0,0 +1,223 @@
+// 数据库连接池基准测试：N 个线程反复 GetConnection / ReleaseConnection 的开销与争用
+//   global：所有线程共用全局池（互斥锁 + 条件变量），线程数超过连接数时包含等待
+//   local： 每个线程一个 local_connection_pool 私有切片，与 SubReactor 相同，取还不加锁
+//   shrink：-m 小于 -c 时，最后一次性借满 -c 个连接再全部归还，检查空闲 -I 毫秒后
+//           维护线程把连接数收回到 -m（收不回则退出码为 1）
+// 需要可连接的 MySQL；连不上时跳过并在 JSON 的 note 中说明
+// 用法：./bench/pool_bench [-a host] [-P port] [-u user] [-w password] [-d db] [-c 连接数]
+//                          [-m 最小连接数] [-I 空闲回收毫秒] [-t 线程数列表] [-n 每线程次数]
+//                          [-H 持有微秒] [-j result.json]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench.h"
+#include "../mydb/sql_connection_pool.h"
+#include "../mydb/local_connection_pool.h"
+
+static const uint64_t BATCH = 16;
+
+// 所有线程同时开始，返回合计结果；slice > 0 时每个线程先建私有切片
+static bench_result run(const std::string &name, connection_pool *pool, int threads, uint64_t iterations, int hold_us,
+                        int slice) {
+    std::vector<std::vector<double>> samples(threads);
+    std::vector<uint64_t> failures(threads, 0);
+    std::atomic<int> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            local_connection_pool local(pool);
+            local.init(slice);
+            std::vector<double> &mine = samples[t];
+            mine.reserve(iterations / BATCH + 1);
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) {
+            }
+            for (uint64_t i = 0; i < iterations; i += BATCH) {
+                uint64_t n = iterations - i < BATCH ? iterations - i : BATCH;
+                uint64_t t0 = bench_now_ns();
+                for (uint64_t j = 0; j < n; j++) {
+                    MYSQL *conn = slice > 0 ? local.GetConnection() : pool->GetConnection();
+                    if (!conn) {
+                        failures[t]++;
+                        continue;
+                    }
+                    if (hold_us > 0)
+                        usleep(hold_us);
+                    if (slice > 0)
+                        local.ReleaseConnection(conn);
+                    else
+                        pool->ReleaseConnection(conn);
+                }
+                mine.push_back((double)(bench_now_ns() - t0) / n);
+            }
+            local.DestoryPool();
+        });
+    }
+    while (ready.load() != threads) {
+    }
+    uint64_t start = bench_now_ns();
+    go.store(true, std::memory_order_release);
+    for (std::thread &w : workers)
+        w.join();
+    uint64_t elapsed = bench_now_ns() - start;
+
+    std::vector<double> all;
+    uint64_t failed = 0;
+    for (int t = 0; t < threads; t++) {
+        all.insert(all.end(), samples[t].begin(), samples[t].end());
+        failed += failures[t];
+    }
+    std::sort(all.begin(), all.end());
+
+    bench_result r;
+    r.name = name;
+    r.ops = iterations * threads;
+    r.ns_per_op = (double)elapsed / r.ops;
+    if (!all.empty()) {
+        r.p50_ns = all[all.size() / 2];
+        r.p99_ns = all[std::min(all.size() - 1, all.size() * 99 / 100)];
+    }
+    r.add("threads", threads);
+    r.add("failures", (double)failed);
+    return r;
+}
+
+// 突发借满连接池后全部归还，等待维护线程把空闲连接收回到最小连接数
+// ops 为是否收回（1/0），ns_per_op 为收回所用时间
+static bench_result shrink(connection_pool *pool, int conns, int idle_ms) {
+    std::vector<MYSQL *> held;
+    for (int i = 0; i < conns; i++) {
+        MYSQL *conn = pool->GetConnection();
+        if (conn)
+            held.push_back(conn);
+    }
+    int grown = pool->GetStats().total;
+    for (MYSQL *conn : held)
+        pool->ReleaseConnection(conn);
+
+    // 空闲超时后最多再等两个检测周期（检测间隔为空闲时间的一半）
+    uint64_t start = bench_now_ns();
+    uint64_t deadline = start + (uint64_t)idle_ms * 2 * 1000000ULL + 1000000000ULL;
+    connection_pool::Stats stats = pool->GetStats();
+    while (stats.total > stats.min_conn && bench_now_ns() < deadline) {
+        usleep(50000);
+        stats = pool->GetStats();
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+
+    bench_result r;
+    r.name = "pool.shrink";
+    r.ops = stats.total <= stats.min_conn ? 1 : 0;
+    r.ns_per_op = (double)elapsed;
+    r.add("grown", grown);
+    r.add("settled", stats.total);
+    r.add("min_conn", stats.min_conn);
+    printf("pool shrink: %d -> %d connections in %.0f ms (min %d)\n", grown, stats.total, elapsed / 1e6,
+           stats.min_conn);
+    return r;
+}
+
+int main(int argc, char *argv[]) {
+    std::string host = "localhost", user = "root", password, db = "kopdb";
+    int port = 3306;
+    int conns = 8;
+    int min_conns = -1;
+    int idle_ms = 1000;
+    std::string thread_list = "1,2,4,8,16";
+    uint64_t iterations = 100000;
+    int hold_us = 0;
+    const char *json = nullptr;
+    int opt;
+    while ((opt = getopt(argc, argv, "a:P:u:w:d:c:m:I:t:n:H:j:")) != -1) {
+        switch (opt) {
+            case 'a': host = optarg; break;
+            case 'P': port = atoi(optarg); break;
+            case 'u': user = optarg; break;
+            case 'w': password = optarg; break;
+            case 'd': db = optarg; break;
+            case 'c': conns = atoi(optarg); break;
+            case 'm': min_conns = atoi(optarg); break;
+            case 'I': idle_ms = atoi(optarg); break;
+            case 't': thread_list = optarg; break;
+            case 'n': iterations = strtoull(optarg, nullptr, 10); break;
+            case 'H': hold_us = atoi(optarg); break;
+            case 'j': json = optarg; break;
+            default:
+                fprintf(stderr,
+                        "usage: %s [-a host] [-P port] [-u user] [-w password] [-d db] [-c conns]\n"
+                        "          [-m min_conns] [-I idle_ms] [-t 1,2,4,8,16] [-n iterations_per_thread]\n"
+                        "          [-H hold_us] [-j result.json]\n",
+                        argv[0]);
+                return 1;
+        }
+    }
+    if (min_conns < 0 || min_conns > conns)
+        min_conns = conns;
+    if (idle_ms <= 0) {
+        fprintf(stderr, "bad idle timeout: %d\n", idle_ms);
+        return 1;
+    }
+    std::vector<int> thread_counts;
+    for (const char *p = thread_list.c_str(); *p;) {
+        int n = atoi(p);
+        if (n <= 0) {
+            fprintf(stderr, "bad thread list: %s\n", thread_list.c_str());
+            return 1;
+        }
+        thread_counts.push_back(n);
+        p += strcspn(p, ",");
+        if (*p == ',')
+            p++;
+    }
+
+    Log::get_instance()->init("/dev/null", 1, 8192, 5000000, false);
+    bench_report report("pool");
+
+    connection_pool *pool = connection_pool::GetInstance();
+    if (min_conns < conns)
+        pool->SetIdlePolicy(idle_ms / 2, idle_ms);
+    pool->init(host, user, password, db, port, min_conns, conns, 1000, 1);
+    bool shrunk = true;
+    if (pool->GetFreeConn() < min_conns) {
+        report.set_note("skipped: cannot open " + std::to_string(min_conns) + " MySQL connections to " + host + ":" +
+                        std::to_string(port));
+    } else {
+        for (int threads : thread_counts) {
+            report.add(run("pool.global." + std::to_string(threads) + "t", pool, threads, iterations, hold_us, 0));
+        }
+        // 切片大小与 SubReactor 相同：连接数平均分给各线程，至少 1 个
+        for (int threads : thread_counts) {
+            if (threads > conns)
+                continue;
+            int slice = conns / threads;
+            bench_result r = run("pool.local." + std::to_string(threads) + "t", pool, threads, iterations, hold_us,
+                                 slice);
+            r.add("slice", slice);
+            report.add(r);
+        }
+        connection_pool::Stats stats = pool->GetStats();
+        printf("pool: %llu acquires, %llu timeouts, waits:", stats.acquires, stats.timeouts);
+        for (int i = 0; i < connection_pool::WAIT_BUCKETS; i++)
+            printf(" %s=%llu", connection_pool::WaitBucketName(i), stats.wait_hist[i]);
+        printf("\n");
+        if (min_conns < conns) {
+            bench_result r = shrink(pool, conns, idle_ms);
+            shrunk = r.ops == 1;
+            if (!shrunk)
+                report.set_note("pool did not shrink back to min connections");
+            report.add(r);
+        }
+    }
+    pool->DestoryPool();
+
+    if (json && !report.write_json(json))
+        return 1;
+    return shrunk ? 0 : 1;
+}
@@ -0,0 +1,49 @@
+#ifndef SYSCALL_COUNT_H
+#define SYSCALL_COUNT_H
+
+#include <stdint.h>
+
+// 系统调用计数：在可执行文件里定义同名函数截获 libc 调用（dlsym(RTLD_NEXT) 找到真正的实现）
+// 只统计本程序各目标文件经 PLT 发出的调用，libc 内部互相调用（如 fopen 里的 open）不计
+// 客户端一侧的调用放在 syscall_client_scope 里，不计入服务器
+enum SYSCALL_ID {
+    SC_READ = 0,        // read / recv
+    SC_WRITE,           // write / send
+    SC_WRITEV,
+    SC_SENDFILE,
+    SC_EPOLL_WAIT,
+    SC_EPOLL_CTL,
+    SC_OPEN,
+    SC_CLOSE,
+    SC_STAT,            // stat / fstat
+    SC_MMAP,
+    SC_MUNMAP,
+    SC_FCNTL,
+    SC_TIMERFD,         // timerfd_settime
+    SC_COUNT
+};
+
+extern const char *const SYSCALL_NAMES[SC_COUNT];
+
+struct syscall_counts {
+    uint64_t n[SC_COUNT];
+
+    uint64_t total() const {
+        uint64_t sum = 0;
+        for (int i = 0; i < SC_COUNT; i++)
+            sum += n[i];
+        return sum;
+    }
+};
+
+// 所有线程累计的快照，两次相减得到区间内的次数
+syscall_counts syscall_snapshot();
+
+// 作用域内本线程的调用不计数（可嵌套）
+class syscall_client_scope {
+public:
+    syscall_client_scope();
+    ~syscall_client_scope();
+};
+
+#endif
@@ -0,0 +1,186 @@
+// 时间轮基准测试：1万 / 10万 / 100万个混合超时的定时器
+// 用模拟时间推进，不依赖 timerfd；同时校验每个定时器都在到期的那个 tick（1ms）触发
+// 用法：./bench/timer_bench [-j result.json] [timer_count]，不指定数量时依次跑三档
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "../timer/lst_timer.h"
+
+using Clock = std::chrono::steady_clock;
+
+static long long elapsed_ns(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+struct FireStats {
+    TimingWheel *wheel;
+    long long fired;
+    long long late;     // 触发时间与期限不一致的个数
+};
+
+static void on_expire(util_timer *timer, void *arg) {
+    FireStats *stats = static_cast<FireStats *>(arg);
+    stats->fired++;
+    if (stats->wheel->current_time() != timer->deadline)
+        stats->late++;
+}
+
+// 跑一档规模，结果加入 report；所有定时器都在正确的 tick 触发才返回 true
+static bool run(int count, bench_report &report) {
+    TimingWheel wheel;
+    wheel.set_timeslot(1, 0);
+    const long long base = wheel.current_time();
+
+    // 超时分布（毫秒）：70% 秒级（请求头/写停滞），25% 分钟级（长连接），5% 小时级（长轮询/WebSocket）
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<int> pick(0, 99);
+    std::uniform_int_distribution<int> secs(1, 60 * 1000);
+    std::uniform_int_distribution<int> mins(60 * 1000, 30 * 60 * 1000);
+    std::uniform_int_distribution<int> hours(3600 * 1000, 6 * 3600 * 1000);
+
+    FireStats stats = {&wheel, 0, 0};
+    long long max_deadline = base;
+
+    // 定时器节点预先分配（相当于嵌在连接对象里），时间轮本身不分配内存
+    std::vector<util_timer> nodes(count);
+    std::vector<long long> deadline(count);
+    auto start = Clock::now();
+    for (int i = 0; i < count; i++) {
+        int p = pick(rng);
+        int timeout = p < 70 ? secs(rng) : (p < 95 ? mins(rng) : hours(rng));
+        util_timer *timer = &nodes[i];
+        timer->deadline = base + timeout;
+        timer->cb_func = on_expire;
+        timer->cb_arg = &stats;
+        deadline[i] = timer->deadline;
+        wheel.add_timer(timer, base);
+    }
+    long long insert_ns = elapsed_ns(start);
+
+    // 删除 10% 后重新插入，模拟连接关闭与新建
+    int churn = count / 10;
+    start = Clock::now();
+    for (int i = 0; i < churn; i++) {
+        wheel.del_timer(&nodes[i]);
+        wheel.add_timer(&nodes[i], base);
+    }
+    long long churn_ns = elapsed_ns(start);
+
+    // 第30秒时每4个存活定时器中有1个有活动，期限推后（只写一次，到点再惰性重排）
+    const long long touch_at = base + 30 * 1000;
+    long long touched = 0;
+    long long touch_ns = 0;
+    for (int i = 0; i < count; i++) {
+        if (i % 4 == 0 && deadline[i] > touch_at) {
+            deadline[i] = touch_at + (deadline[i] - base);
+        }
+        if (deadline[i] > max_deadline)
+            max_deadline = deadline[i];
+    }
+
+    // 按秒推进（每次 1000 个 tick）直到全部到期，记录单次推进的最长耗时（包含降级）
+    long long max_tick_ns = 0;
+    long long calls = 0;
+    start = Clock::now();
+    for (long long now = base + 1000; now < max_deadline + 1000; now += 1000) {
+        if (now == touch_at + 1000) {
+            auto touch_start = Clock::now();
+            for (int i = 0; i < count; i += 4) {
+                if (deadline[i] > touch_at) {
+                    wheel.set_deadline(&nodes[i], deadline[i]);
+                    touched++;
+                }
+            }
+            touch_ns = elapsed_ns(touch_start);
+        }
+        auto tick_start = Clock::now();
+        wheel.tick(now);
+        long long ns = elapsed_ns(tick_start);
+        if (ns > max_tick_ns)
+            max_tick_ns = ns;
+        calls++;
+    }
+    long long advance_ns = elapsed_ns(start);
+
+    std::string prefix = "timer." + std::to_string(count) + ".";
+    bench_result r;
+    r.name = prefix + "add";
+    r.ops = count;
+    r.ns_per_op = (double)insert_ns / count;
+    r.add("levels", wheel.get_level_count());
+    report.add(r);
+
+    r = bench_result();
+    r.name = prefix + "del_add";
+    r.ops = churn;
+    r.ns_per_op = churn ? (double)churn_ns / churn : 0.0;
+    report.add(r);
+
+    // 期限推后只写一次，到点再惰性重排
+    r = bench_result();
+    r.name = prefix + "adjust";
+    r.ops = touched;
+    r.ns_per_op = touched ? (double)touch_ns / touched : 0.0;
+    report.add(r);
+
+    // 每次推进 1 秒（1000 个 tick），包含到期回调和高层降级
+    timer_wheel_stats ws = wheel.get_stats();
+    r = bench_result();
+    r.name = prefix + "tick_1s";
+    r.ops = calls;
+    r.ns_per_op = calls ? (double)advance_ns / calls : 0.0;
+    r.add("max_ns", (double)max_tick_ns);
+    r.add("fired", (double)stats.fired);
+    r.add("rescheduled", (double)ws.rescheduled);
+    r.add("cascaded", (double)ws.cascaded);
+    report.add(r);
+
+    if (stats.late != 0)
+        fprintf(stderr, "%d timers: %lld fired at the wrong tick\n", count, stats.late);
+    // 时间轮自身的统计应与外部计数一致
+    if (ws.live_timers != 0 || ws.fired != (unsigned long long)stats.fired) {
+        fprintf(stderr, "%d timers: wheel stats disagree (live %lu, fired %llu)\n", count, ws.live_timers, ws.fired);
+        return false;
+    }
+    return stats.fired == count && stats.late == 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *json = nullptr;
+    int opt;
+    while ((opt = getopt(argc, argv, "j:")) != -1) {
+        switch (opt) {
+            case 'j': json = optarg; break;
+            default:
+                fprintf(stderr, "usage: %s [-j result.json] [timer_count]\n", argv[0]);
+                return 1;
+        }
+    }
+    std::vector<int> counts;
+    if (optind < argc)
+        counts.push_back(atoi(argv[optind]));
+    else
+        counts = {10000, 100000, 1000000};
+    for (int count : counts) {
+        if (count <= 0) {
+            fprintf(stderr, "usage: %s [-j result.json] [timer_count]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // 只需关闭日志，不创建日志文件
+    Log::get_instance()->init("/dev/null", 1, 8192, 5000000, false);
+
+    bench_report report("timer");
+    bool ok = true;
+    for (int count : counts)
+        ok = run(count, report) && ok;
+    if (json && !report.write_json(json))
+        return 1;
+    return ok ? 0 : 1;
+}
@@ -19,9 +19,61 @@ Config::Config(){
     //优雅关闭链接，默认不使用
     OPT_LINGER = 0;
 
-    //数据库连接池数量,默认8
+    //数据库连接池最大连接数,默认8
     sql_num = 8;
 
+    //数据库连接池最小连接数,默认2
+    sql_min_num = 2;
+
+    //获取数据库连接超时,默认500ms
+    sql_timeout = 500;
+
+    //每个SubReactor私有的数据库连接数,默认0（共享全局池）
+    sql_slice = 0;
+
+    //非阻塞数据库查询,默认关闭（需以 ASYNC_SQL=1 编译）
+    sql_async = 0;
+
+    //用户存储后端,默认0（MySQL），1为嵌入式mmap存储
+    user_store = 0;
+
+    //嵌入式用户存储文件,默认./users.db
+    user_db_path = "./users.db";
+
+    //读取请求头期限,默认10秒（毫秒）
+    header_timeout = 10000;
+
+    //读取请求体期限,默认30秒
+    body_timeout = 30000;
+
+    //写停滞期限（无写出进展）,默认15秒
+    write_timeout = 15000;
+
+    //长连接空闲期限,默认20秒
+    idle_timeout = 20000;
+
+    //单个日志文件最大,默认100MB，超过即轮转并在后台压缩
+    log_max_mb = 100;
+
+    //保留的日志归档数,默认30，0为不清理
+    log_keep = 30;
+
+    //异步日志环满策略,默认2（过半先丢DEBUG，写满丢弃当前行），0为阻塞等待不丢日志
+    log_overflow = 2;
+
+    //访问日志采样间隔,默认1（每个请求都记），N为2xx/3xx每N个记一条，0为关闭
+    access_sample = 1;
+
+    //管理端口,默认0（不开启），开启后提供 /metrics；-d [地址:]端口，地址默认 127.0.0.1 只允许本机抓取
+    admin_port = 0;
+    admin_addr = "127.0.0.1";
+
+    //请求阶段追踪,默认0（关闭），N为每N个请求追踪一个，经管理端口 /debug/trace 导出
+    trace_sample = 0;
+
+    //TCP_DEFER_ACCEPT,默认0（关闭），N为握手后最多等N秒客户端数据，有数据才交给accept
+    defer_accept = 0;
+
     //子Reactor数量,默认3
     thread_num = 3;
 
@@ -32,7 +84,7 @@ Config::Config(){
 
 void Config::parse_arg(int argc, char *argv[]){
     int opt;
-    const char *str = "p:l:m:o:s:t:c:a:";
+    const char *str = "p:l:m:o:s:t:c:a:n:w:k:q:u:f:e:b:r:i:g:j:x:y:d:z:";
     while ((opt = getopt(argc, argv, str)) != -1){
         switch (opt)
         {
@@ -61,6 +113,97 @@ void Config::parse_arg(int argc, char *argv[]){
             sql_num = atoi(optarg);
             break;
         }
+        case 'n':
+        {
+            sql_min_num = atoi(optarg);
+            break;
+        }
+        case 'w':
+        {
+            sql_timeout = atoi(optarg);
+            break;
+        }
+        case 'k':
+        {
+            sql_slice = atoi(optarg);
+            break;
+        }
+        case 'q':
+        {
+            sql_async = atoi(optarg);
+            break;
+        }
+        case 'u':
+        {
+            user_store = atoi(optarg);
+            break;
+        }
+        case 'f':
+        {
+            user_db_path = optarg;
+            break;
+        }
+        case 'e':
+        {
+            header_timeout = atoi(optarg);
+            break;
+        }
+        case 'b':
+        {
+            body_timeout = atoi(optarg);
+            break;
+        }
+        case 'r':
+        {
+            write_timeout = atoi(optarg);
+            break;
+        }
+        case 'i':
+        {
+            idle_timeout = atoi(optarg);
+            break;
+        }
+        case 'g':
+        {
+            log_max_mb = atoi(optarg);
+            break;
+        }
+        case 'j':
+        {
+            log_keep = atoi(optarg);
+            break;
+        }
+        case 'x':
+        {
+            log_overflow = atoi(optarg);
+            break;
+        }
+        case 'y':
+        {
+            access_sample = atoi(optarg);
+            break;
+        }
+        case 'd':
+        {
+            const char *colon = strrchr(optarg, ':');
+            if (colon) {
+                admin_addr.assign(optarg, colon - optarg);
+                admin_port = atoi(colon + 1);
+            } else {
+                admin_port = atoi(optarg);
+            }
+            break;
+        }
+        case 'z':
+        {
+            trace_sample = atoi(optarg);
+            break;
+        }
+        case 'a':
+        {
+            defer_accept = atoi(optarg);
+            break;
+        }
         case 't':
         {
             thread_num = atoi(optarg);
@@ -30,9 +30,53 @@ public:
     //优雅关闭链接
     int OPT_LINGER;
 
-    //数据库连接池数量
+    //数据库连接池最大连接数
     int sql_num;
 
+    //数据库连接池最小连接数
+    int sql_min_num;
+
+    //获取数据库连接超时（毫秒）
+    int sql_timeout;
+
+    //每个SubReactor私有的数据库连接数
+    int sql_slice;
+
+    //是否使用非阻塞数据库查询
+    int sql_async;
+
+    //用户存储后端
+    int user_store;
+
+    //嵌入式用户存储文件路径
+    string user_db_path;
+
+    //连接各阶段期限（毫秒）
+    int header_timeout;
+    int body_timeout;
+    int write_timeout;
+    int idle_timeout;
+
+    //单个日志文件最大MB，保留的日志归档数
+    int log_max_mb;
+    int log_keep;
+
+    //异步日志环满策略
+    int log_overflow;
+
+    //访问日志采样间隔
+    int access_sample;
+
+    //管理端口（/metrics）及其监听地址
+    int admin_port;
+    string admin_addr;
+
+    //请求阶段追踪采样间隔
+    int trace_sample;
+
+    //TCP_DEFER_ACCEPT 秒数
+    int defer_accept;
+
     //子Reactor数量
     int thread_num;
 
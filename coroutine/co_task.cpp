@@ -0,0 +1,65 @@
+#include "co_task.h"
+
+#ifdef USE_COROUTINE
+
+#include <new>
+
+thread_local FramePool *FramePool::t_current = nullptr;
+
+FramePool::FramePool() {
+    for (size_t i = 0; i < CLASSES; i++)
+        m_free[i] = nullptr;
+}
+
+FramePool::~FramePool() {
+    for (size_t i = 0; i < CLASSES; i++) {
+        FreeNode *node = m_free[i];
+        while (node) {
+            FreeNode *next = node->next;
+            ::operator delete(node);
+            node = next;
+        }
+    }
+}
+
+void *FramePool::allocate(size_t size) {
+    size_t cls = (size + GRANULE - 1) / GRANULE;
+    if (cls < CLASSES && m_free[cls]) {
+        FreeNode *node = m_free[cls];
+        m_free[cls] = node->next;
+        return node;
+    }
+    return ::operator new(cls * GRANULE);
+}
+
+void FramePool::deallocate(void *block, size_t size) {
+    size_t cls = (size + GRANULE - 1) / GRANULE;
+    if (cls >= CLASSES) {
+        ::operator delete(block);
+        return;
+    }
+    FreeNode *node = static_cast<FreeNode *>(block);
+    node->next = m_free[cls];
+    m_free[cls] = node;
+}
+
+void *FramePool::allocate_frame(size_t size) {
+    size_t total = size + sizeof(Prefix);
+    FramePool *pool = t_current;
+    Prefix *prefix = static_cast<Prefix *>(pool ? pool->allocate(total) : ::operator new(total));
+    prefix->owner = pool;
+    return prefix + 1;
+}
+
+void FramePool::deallocate_frame(void *ptr, size_t size) {
+    Prefix *prefix = static_cast<Prefix *>(ptr) - 1;
+    FramePool *owner = prefix->owner;
+    // 只有在所属SubReactor线程上才归还空闲链表，其他线程（停机清理）直接释放
+    if (owner && owner == t_current) {
+        owner->deallocate(prefix, size + sizeof(Prefix));
+    } else {
+        ::operator delete(prefix);
+    }
+}
+
+#endif // USE_COROUTINE
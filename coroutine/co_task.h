@@ -0,0 +1,127 @@
+#ifndef CO_TASK_H
+#define CO_TASK_H
+
+// C++20 协程请求处理模式（make CORO=1 编译时定义 USE_COROUTINE）
+// 每个连接在所属SubReactor上运行一个协程，读/写/超时/数据库完成都以 co_await 表达
+#ifdef USE_COROUTINE
+
+#include <coroutine>
+#include <exception>
+#include <stddef.h>
+
+// 协程帧分配器：每个SubReactor一个，按64字节分级的空闲链表
+// 同一个协程函数的帧大小固定，稳定状态下建立连接不再向系统申请内存
+class FramePool {
+public:
+    FramePool();
+    ~FramePool();
+
+    // 当前线程使用的分配器（SubReactor线程启动时设置）
+    static FramePool *current() { return t_current; }
+    static void set_current(FramePool *pool) { t_current = pool; }
+
+    // 供 promise_type::operator new/delete 使用
+    static void *allocate_frame(size_t size);
+    static void deallocate_frame(void *ptr, size_t size);
+
+private:
+    static const size_t GRANULE = 64;
+    static const size_t CLASSES = 64;     // 最大 4KB，更大的帧直接走 ::operator new
+
+    // 帧前缀，记录所属分配器，析构可能发生在其他线程（如停机时）
+    struct alignas(16) Prefix {
+        FramePool *owner;
+    };
+
+    struct FreeNode {
+        FreeNode *next;
+    };
+
+    void *allocate(size_t size);
+    void deallocate(void *block, size_t size);
+
+    FreeNode *m_free[CLASSES];
+
+    static thread_local FramePool *t_current;
+};
+
+// 连接协程的返回类型：创建后立即运行到第一个挂起点，结束时停在 final_suspend 由SubReactor销毁
+class ConnTask {
+public:
+    struct promise_type {
+        ConnTask get_return_object() {
+            return ConnTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() { std::terminate(); }
+
+        static void *operator new(size_t size) { return FramePool::allocate_frame(size); }
+        static void operator delete(void *ptr, size_t size) { FramePool::deallocate_frame(ptr, size); }
+    };
+
+    ConnTask() : m_handle(nullptr) {}
+    explicit ConnTask(std::coroutine_handle<promise_type> h) : m_handle(h) {}
+    ConnTask(ConnTask &&other) noexcept : m_handle(other.m_handle) { other.m_handle = nullptr; }
+    ConnTask &operator=(ConnTask &&other) noexcept {
+        if (this != &other) {
+            reset();
+            m_handle = other.m_handle;
+            other.m_handle = nullptr;
+        }
+        return *this;
+    }
+    ConnTask(const ConnTask &) = delete;
+    ConnTask &operator=(const ConnTask &) = delete;
+    ~ConnTask() { reset(); }
+
+    bool valid() const { return m_handle != nullptr; }
+    bool done() const { return !m_handle || m_handle.done(); }
+
+    void reset() {
+        if (m_handle) {
+            m_handle.destroy();
+            m_handle = nullptr;
+        }
+    }
+
+private:
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+// 单个连接的协程上下文
+struct co_conn {
+    enum WAIT_KIND { WAIT_NONE = 0, WAIT_READ, WAIT_WRITE, WAIT_SQL };
+
+    std::coroutine_handle<> waiter;   // 挂起中的协程
+    WAIT_KIND waiting = WAIT_NONE;
+    bool timed_out = false;           // 由定时器唤醒
+    bool sql_ok = false;              // 异步查询结果
+    ConnTask task;
+};
+
+// 等待某一类事件，恢复时返回false表示是被超时唤醒
+// fd 的 epoll 兴趣由调用方（http_conn 的读写逻辑）负责注册
+struct co_event {
+    co_conn *ctx;
+    co_conn::WAIT_KIND kind;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) noexcept {
+        ctx->waiter = h;
+        ctx->waiting = kind;
+    }
+    bool await_resume() const noexcept {
+        ctx->waiting = co_conn::WAIT_NONE;
+        return !ctx->timed_out;
+    }
+};
+
+inline co_event readable(co_conn *ctx) { return co_event{ctx, co_conn::WAIT_READ}; }
+inline co_event writable(co_conn *ctx) { return co_event{ctx, co_conn::WAIT_WRITE}; }
+inline co_event sql_done(co_conn *ctx) { return co_event{ctx, co_conn::WAIT_SQL}; }
+
+#endif // USE_COROUTINE
+
+#endif
@@ -1,8 +1,9 @@
 
 #include "http_conn.h"
-#include <mysql/mysql.h>
 #include <fstream>
 #include "../utils/utils.h"
+#include "../utils/clock.h"
+#include "../utils/probes.h"
 
 // ========== HTTP响应状态信息 ==========
 const char *ok_200_title = "OK";
@@ -15,11 +16,6 @@ const char *error_404_form = "The requested file was not found on this server.\n
 const char *error_500_title = "Internal Error";
 const char *error_500_form = "There was an unusual problem serving the request file.\n";
 
-// ========== 全局变量 ==========
-std::mutex m_mutex;
-std::map<std::string, std::string> users;
-
-
 // ========== 工具函数（无需修改，仅更新变量名引用）==========
 
 // 设置文件描述符为非阻塞 - 已移至Utils::setnonblocking
@@ -30,42 +26,28 @@ std::map<std::string, std::string> users;
 
 // 工具函数modfd已移至Utils::modfd
 
-// ========== 初始化函数 ==========
-
-// 从数据库加载用户信息
-// 从数据库加载用户信息（静态方法）
-void http_conn::init_database_users(connection_pool *connPool) {
-    // 从连接池获取一个连接
-    ConnectionGuard connGuard(*connPool);
-    MYSQL* mysql = connGuard.get();
-
-    // 查询用户表
-    if (mysql_query(mysql, "SELECT username, passwd FROM user")) {
-        LOG_ERROR("SELECT error: %s\n", mysql_error(mysql));
-        return;
-    }
-
-    // 获取结果集
-    MYSQL_RES *result = mysql_store_result(mysql);
-
-    // 将用户名和密码存入map
-    while (MYSQL_ROW row = mysql_fetch_row(result)) {
-        std::string username(row[0]);
-        std::string password(row[1]);
-        users[username] = password;
-    }
+// USDT 探针的 SubReactor 编号参数
+static inline int probe_reactor() {
+    reactor_metrics *metrics = reactor_metrics::current();
+    return metrics ? metrics->reactor : -1;
 }
 
+// ========== 初始化函数 ==========
+
 // 外部调用的初始化函数
 void http_conn::init(int sockfd, const sockaddr_in &addr, char *root, int trigger_mode,
                      int close_log, std::string user, std::string passwd, std::string sqlname,
-                     int epollfd) {
+                     int epollfd, UserStore *user_store, async_sql_executor *async_sql) {
+    // 对象复用时先释放上一个连接没写完的文件
+    unmap();
     m_sockfd = sockfd;
     m_address = addr;
     m_epollfd = epollfd;  // 设置成员变量
+    m_user_store = user_store;
+    m_async_sql = async_sql;
 
-    // 将socket添加到epoll
-    Utils::addfd(m_epollfd, sockfd, true, trigger_mode);
+    // 将socket添加到epoll（主 Reactor 用 accept4 直接得到非阻塞 fd）
+    Utils::addfd(m_epollfd, sockfd, true, trigger_mode, false);
     // m_user_count++;  // 移除，改为外部管理
 
     // 保存配置
@@ -76,6 +58,9 @@ void http_conn::init(int sockfd, const sockaddr_in &addr, char *root, int trigge
     strcpy(m_sql_passwd, passwd.c_str());
     strcpy(m_sql_name, sqlname.c_str());
 
+    m_queued_ticks = 0;
+    m_dequeued_ticks = 0;
+
     init();
 }
 
@@ -98,6 +83,19 @@ void http_conn::init() {
     // 重置POST相关
     m_is_post_form = false;
     m_request_body = nullptr;
+    m_sql_pending = false;
+    m_headers_done = false;
+
+    // 重置访问日志信息
+    m_req_path = nullptr;
+    m_req_path_len = 0;
+    m_http_minor = 1;
+    m_status = 0;
+    m_response_bytes = 0;
+    m_request_start_ns = 0;
+    m_trace_id = 0;
+    m_trace_start = 0;
+    m_sql_submit_ticks = 0;
     
     // 重置发送控制
     m_bytes_to_send = 0;
@@ -109,7 +107,6 @@ void http_conn::init() {
     m_file_address = nullptr;
     
     // 其他状态
-    mysql = nullptr;
     m_state = 0;
     
     // 清空缓冲区
@@ -144,6 +141,15 @@ int http_conn::read_once() {
     
     int bytes_read = 0;
 
+    // 新请求的第一次读：耗时从这里开始算
+    if (m_read_idx == 0) {
+        if (reactor_metrics::current() || access_log::current()) {
+            m_request_start_ns = mono_ns();
+        }
+        begin_trace();
+    }
+    trace_span span(m_trace_id, m_sockfd, TRACE_READ);
+
     // LT模式
     if (m_trigger_mode == 0) {
         bytes_read = recv(m_sockfd, m_read_buf + m_read_idx, 
@@ -297,6 +303,7 @@ http_conn::HTTP_CODE http_conn::process_read() {
     if (pret == -2) {
         return NO_REQUEST;  // 需要更多数据
     }
+    m_headers_done = true;
     
     // 解析成功，提取各部分信息
     if (!parse_method(method, method_len)) {
@@ -310,6 +317,9 @@ http_conn::HTTP_CODE http_conn::process_read() {
     }
     
     parse_headers(headers, num_headers);
+    m_req_path = path;
+    m_req_path_len = path_len;
+    m_http_minor = minor_version;
     
     // 检查HTTP版本
     if (minor_version != 0 && minor_version != 1) {
@@ -372,45 +382,34 @@ void http_conn::route_to_page(char route_type) {
     m_real_file_path[FILENAME_LEN - 1] = '\0';
 }
 
-// 处理用户登录
-bool http_conn::handle_user_login(const char *name, const char *password) {
-    return users.count(name) && users[name] == password;
-}
+// 异步注册：提交INSERT到SubReactor的非阻塞执行器，完成后由 on_sql_complete 继续
+bool http_conn::submit_user_register(const char *name, const char *password) {
+    char sql_insert[256];
+    if (m_user_store->exists(name) ||
+        !m_user_store->build_insert_sql(name, password, sql_insert, sizeof(sql_insert))) {
+        return false;
+    }
 
-// 处理用户注册
-bool http_conn::handle_user_register(const char *name, const char *password) {
-    // 用户已存在
-    if (users.count(name)) {
+    strncpy(m_pending_user, name, sizeof(m_pending_user) - 1);
+    m_pending_user[sizeof(m_pending_user) - 1] = '\0';
+    strncpy(m_pending_passwd, password, sizeof(m_pending_passwd) - 1);
+    m_pending_passwd[sizeof(m_pending_passwd) - 1] = '\0';
+
+    if (!m_async_sql->submit(m_sockfd, sql_insert)) {
         return false;
     }
-    
-    // 插入数据库
-    char sql_insert[256];
-    snprintf(sql_insert, sizeof(sql_insert),
-             "INSERT INTO user(username, passwd) VALUES('%s', '%s')",
-             name, password);
-    
-    int res = 0;
-    {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        res = mysql_query(mysql, sql_insert);
-        if (res == 0) {
-            users[name] = password;
-        }
+    m_sql_pending = true;
+    if (m_trace_id) {
+        m_sql_submit_ticks = trace_ticks();
     }
-    
-    return res == 0;
+    return true;
 }
 
-// 处理CGI请求（登录/注册）
+// 处理CGI请求（登录/注册），结果页面写入 m_url
 http_conn::HTTP_CODE http_conn::handle_cgi_request(char route_flag) {
-    int len = strlen(m_doc_root);
-    
-    // 构建基础路径
-    strncpy(m_real_file_path, m_doc_root, FILENAME_LEN - 1);
-    strncpy(m_real_file_path + len, "/", FILENAME_LEN - len - 1);
-    strncat(m_real_file_path, m_url + 2, FILENAME_LEN - strlen(m_real_file_path) - 1);
-    m_real_file_path[FILENAME_LEN - 1] = '\0';
+    if (!m_request_body) {
+        return BAD_REQUEST;
+    }
 
     // 从POST body中提取用户名和密码
     // 格式: user=username&password=passwd
@@ -418,21 +417,29 @@ http_conn::HTTP_CODE http_conn::handle_cgi_request(char route_flag) {
     int i;
     
     // 提取用户名（跳过"user="，遇到'&'停止）
-    for (i = 5; m_request_body[i] != '&' && m_request_body[i] != '\0'; i++) {
+    for (i = 5; m_request_body[i] != '&' && m_request_body[i] != '\0' && i - 5 < 99; i++) {
         name[i - 5] = m_request_body[i];
     }
     name[i - 5] = '\0';
 
     // 提取密码（跳过"&password="）
     int j = 0;
-    for (i = i + 10; m_request_body[i] != '\0'; i++, j++) {
-        password[j] = m_request_body[i];
+    if (m_request_body[i] == '&') {
+        for (i = i + 10; m_request_body[i] != '\0' && j < 99; i++, j++) {
+            password[j] = m_request_body[i];
+        }
     }
     password[j] = '\0';
 
     // 处理注册
     if (route_flag == ROUTE_REGISTER_CHECK) {  // '3'
-        if (handle_user_register(name, password)) {
+        if (m_async_sql && m_user_store->supports_async()) {
+            if (submit_user_register(name, password)) {
+                return PENDING_REQUEST;
+            }
+            strcpy(m_url, "/registerError.html");
+        }
+        else if (m_user_store->add_user(name, password)) {
             strcpy(m_url, "/log.html");
         } else {
             strcpy(m_url, "/registerError.html");
@@ -440,7 +447,7 @@ http_conn::HTTP_CODE http_conn::handle_cgi_request(char route_flag) {
     }
     // 处理登录
     else if (route_flag == ROUTE_LOGIN_CHECK) {  // '2'
-        if (handle_user_login(name, password)) {
+        if (m_user_store->verify(name, password)) {
             strcpy(m_url, "/welcome.html");
         } else {
             strcpy(m_url, "/logError.html");
@@ -452,9 +459,6 @@ http_conn::HTTP_CODE http_conn::handle_cgi_request(char route_flag) {
 
 // 主请求处理函数
 http_conn::HTTP_CODE http_conn::do_request() {
-    strcpy(m_real_file_path, m_doc_root);
-    int len = strlen(m_doc_root);
-    
     const char *p = strrchr(m_url, '/');
     if (!p) {
         return BAD_REQUEST;
@@ -462,13 +466,28 @@ http_conn::HTTP_CODE http_conn::do_request() {
     
     char route_char = *(p + 1);
     
-    // 处理POST表单提交（登录/注册）
+    // 处理POST表单提交（登录/注册），m_url 被改写为结果页面
     if (m_is_post_form && (route_char == ROUTE_LOGIN_CHECK || route_char == ROUTE_REGISTER_CHECK)) {
-        return handle_cgi_request(route_char);
+        HTTP_CODE ret = handle_cgi_request(route_char);
+        if (ret != FILE_REQUEST) {
+            return ret;
+        }
     }
     
+    return serve_page();
+}
+
+// 根据 m_url 定位页面文件，选择 mmap 或 sendfile
+http_conn::HTTP_CODE http_conn::serve_page() {
+    strcpy(m_real_file_path, m_doc_root);
+
+    const char *p = strrchr(m_url, '/');
+    if (!p) {
+        return BAD_REQUEST;
+    }
+
     // 路由到对应页面
-    route_to_page(route_char);
+    route_to_page(*(p + 1));
 
     // 检查文件是否存在
     if (stat(m_real_file_path, &m_file_stat) < 0) {
@@ -531,12 +550,19 @@ bool http_conn::add_response(const char *format, ...) {
 
 // 添加状态行
 bool http_conn::add_status_line(int status, const char *title) {
+    m_status = status;
     return add_response("%s %d %s\r\n", "HTTP/1.1", status, title);
 }
 // 添加Content-Length头
 bool http_conn::add_content_length(int content_length) {
     return add_response("Content-Length:%d\r\n", content_length);
 }
+// 添加Date头：取本线程事件循环缓存的时间，字符串按秒缓存
+bool http_conn::add_date_header() {
+    LoopClock *clock = LoopClock::current();
+    time_t now = clock ? clock->wall_sec() : time(nullptr);
+    return add_response("Date:%s\r\n", WallClock::http_date(now));
+}
 // 添加Connection头
 bool http_conn::add_connection_header() {
     return add_response("Connection:%s\r\n", 
@@ -549,6 +575,7 @@ bool http_conn::add_blank_line() {
 // 添加所有响应头
 bool http_conn::add_headers(int content_length) {
     return (add_content_length(content_length) && 
+            add_date_header() &&
             add_connection_header() && 
             add_blank_line());
 }
@@ -597,6 +624,7 @@ bool http_conn::process_write(HTTP_CODE ret) {
                 m_response_iov[1].iov_len = m_file_stat.st_size;
                 m_response_iov_count = 2;
                 m_bytes_to_send = m_write_idx + m_file_stat.st_size;
+                m_response_bytes = m_bytes_to_send;
                 return true;
             }
             else {
@@ -618,11 +646,14 @@ bool http_conn::process_write(HTTP_CODE ret) {
     m_response_iov[0].iov_len = m_write_idx;
     m_response_iov_count = 1;
     m_bytes_to_send = m_write_idx;
+    m_response_bytes = m_bytes_to_send;
     return true;
 }
 
 // 主处理函数
 http_conn::PROCESS_RESULT http_conn::process() {
+    trace_span span(m_trace_id, m_sockfd, TRACE_PARSE);
+
     // 解析HTTP请求
     HTTP_CODE read_ret = process_read();
 
@@ -631,6 +662,11 @@ http_conn::PROCESS_RESULT http_conn::process() {
         return PROCESS_CONTINUE;
     }
 
+    if (read_ret == PENDING_REQUEST) {
+        // 等待异步查询，由SubReactor在完成后调用 on_sql_complete
+        return PROCESS_PENDING;
+    }
+
     // 构建HTTP响应
     bool write_ret = process_write(read_ret);
     if (!write_ret) {
@@ -639,6 +675,33 @@ http_conn::PROCESS_RESULT http_conn::process() {
     }
 
     // 处理成功，等待写事件
+    m_state = 1;
+    WS_PROBE4(response__start, probe_reactor(), m_sockfd, m_status, m_bytes_to_send);
+    return PROCESS_OK;
+}
+
+// 异步注册完成，更新用户缓存并构建响应
+http_conn::PROCESS_RESULT http_conn::on_sql_complete(bool ok) {
+    m_sql_pending = false;
+
+    request_tracer *tracer = request_tracer::current();
+    if (m_trace_id && tracer) {
+        tracer->record(m_trace_id, m_sockfd, TRACE_SQL_WAIT, m_sql_submit_ticks, trace_ticks());
+    }
+    trace_span span(m_trace_id, m_sockfd, TRACE_BUILD);
+
+    if (ok) {
+        m_user_store->commit_cached(m_pending_user, m_pending_passwd);
+        strcpy(m_url, "/log.html");
+    } else {
+        strcpy(m_url, "/registerError.html");
+    }
+
+    if (!process_write(serve_page())) {
+        return PROCESS_ERROR;
+    }
+    m_state = 1;
+    WS_PROBE4(response__start, probe_reactor(), m_sockfd, m_status, m_bytes_to_send);
     return PROCESS_OK;
 }
 
@@ -647,6 +710,7 @@ http_conn::PROCESS_RESULT http_conn::process() {
 
 // 主写入函数
 int http_conn::write() {
+    trace_span span(m_trace_id, m_sockfd, TRACE_WRITE);
     if (m_use_sendfile) {
         return write_with_sendfile();
     }
@@ -659,6 +723,7 @@ int http_conn::write_with_mmap() {
     
     // 没有数据需要发送
     if (m_bytes_to_send == 0) {
+        unmap();
         Utils::modfd(m_epollfd, m_sockfd, EPOLLIN, m_trigger_mode);
         init();
         return 1;  // 写完成
@@ -700,6 +765,7 @@ int http_conn::write_with_mmap() {
         // 所有数据已发送完毕
         if (m_bytes_to_send <= 0) {
             unmap();
+            finish_request();
 
             // 长连接且对端未关闭，继续监听读事件
             if (m_keep_alive && !m_peer_closed) {
@@ -728,6 +794,7 @@ int http_conn::write_with_sendfile() {
             if (errno == ECONNRESET || errno == EPIPE || errno == EBADF) {
                 LOG_DEBUG("Connection error during writev: errno=%d, fd=%d", errno, m_sockfd);
             }
+            unmap();
             return -1;  // 写错误
         }
         m_bytes_have_send += ret;
@@ -747,6 +814,7 @@ int http_conn::write_with_sendfile() {
             if (errno == ECONNRESET || errno == EPIPE || errno == EBADF) {
                 LOG_DEBUG("Connection error during sendfile: errno=%d, fd=%d", errno, m_sockfd);
             }
+            unmap();
             return -1;  // 写错误
         }
         m_sendfile_remaining -= ret;
@@ -760,6 +828,7 @@ int http_conn::write_with_sendfile() {
 
     // 步骤4: 所有数据发送完毕
     unmap();
+    finish_request();
 
     // 长连接且对端未关闭，继续监听读事件
     if (m_keep_alive && !m_peer_closed) {
@@ -769,4 +838,52 @@ int http_conn::write_with_sendfile() {
     // 短连接或对端已关闭，由外层处理关闭
 
     return 1;  // 写完成
-}
\ No newline at end of file
+}
+
+// ========== 访问日志与指标 ==========
+
+// 只写本 SubReactor 的计数器和映射环；访问日志按采样判断，都不记录时不再取时间
+void http_conn::finish_request() {
+    request_tracer *tracer = request_tracer::current();
+    if (m_trace_id && tracer) {
+        tracer->record(m_trace_id, m_sockfd, TRACE_REQUEST, m_trace_start, trace_ticks());
+    }
+
+    reactor_metrics *metrics = reactor_metrics::current();
+    access_log *alog = access_log::current();
+    bool logged = alog && alog->sampled(m_status);
+    if (!metrics && !logged) {
+        return;
+    }
+    uint32_t latency_us = m_request_start_ns ? (uint32_t)((mono_ns() - m_request_start_ns) / 1000) : 0;
+    WS_PROBE5(write__complete, metrics ? metrics->reactor : -1, m_sockfd, m_status, m_response_bytes, latency_us);
+
+    if (metrics) {
+        metrics->requests[reactor_metrics::status_slot(m_status)].add();
+        (m_use_sendfile ? metrics->bytes_sendfile : metrics->bytes_mmap).add(m_response_bytes);
+        metrics->latency.record(latency_us);
+    }
+    if (logged) {
+        if (m_req_path) {
+            alog->record(m_address, m_method, m_http_minor, m_req_path, m_req_path_len,
+                         m_status, m_response_bytes, latency_us);
+        } else {
+            alog->record(m_address, m_method, m_http_minor, "-", 1, m_status, m_response_bytes, latency_us);
+        }
+    }
+}
+
+// 按追踪器的采样率决定本请求是否追踪；连接的第一个请求顺带记下它在待处理队列中等待的时间
+void http_conn::begin_trace() {
+    request_tracer *tracer = request_tracer::current();
+    if (tracer) {
+        m_trace_id = tracer->begin_request();
+        if (m_trace_id) {
+            m_trace_start = trace_ticks();
+            if (m_queued_ticks) {
+                tracer->record(m_trace_id, m_sockfd, TRACE_QUEUE, m_queued_ticks, m_dequeued_ticks);
+            }
+        }
+    }
+    m_queued_ticks = 0;
+}
@@ -23,9 +23,13 @@
 #include <sys/sendfile.h>
 #include <map>
 
-#include "../mydb/sql_connection_pool.h"
+#include "../mydb/async_sql.h"
+#include "../userstore/user_store.h"
 #include "../timer/lst_timer.h"
 #include "../log/log.h"
+#include "../log/access_log.h"
+#include "../metrics/metrics.h"
+#include "../metrics/trace.h"
 
 extern "C" {
     #include "picohttpparser/picohttpparser.h"
@@ -53,7 +57,8 @@ public:
         FORBIDDEN_REQUEST,    // 没有访问权限
         FILE_REQUEST,         // 文件请求成功
         INTERNAL_ERROR,       // 服务器内部错误
-        CLOSED_CONNECTION     // 客户端已关闭连接
+        CLOSED_CONNECTION,    // 客户端已关闭连接
+        PENDING_REQUEST       // 等待数据库异步查询完成
     };
     
     // URL路由常量
@@ -71,37 +76,48 @@ public:
     enum PROCESS_RESULT {
         PROCESS_OK = 0,         // 处理成功，等待写事件
         PROCESS_ERROR = -1,      // 处理失败，需要关闭连接
-        PROCESS_CONTINUE = 1     // 请求不完整，需要继续读取
+        PROCESS_CONTINUE = 1,    // 请求不完整，需要继续读取
+        PROCESS_PENDING = 2      // 等待数据库异步完成，期间不监听该连接
     };
 
 public:
-    http_conn() {}
-    ~http_conn() {}
+    http_conn() : m_file_address(nullptr), m_use_sendfile(false), m_file_fd(-1) {}
+    // 连接可能在响应写到一半时被关闭（写停滞期限、写错误、对端断开），映射或 sendfile 的文件随对象释放
+    ~http_conn() { unmap(); }
 
     // ========== 公共接口 ==========
     void init(int sockfd, const sockaddr_in &addr, char *root, int TRIGMode,
               int close_log, std::string user, std::string passwd, std::string sqlname,
-              int epollfd);
+              int epollfd, UserStore *user_store, async_sql_executor *async_sql);
     
     int read_once();
     int write();  // 1: 写完成, 0: 需要继续写, -1: 写错误
     PROCESS_RESULT process();
+
+    // 异步数据库查询完成，继续构建响应
+    PROCESS_RESULT on_sql_complete(bool ok);
+    bool is_sql_pending() { return m_sql_pending; }
+    // 当前请求的请求头是否已读完（请求不完整时用于区分读头/读体期限）
+    bool headers_complete() { return m_headers_done; }
+    // 读缓冲区中已有的字节数
+    long get_read_idx() { return m_read_idx; }
     
     sockaddr_in *get_address() { return &m_address; }
+    // 连接在 SubReactor 待处理队列中的入队/出队时间（TSC），第一个请求被追踪时记为 queue 阶段
+    void set_queue_ticks(uint64_t queued, uint64_t dequeued) { m_queued_ticks = queued; m_dequeued_ticks = dequeued; }
     bool is_keep_alive() { return m_keep_alive; }
+    // 写完成后连接是否已重置为读下一个请求（长连接）
+    bool is_reset_for_next() { return m_state == 0; }
 
     // ========== epollfd改为成员变量 ==========
     int m_epollfd;
 
-    // ========== 静态方法 ==========
-    // 初始化数据库用户数据表（静态方法）
-    static void init_database_users(connection_pool *connPool);
-
     // 连接计数管理（可以外部维护）
     // static int m_user_count;  // 移除，改为外部管理
 
-    // ========== 数据库连接 ==========
-    MYSQL *mysql;
+    // ========== 用户存储 ==========
+    UserStore *m_user_store;
+    async_sql_executor *m_async_sql;  // 非空时注册走SubReactor事件循环驱动的非阻塞查询
     
     // ========== 读写状态 ==========
     int m_state;  // 0: 读, 1: 写
@@ -110,6 +126,9 @@ public:
     bool m_peer_closed;  // 对端是否已经关闭
 
 private:
+    // 基准测试（bench/http_bench.cpp）绕过 socket 直接驱动解析与响应构建
+    friend class http_conn_bench;
+
     // ========== 初始化 ==========
     void init();
     
@@ -121,9 +140,9 @@ private:
     
     // ========== 请求处理 ==========
     HTTP_CODE do_request();
+    HTTP_CODE serve_page();
     HTTP_CODE handle_cgi_request(char route_flag);
-    bool handle_user_login(const char *name, const char *password);
-    bool handle_user_register(const char *name, const char *password);
+    bool submit_user_register(const char *name, const char *password);
     void route_to_page(char route_type);
     
     // ========== 响应构建 ==========
@@ -132,6 +151,7 @@ private:
     bool add_status_line(int status, const char *title);
     bool add_headers(int content_length);
     bool add_content_length(int content_length);
+    bool add_date_header();
     bool add_connection_header();
     bool add_blank_line();
     bool add_content(const char *content);
@@ -143,6 +163,10 @@ private:
     // ========== 文件处理 ==========
     void unmap();
 
+    // ========== 访问日志与指标 ==========
+    void finish_request();   // 响应写完时调用，在 init() 重置请求信息之前
+    void begin_trace();      // 新请求第一次读时调用
+
 private:
     // ========== 连接信息 ==========
     int m_sockfd;
@@ -165,9 +189,30 @@ private:
     long m_content_length;
     bool m_keep_alive;  // 改名: m_linger -> m_keep_alive
     
+    // ========== 访问日志与指标 ==========
+    const char *m_req_path;      // 请求行中的原始路径（指向读缓冲区，m_url 可能被路由改写）
+    size_t m_req_path_len;
+    int m_http_minor;
+    int m_status;                // 响应状态码
+    long m_response_bytes;       // 响应总字节数
+    long long m_request_start_ns;   // 读到请求第一个字节的时间，0 表示未开启指标和访问日志
+
+    // ========== 阶段追踪 ==========
+    uint32_t m_trace_id;         // 被采样的请求编号，0 表示本请求不追踪
+    uint64_t m_trace_start;      // 请求开始的 TSC
+    uint64_t m_sql_submit_ticks; // 提交异步查询的 TSC
+    uint64_t m_queued_ticks;     // 连接级：入队/出队时间，只对第一个请求有效
+    uint64_t m_dequeued_ticks;
+
     // ========== POST请求相关 ==========
     bool m_is_post_form;  // 改名: cgi -> m_is_post_form
     char *m_request_body; // 改名: m_string -> m_request_body
+
+    // ========== 异步注册 ==========
+    bool m_sql_pending;          // 是否在等待异步查询
+    bool m_headers_done;         // 请求头已完整解析
+    char m_pending_user[100];
+    char m_pending_passwd[100];
     
     // ========== 响应文件信息 ==========
     char m_real_file_path[FILENAME_LEN];  // 改名: m_real_file -> m_real_file_path
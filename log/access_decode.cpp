@@ -0,0 +1,127 @@
+// 访问日志转换：把各 SubReactor 的 access.N.ring 合并，按时间顺序输出 Common/Combined Log Format
+// 用法：./access_decode [-c] [-t] logs/access.*.ring > access.log
+//   -c  Combined Log Format（未记录 Referer/User-Agent，输出 "-"）
+//   -t  行尾追加处理耗时（微秒）和 SubReactor 编号
+// 服务器运行中也可以读取：正在被覆盖的槽序号对不上，直接跳过
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <arpa/inet.h>
+#include <algorithm>
+#include <vector>
+#include "access_log.h"
+#include "../utils/seq_ring.h"
+
+static const char *method_name(int method) {
+    static const char *const names[] = {"GET", "POST", "HEAD", "PUT", "DELETE", "TRACE", "OPTIONS", "CONNECT", "PATCH"};
+    return method >= 0 && method < (int)(sizeof(names) / sizeof(names[0])) ? names[method] : "-";
+}
+
+// 读出一个环文件中仍然有效的记录，按序号从旧到新
+static bool load(const char *path, std::vector<access_record> *out) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        perror(path);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < ACCESS_HEADER_SIZE) {
+        fprintf(stderr, "%s: not an access log\n", path);
+        close(fd);
+        return false;
+    }
+    void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror(path);
+        return false;
+    }
+
+    const access_log_header *header = (const access_log_header *)map;
+    bool ok = memcmp(header->magic, ACCESS_LOG_MAGIC, sizeof(header->magic)) == 0 &&
+              header->record_size == sizeof(access_record) &&
+              ACCESS_HEADER_SIZE + header->capacity * sizeof(access_record) == (size_t)st.st_size;
+    if (!ok) {
+        fprintf(stderr, "%s: not an access log\n", path);
+        munmap(map, st.st_size);
+        return false;
+    }
+
+    const access_record *records = (const access_record *)((const char *)map + ACCESS_HEADER_SIZE);
+    uint64_t capacity = header->capacity;
+    uint64_t next = header->next_seq.load(std::memory_order_acquire);
+    uint64_t first = next > capacity ? next - capacity : 0;
+    for (uint64_t seq = first; seq < next; seq++) {
+        const access_record *slot = &records[seq % capacity];
+        if (!seq_slot_ready(&slot->seq, seq + 1))
+            continue;
+        access_record rec;
+        memcpy(&rec, slot, sizeof(rec));
+        // 复制期间被覆盖
+        if (!seq_slot_unchanged(&slot->seq, seq + 1))
+            continue;
+        out->push_back(rec);
+    }
+    munmap(map, st.st_size);
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    bool combined = false;
+    bool timing = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "ct")) != -1) {
+        switch (opt) {
+            case 'c': combined = true; break;
+            case 't': timing = true; break;
+            default:
+                fprintf(stderr, "usage: %s [-c] [-t] <access.N.ring>...\n", argv[0]);
+                return 1;
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "usage: %s [-c] [-t] <access.N.ring>...\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<access_record> records;
+    int ret = 0;
+    for (int i = optind; i < argc; i++) {
+        if (!load(argv[i], &records))
+            ret = 1;
+    }
+
+    // 各 SubReactor 的环分别有序，合并后按完成时间排序
+    std::stable_sort(records.begin(), records.end(), [](const access_record &a, const access_record &b) {
+        return a.time_ns < b.time_ns;
+    });
+
+    time_t cached_sec = -1;
+    char stamp[64] = "";
+    for (const access_record &rec : records) {
+        time_t sec = rec.time_ns / 1000000000ULL;
+        if (sec != cached_sec) {
+            struct tm tm;
+            localtime_r(&sec, &tm);
+            strftime(stamp, sizeof(stamp), "%d/%b/%Y:%H:%M:%S %z", &tm);
+            cached_sec = sec;
+        }
+        struct in_addr addr;
+        addr.s_addr = rec.addr;
+        int url_len = rec.url_len < ACCESS_URL_LEN ? rec.url_len : (int)ACCESS_URL_LEN;
+
+        printf("%s - - [%s] \"%s %.*s HTTP/1.%d\" %d %u", inet_ntoa(addr), stamp, method_name(rec.method),
+               url_len, rec.url, rec.http_minor, rec.status, rec.bytes);
+        if (combined)
+            printf(" \"-\" \"-\"");
+        if (timing)
+            printf(" %u %d", rec.latency_us, rec.reactor);
+        putchar('\n');
+    }
+    return ret;
+}
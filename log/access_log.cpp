@@ -0,0 +1,112 @@
+#include "access_log.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "log.h"
+#include "../utils/seq_ring.h"
+
+thread_local access_log *access_log::t_current = nullptr;
+
+access_log::access_log()
+    : m_fd(-1), m_map(nullptr), m_map_size(0), m_header(nullptr), m_records(nullptr),
+      m_capacity(0), m_next_seq(0), m_reactor(0), m_sample_every(1), m_sample_count(0) {}
+
+access_log::~access_log() {
+    close();
+}
+
+bool access_log::open(const char *path, int reactor, size_t capacity, int sample_every) {
+    close();
+    m_reactor = reactor;
+    m_sample_every = sample_every;
+    m_capacity = capacity;
+    m_map_size = ACCESS_HEADER_SIZE + capacity * sizeof(access_record);
+
+    m_fd = ::open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (m_fd < 0) {
+        LOG_ERROR("access log: open %s failed: %s", path, strerror(errno));
+        return false;
+    }
+
+    // 同样大小、同样格式的文件接着上次的序号写，否则重新初始化
+    struct stat st;
+    bool reuse = fstat(m_fd, &st) == 0 && (size_t)st.st_size == m_map_size;
+    if (!reuse && ftruncate(m_fd, m_map_size) != 0) {
+        LOG_ERROR("access log: ftruncate %s failed: %s", path, strerror(errno));
+        close();
+        return false;
+    }
+
+    void *map = mmap(nullptr, m_map_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (map == MAP_FAILED) {
+        LOG_ERROR("access log: mmap %s failed: %s", path, strerror(errno));
+        m_map = nullptr;
+        close();
+        return false;
+    }
+    m_map = (char *)map;
+    m_header = (access_log_header *)m_map;
+    m_records = (access_record *)(m_map + ACCESS_HEADER_SIZE);
+
+    if (reuse && memcmp(m_header->magic, ACCESS_LOG_MAGIC, sizeof(m_header->magic)) == 0 &&
+        m_header->record_size == sizeof(access_record) && m_header->capacity == capacity) {
+        m_next_seq = m_header->next_seq.load(std::memory_order_relaxed);
+    } else {
+        memset(m_map, 0, m_map_size);
+        memcpy(m_header->magic, ACCESS_LOG_MAGIC, sizeof(m_header->magic));
+        m_header->record_size = sizeof(access_record);
+        m_header->capacity = capacity;
+        m_next_seq = 0;
+        m_header->next_seq.store(0, std::memory_order_relaxed);
+    }
+    m_header->reactor = reactor;
+
+    LOG_INFO("access log: %s, %zu records, sample 1/%d", path, capacity, sample_every);
+    return true;
+}
+
+void access_log::close() {
+    if (m_map) {
+        munmap(m_map, m_map_size);
+        m_map = nullptr;
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    m_header = nullptr;
+    m_records = nullptr;
+}
+
+// 单写者：先把槽的序号清零，写完其余字段后再写序号，读者看到的序号与期望一致即为完整记录
+void access_log::record(const sockaddr_in &addr, int method, int http_minor, const char *url, size_t url_len,
+                        int status, uint64_t bytes, uint32_t latency_us) {
+    if (!m_records)
+        return;
+
+    uint64_t seq = m_next_seq++;
+    access_record *rec = &m_records[seq % m_capacity];
+    seq_slot_open(&rec->seq);
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME_COARSE, &now);
+    rec->time_ns = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+    rec->latency_us = latency_us;
+    rec->bytes = bytes > UINT32_MAX ? UINT32_MAX : (uint32_t)bytes;
+    rec->addr = addr.sin_addr.s_addr;
+    rec->status = (uint16_t)status;
+    rec->url_len = url_len > UINT16_MAX ? UINT16_MAX : (uint16_t)url_len;
+    rec->method = (uint8_t)method;
+    rec->reactor = (uint8_t)m_reactor;
+    rec->http_minor = (uint8_t)http_minor;
+    rec->reserved = 0;
+    memcpy(rec->url, url, url_len < ACCESS_URL_LEN ? url_len : ACCESS_URL_LEN);
+
+    seq_slot_publish(&rec->seq, seq + 1);
+    m_header->next_seq.store(seq + 1, std::memory_order_release);
+}
@@ -0,0 +1,82 @@
+#ifndef ACCESS_LOG_H
+#define ACCESS_LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <netinet/in.h>
+
+// 访问日志：每个 SubReactor 一个 mmap 的环形文件，每个请求一条定长二进制记录
+// 请求完成时只做一次 memcpy 到映射内存，不格式化、不加锁、不调用系统调用，由内核异步回写
+// 环满后覆盖最旧的记录；用 access_decode 转成 Common/Combined Log Format
+
+#define ACCESS_LOG_MAGIC "WSACC1\n"
+static const size_t ACCESS_URL_LEN = 92;
+static const size_t ACCESS_HEADER_SIZE = 4096;   // 文件头占一页，记录从页边界开始
+
+// 128 字节一条，两条占一个缓存行对
+struct access_record {
+    uint64_t seq;               // 序号 + 1，0 表示空槽；其余字段写完后才写入，读者据此判断记录完整
+    uint64_t time_ns;           // 请求完成时的墙上时间
+    uint32_t latency_us;        // 读到请求第一个字节到响应写完
+    uint32_t bytes;             // 响应字节数（含响应头）
+    uint32_t addr;              // 客户端 IPv4，网络字节序
+    uint16_t status;
+    uint16_t url_len;           // 原始长度，超过 ACCESS_URL_LEN 的部分截断
+    uint8_t method;             // http_conn::METHOD
+    uint8_t reactor;
+    uint8_t http_minor;         // HTTP/1.x 的 x
+    uint8_t reserved;
+    char url[ACCESS_URL_LEN];   // 请求行中的原始路径，不以 0 结尾
+};
+static_assert(sizeof(access_record) == 128, "access_record must stay 128 bytes");
+
+struct access_log_header {
+    char magic[8];
+    uint32_t record_size;
+    uint32_t reactor;
+    uint64_t capacity;                  // 记录数
+    std::atomic<uint64_t> next_seq;     // 下一条记录的序号（只有所属 SubReactor 写）
+};
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "next_seq is read by other processes");
+
+class access_log {
+public:
+    access_log();
+    ~access_log();
+    access_log(const access_log&) = delete;
+    access_log& operator=(const access_log&) = delete;
+
+    // 打开（或续用）环形文件；sample_every 为 N 时 2xx/3xx 每 N 个请求记一条，4xx/5xx 全部记录
+    bool open(const char *path, int reactor, size_t capacity, int sample_every);
+    void close();
+    bool is_open() const { return m_records != nullptr; }
+
+    // 请求完成时判断是否记录，不记录的请求不再取结束时间
+    bool sampled(int status) {
+        return status >= 400 || m_sample_every <= 1 || ++m_sample_count % (unsigned)m_sample_every == 0;
+    }
+
+    void record(const sockaddr_in &addr, int method, int http_minor, const char *url, size_t url_len,
+                int status, uint64_t bytes, uint32_t latency_us);
+
+    // 当前线程所属 SubReactor 的访问日志（未开启为 nullptr）
+    static access_log *current() { return t_current; }
+    static void set_current(access_log *log) { t_current = log; }
+
+private:
+    int m_fd;
+    char *m_map;
+    size_t m_map_size;
+    access_log_header *m_header;
+    access_record *m_records;
+    uint64_t m_capacity;
+    uint64_t m_next_seq;        // 本线程维护的序号，写完一条再发布到文件头
+    int m_reactor;
+    int m_sample_every;
+    unsigned m_sample_count;
+
+    static thread_local access_log *t_current;
+};
+
+#endif
@@ -0,0 +1,206 @@
+#include "flight_recorder.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include "log.h"
+
+int flight_registry::s_notify_fd = -1;
+
+void flight_recorder::init(int reactor, size_t capacity) {
+    size_t size = 1;
+    while (size < capacity)
+        size <<= 1;
+    m_reactor = reactor;
+    m_mask = size - 1;
+    delete[] m_events;
+    m_events = new flight_event[size]();
+    m_head.store(0, std::memory_order_relaxed);
+}
+
+void flight_recorder::snapshot(std::vector<flight_event> &out) const {
+    if (!m_events)
+        return;
+    uint64_t capacity = m_mask + 1;
+    std::vector<flight_event> copy(capacity);
+
+    uint64_t before = m_head.load(std::memory_order_acquire);
+    memcpy(copy.data(), m_events, capacity * sizeof(flight_event));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t after = m_head.load(std::memory_order_relaxed);
+
+    // 复制期间写入的 [before, after) 以及正在写的 after 号覆盖了最旧的一段
+    uint64_t first = after + 1 > capacity ? after + 1 - capacity : 0;
+    for (uint64_t seq = first; seq < before; seq++)
+        out.push_back(copy[seq & m_mask]);
+}
+
+flight_registry *flight_registry::instance() {
+    static flight_registry registry;
+    return &registry;
+}
+
+void flight_registry::add_recorder(const flight_recorder *recorder) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_recorders.push_back(recorder);
+}
+
+void flight_registry::remove_recorder(const flight_recorder *recorder) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < m_recorders.size(); i++) {
+        if (m_recorders[i] == recorder) {
+            m_recorders.erase(m_recorders.begin() + i);
+            return;
+        }
+    }
+}
+
+// ========== SIGUSR2 ==========
+
+// 信号可能落在任意线程上：处理函数只写 eventfd，转储由主 Reactor 完成
+void flight_registry::handle_signal(int) {
+    int saved = errno;
+    uint64_t one = 1;
+    if (s_notify_fd >= 0 && write(s_notify_fd, &one, sizeof(one)) < 0) {
+        // 计数溢出才会失败，忽略
+    }
+    errno = saved;
+}
+
+int flight_registry::install_signal() {
+    if (s_notify_fd < 0)
+        s_notify_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (s_notify_fd < 0) {
+        LOG_ERROR("flight recorder: eventfd failed: %s", strerror(errno));
+        return -1;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_signal;
+    sa.sa_flags = SA_RESTART;
+    sigfillset(&sa.sa_mask);
+    sigaction(SIGUSR2, &sa, nullptr);
+    return s_notify_fd;
+}
+
+void flight_registry::on_signal() {
+    uint64_t count;
+    if (read(s_notify_fd, &count, sizeof(count)) < 0)
+        return;
+    dump("./logs");
+}
+
+// ========== 转储 ==========
+
+namespace {
+
+const char *const EVENT_NAMES[FR_EVENT_TYPES] = {
+    "accept", "epoll", "read", "process", "write", "timer", "close", "missing", "sql_done"
+};
+
+const char *const CLOSE_REASONS[FR_CLOSE_REASONS] = {
+    "process_error", "read_error", "peer_closed_incomplete", "peer_closed_done", "short_connection",
+    "write_error", "epoll_hup_err", "timer", "sql_error", "coroutine_done"
+};
+
+const char *const PROCESS_RESULTS[] = {"error", "ok", "continue", "pending"};   // 下标 = PROCESS_RESULT + 1
+const char *const CONN_PHASES[] = {"header", "body", "write", "idle"};
+
+void format_epoll_mask(char *buf, size_t len, int mask) {
+    snprintf(buf, len, "0x%x%s%s%s%s%s", mask,
+             (mask & EPOLLIN) ? " IN" : "", (mask & EPOLLOUT) ? " OUT" : "",
+             (mask & EPOLLRDHUP) ? " RDHUP" : "", (mask & EPOLLHUP) ? " HUP" : "",
+             (mask & EPOLLERR) ? " ERR" : "");
+}
+
+void format_detail(char *buf, size_t len, const flight_event &ev) {
+    char mask[64];
+    switch (ev.type) {
+        case FR_ACCEPT:
+            snprintf(buf, len, "port=%d", ev.arg);
+            break;
+        case FR_MISSING:
+            snprintf(buf, len, "not found in maps");
+            break;
+        case FR_EPOLL:
+            format_epoll_mask(mask, sizeof(mask), ev.arg);
+            snprintf(buf, len, "events=%s", mask);
+            break;
+        case FR_READ:
+            snprintf(buf, len, "ret=%d buffered=%d", (int)ev.extra - 1, ev.arg);
+            break;
+        case FR_PROCESS:
+            snprintf(buf, len, "result=%s", ev.arg >= -1 && ev.arg <= 2 ? PROCESS_RESULTS[ev.arg + 1] : "?");
+            break;
+        case FR_WRITE:
+            snprintf(buf, len, "ret=%d%s", ev.arg, ev.arg == 1 ? " (done)" : ev.arg == 0 ? " (partial)" : " (error)");
+            break;
+        case FR_TIMER:
+            snprintf(buf, len, "phase=%s", ev.arg >= 0 && ev.arg <= 3 ? CONN_PHASES[ev.arg] : "?");
+            break;
+        case FR_CLOSE:
+            snprintf(buf, len, "reason=%s", ev.arg >= 0 && ev.arg < FR_CLOSE_REASONS ? CLOSE_REASONS[ev.arg] : "?");
+            break;
+        case FR_SQL_DONE:
+            snprintf(buf, len, "ok=%d", ev.arg);
+            break;
+        default:
+            snprintf(buf, len, "arg=%d extra=%d", ev.arg, ev.extra);
+            break;
+    }
+}
+
+}
+
+// 事件只存单调时钟毫秒的低 32 位，按与当前时刻的差值换算成墙上时间
+bool flight_registry::dump(const char *dir) {
+    struct timespec mono, wall;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &mono);
+    clock_gettime(CLOCK_REALTIME, &wall);
+    uint32_t now_ms = (uint32_t)((long long)mono.tv_sec * 1000 + mono.tv_nsec / 1000000);
+    long long wall_ms = (long long)wall.tv_sec * 1000 + wall.tv_nsec / 1000000;
+
+    struct tm tm_now;
+    localtime_r(&wall.tv_sec, &tm_now);
+    char path[256];
+    snprintf(path, sizeof(path), "%s/flight.%d.%04d%02d%02d-%02d%02d%02d.txt", dir, (int)getpid(),
+             tm_now.tm_year + 1900, tm_now.tm_mon + 1, tm_now.tm_mday, tm_now.tm_hour, tm_now.tm_min, tm_now.tm_sec);
+
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        LOG_ERROR("flight recorder: open %s failed: %s", path, strerror(errno));
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t total = 0;
+    std::vector<flight_event> events;
+    for (const flight_recorder *recorder : m_recorders) {
+        events.clear();
+        recorder->snapshot(events);
+        fprintf(fp, "# SubReactor %d: %zu events\n", recorder->reactor(), events.size());
+
+        for (const flight_event &ev : events) {
+            long long at = wall_ms - (long long)(uint32_t)(now_ms - ev.ms);
+            time_t sec = (time_t)(at / 1000);
+            struct tm tm_ev;
+            localtime_r(&sec, &tm_ev);
+            char detail[128];
+            format_detail(detail, sizeof(detail), ev);
+            fprintf(fp, "%02d:%02d:%02d.%03d R%d fd=%-5d %-8s %s\n", tm_ev.tm_hour, tm_ev.tm_min, tm_ev.tm_sec,
+                    (int)(at % 1000), recorder->reactor(), ev.fd,
+                    ev.type < FR_EVENT_TYPES ? EVENT_NAMES[ev.type] : "?", detail);
+        }
+        total += events.size();
+    }
+    fclose(fp);
+
+    LOG_INFO("flight recorder: %zu events written to %s", total, path);
+    return true;
+}
@@ -0,0 +1,110 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+// 连接飞行记录器：每个 SubReactor 一个定长事件环，始终开启
+// 记录一条事件只是几次普通写加一次 relaxed 的头指针更新，时间取事件循环缓存的时钟，不做系统调用
+// kill -USR2 <pid> 后由主 Reactor 把所有环写到 ./logs/flight.<pid>.<时间>.txt，用于事后排查连接级问题
+
+enum FLIGHT_EVENT {
+    FR_ACCEPT = 0,          // 连接交给 SubReactor：arg = 客户端端口
+    FR_EPOLL,               // epoll 事件：arg = 事件掩码
+    FR_READ,                // read_once：arg = 读缓冲区已有字节数，extra = 返回值 + 1
+    FR_PROCESS,             // process / on_sql_complete：arg = PROCESS_RESULT
+    FR_WRITE,               // write：arg = 返回值
+    FR_TIMER,               // 期限到期：arg = 当时所处的连接阶段
+    FR_CLOSE,               // 关闭：arg = FLIGHT_CLOSE_REASON
+    FR_MISSING,             // 事件到达但连接不在表中（"not found in maps"）
+    FR_SQL_DONE,            // 异步查询完成：arg = 是否成功
+    FR_EVENT_TYPES
+};
+
+enum FLIGHT_CLOSE_REASON {
+    FR_CLOSE_PROCESS_ERROR = 0,     // 构建响应失败
+    FR_CLOSE_READ_ERROR,            // recv 出错或读缓冲区满
+    FR_CLOSE_PEER_INCOMPLETE,       // 对端关闭，请求不完整
+    FR_CLOSE_PEER_DONE,             // 对端已关闭，最后的响应已写完
+    FR_CLOSE_SHORT_CONN,            // 短连接响应写完
+    FR_CLOSE_WRITE_ERROR,           // 写出错
+    FR_CLOSE_EXCEPTION,             // EPOLLHUP / EPOLLERR
+    FR_CLOSE_TIMER,                 // 期限到期
+    FR_CLOSE_SQL_ERROR,             // 异步查询完成后构建响应失败
+    FR_CLOSE_COROUTINE,             // 协程结束（错误、短连接或对端关闭）
+    FR_CLOSE_REASONS
+};
+
+// 16 字节一条
+struct flight_event {
+    uint32_t ms;            // 单调时钟毫秒的低 32 位
+    int32_t fd;
+    int32_t arg;
+    uint16_t type;
+    uint16_t extra;
+};
+
+class flight_recorder {
+public:
+    flight_recorder() : m_reactor(0), m_mask(0), m_events(nullptr) {}
+    ~flight_recorder() { delete[] m_events; }
+
+    // capacity 取 2 的幂
+    void init(int reactor, size_t capacity);
+
+    // 只由所属 SubReactor 线程调用
+    void record(long long mono_ms, FLIGHT_EVENT type, int fd, int arg, int extra = 0) {
+        uint64_t head = m_head.load(std::memory_order_relaxed);
+        flight_event &ev = m_events[head & m_mask];
+        ev.ms = (uint32_t)mono_ms;
+        ev.fd = fd;
+        ev.arg = arg;
+        ev.type = (uint16_t)type;
+        ev.extra = (uint16_t)extra;
+        m_head.store(head + 1, std::memory_order_release);
+    }
+
+    // 其他线程调用：先读头指针、复制整个环、再读一次头指针，丢掉复制期间可能被覆盖的最旧部分
+    void snapshot(std::vector<flight_event> &out) const;
+
+    int reactor() const { return m_reactor; }
+
+private:
+    int m_reactor;
+    uint64_t m_mask;
+    flight_event *m_events;
+    std::atomic<uint64_t> m_head{0};
+
+    flight_recorder(const flight_recorder &) = delete;
+    flight_recorder &operator=(const flight_recorder &) = delete;
+};
+
+// 登记表与 SIGUSR2 转储
+class flight_registry {
+public:
+    static flight_registry *instance();
+
+    void add_recorder(const flight_recorder *recorder);
+    void remove_recorder(const flight_recorder *recorder);
+
+    // 创建 eventfd 并安装 SIGUSR2 处理函数，返回的 fd 由主 Reactor 加入 epoll
+    int install_signal();
+    // eventfd 可读时调用：清除通知并写转储文件
+    void on_signal();
+
+    // 写到 dir/flight.<pid>.<时间>.txt，返回是否成功
+    bool dump(const char *dir);
+
+private:
+    flight_registry() {}
+
+    static void handle_signal(int sig);
+    static int s_notify_fd;
+
+    std::mutex m_mutex;
+    std::vector<const flight_recorder *> m_recorders;
+};
+
+#endif
@@ -2,143 +2,718 @@
 #include <time.h>
 #include <sys/time.h>
 #include <stdarg.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
 #include "log.h"
+#include "../utils/clock.h"
 #include <pthread.h>
+#include <algorithm>
 using namespace std;
 
+static const size_t LOG_RING_SIZE = 256 * 1024;   // 每个线程的日志环大小
+static const int LOG_IDLE_MS = 1000;              // 写线程空闲时的最长睡眠（兜底，正常由生产者唤醒）
+static const unsigned LOG_SAMPLE_EVERY = 16;      // 采样策略下过半后保留的比例
+static const int64_t LOG_DROP_REPORT_NS = 1000000000LL;   // 丢弃汇总的最小间隔
+static const int LOG_MAX_IOV = 64;                // 单次 writev 合并的段数
+static const size_t LOG_OUT_SIZE = 256 * 1024;    // 延迟格式化时写线程的输出缓冲
+
+static const char *level_name(int level) {
+    switch (level) {
+        case 0: return "[debug]:";
+        case 2: return "[warn]:";
+        case 3: return "[error]:";
+        default: return "[info]:";
+    }
+}
+
+alignas(64) std::atomic<int> g_log_level{LOG_LEVEL_OFF};   // init 之前不输出；独占缓存行，只在改级别时写
+std::atomic<int> Log::s_base_level{LOG_LEVEL_INFO};
+
+namespace {
+// 线程退出时交还缓冲区：异步模式下由写线程取空后释放，同步模式下直接释放
+struct log_buffer_holder {
+    log_thread_buffer *buf = nullptr;
+    bool registered = false;
+    ~log_buffer_holder() {
+        if (!buf) return;
+        if (registered)
+            buf->retired.store(true, std::memory_order_release);
+        else
+            delete buf;
+    }
+};
+thread_local log_buffer_holder t_log_buffer;
+}
+
 Log::Log(){
     m_count = 0;
+    m_fd = -1;
     m_is_async = false;
+    m_defer_mode = DEFER_OFF;
+    m_close_log = 1;
+    m_out = nullptr;
+    m_out_len = 0;
+    m_out_lines = 0;
+    m_bytes = 0;
+    m_max_bytes = 0;
+    m_seq = 0;
+    m_keep_files = 0;
+    m_compress = false;
+    m_overflow_policy = OVERFLOW_BLOCK;
+    memset(m_dropped_retired, 0, sizeof(m_dropped_retired));
+    m_dropped_reported = 0;
+    m_drop_report_ns = 0;
+    m_out_size = 0;
+    m_scratch = nullptr;
 }
 
+// 线程缓冲区不在这里释放：进程退出时其他线程可能仍持有
 Log::~Log(){
-    if (m_fp != NULL)
-        fclose(m_fp);
+    if (m_thread.joinable()) {
+        m_exit_flag = true;
+        wake_writer();
+        m_thread.join();
+    }
+    m_archiver.stop();
+    if (m_fd >= 0)
+        close(m_fd);
+    delete[] m_out;
+    delete[] m_scratch;
 }
 
-bool Log::init(const char* file_name, int close_log, int log_buf_size,int split_lines, bool is_async) {
+bool Log::init(const char* file_name, int close_log, int log_buf_size,int split_lines, bool is_async, int defer_mode) {
     m_close_log = close_log;
     m_log_buf_size = log_buf_size;
-    m_buf = new char[m_log_buf_size];
-    memset(m_buf, 0, m_log_buf_size);
     m_split_lines = split_lines;
     m_is_async = is_async;
-    // 默认间隔一秒flush
-    m_flush_mode = FlushMode::Interval;
-    m_flush_interval_sec = 1; // 每秒 flush
-    m_debug_enable = 0; // 默认不开启DEBUG
+    // 延迟格式化依赖写线程
+    m_defer_mode = is_async ? defer_mode : DEFER_OFF;
+    // 默认不开启DEBUG，运行中可用 SIGUSR1 切换
+    s_base_level = close_log ? LOG_LEVEL_OFF : LOG_LEVEL_INFO;
 
     time_t t = time(NULL);
-    struct tm* sys_tm = localtime(&t);
-    struct tm my_tm = *sys_tm;
+    localtime_r(&t, &m_day);
 
     const char* p = strrchr(file_name, '/');
-    char log_full_name[256] = {0};
-
     if (p == nullptr) {
-        snprintf(log_full_name, 255, "%d_%02d_%02d_%s",
-                 my_tm.tm_year + 1900, my_tm.tm_mon + 1, my_tm.tm_mday, file_name);
         strcpy(log_name, file_name);
         dir_name[0] = '\0';
     } else {
         strcpy(log_name, p + 1);
         strncpy(dir_name, file_name, p - file_name + 1);
         dir_name[p - file_name + 1] = '\0';
-        snprintf(log_full_name, 255, "%s%d_%02d_%02d_%s",
-                 dir_name, my_tm.tm_year + 1900, my_tm.tm_mon + 1, my_tm.tm_mday, log_name);
     }
 
-    m_today = my_tm.tm_mday;
-    m_fp = fopen(log_full_name, "a");
-    if (m_fp == nullptr)
+    // 重启后接着当天已有的 .N 编号
+    m_today = m_day.tm_mday;
+    m_seq = 0;
+    for (;;) {
+        char probe[sizeof(m_path) + 4];
+        make_path(probe, sizeof(m_path), m_day, m_seq + 1);
+        struct stat st;
+        if (stat(probe, &st) != 0 && stat(strcat(probe, ".gz"), &st) != 0)
+            break;
+        m_seq++;
+    }
+
+    make_path(m_path, sizeof(m_path), m_day, 0);
+    if (!open_file())
         return false;
+    m_archiver.start(dir_name, log_name, m_keep_files, m_compress);
+    m_archiver.set_active(m_path);
 
-    if (m_is_async)
+    if (m_defer_mode != DEFER_OFF) {
+        m_out_size = LOG_OUT_SIZE;
+        m_out = new char[m_out_size];
+        m_scratch = new char[m_log_buf_size];
+        for (int level = 0; level < 4; level++)
+            m_text_site[level] = log_register_site(level, "%s", __FILE__, __LINE__);
+        // 二进制日志每次启动写一个文件头，调用点编号只在本次运行内有效
+        if (m_defer_mode == DEFER_BINARY)
+            write_site_defs();
+    }
+
+    if (m_is_async) {
+        m_drop_report_ns = now_ns();
         m_thread = std::thread(&Log::async_write_log, this);
+    }
 
+    g_log_level = s_base_level.load();
+    return true;
+}
+
+void Log::set_level(int level) {
+    if (m_close_log || level < LOG_LEVEL_DEBUG || level > LOG_LEVEL_OFF)
+        return;
+    s_base_level = level;
+    g_log_level = level;
+}
+
+void Log::toggle_debug(int) {
+    int base = s_base_level.load(std::memory_order_relaxed);
+    if (base == LOG_LEVEL_OFF)
+        return;
+    int level = g_log_level.load(std::memory_order_relaxed);
+    g_log_level.store(level == LOG_LEVEL_DEBUG ? base : LOG_LEVEL_DEBUG, std::memory_order_relaxed);
+}
+
+log_thread_buffer *Log::thread_buffer() {
+    if (t_log_buffer.buf)
+        return t_log_buffer.buf;
+
+    // 同步模式不经过环，只需要格式化缓冲区
+    log_thread_buffer *buf = new log_thread_buffer(m_log_buf_size, m_is_async ? LOG_RING_SIZE : 64);
+    t_log_buffer.buf = buf;
+    if (m_is_async) {
+        std::lock_guard<std::mutex> lock(m_buffers_mutex);
+        m_buffers.push_back(buf);
+        t_log_buffer.registered = true;
+    }
+    return buf;
+}
+
+void Log::set_overflow_policy(int policy) {
+    if (policy < OVERFLOW_BLOCK || policy > OVERFLOW_SAMPLE)
+        policy = OVERFLOW_BLOCK;
+    m_overflow_policy = policy;
+}
+
+void Log::wake_writer() {
+    m_writer_idle.store(false);
+    std::lock_guard<std::mutex> lock(m_cond_mutex);
+    m_cond.notify_one();
+}
+
+// 生产者写入环（release 写 tail）后与写线程的 m_writer_idle 构成 Dekker 式配对：
+// 两边各有一个 seq_cst 屏障，写线程要么看到新数据不睡，要么生产者看到它已空闲并唤醒
+// 写线程忙时生产者只多一次屏障和一次读，不碰锁也不调用 notify
+void Log::signal_writer() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_writer_idle.load(std::memory_order_relaxed) && m_writer_idle.exchange(false)) {
+        std::lock_guard<std::mutex> lock(m_cond_mutex);
+        m_cond.notify_one();
+    }
+}
+
+size_t Log::queued_bytes() {
+    std::lock_guard<std::mutex> lock(m_buffers_mutex);
+    size_t total = 0;
+    for (log_thread_buffer *buf : m_buffers)
+        total += buf->ring.size();
+    return total;
+}
+
+bool Log::rings_empty() {
+    std::lock_guard<std::mutex> lock(m_buffers_mutex);
+    for (log_thread_buffer *buf : m_buffers) {
+        if (!buf->ring.empty())
+            return false;
+    }
     return true;
 }
 
 // 工作线程异步写日志
 void Log::async_write_log() {
-    std::string log_line;
-    auto last_flush = std::chrono::steady_clock::now();
-
     while (!m_exit_flag) {
-        // 处理队列中的日志
-        while (m_log_queue.try_dequeue(log_line)) {
-            std::lock_guard<std::mutex> lock(m_file_mutex);
-            fputs(log_line.c_str(), m_fp);
-        }
+        // 取到数据就接着取：写文件期间积累的日志下一轮合并写出
+        if (drain())
+            continue;
 
-        // 刷盘逻辑
-        auto now = std::chrono::steady_clock::now();
-        if (m_flush_mode == FlushMode::Immediate) {
-            std::lock_guard<std::mutex> lock(m_file_mutex);
-            fflush(m_fp);
-            last_flush = now;
-        } else if (m_flush_mode == FlushMode::Interval) {
-            if (std::chrono::duration_cast<std::chrono::seconds>(now - last_flush).count() >= m_flush_interval_sec) {
-                std::lock_guard<std::mutex> lock(m_file_mutex);
-                fflush(m_fp);
-                last_flush = now;
-            }
+        m_writer_idle.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!rings_empty()) {
+            m_writer_idle.store(false, std::memory_order_relaxed);
+            continue;
         }
 
-        // 队列为空等待或短暂休眠，降低 CPU 占用
+        // 只有空闲之后第一个写入的生产者会唤醒；超时兜底用于补写丢弃汇总
         std::unique_lock<std::mutex> lock(m_cond_mutex);
-        m_cond.wait_for(lock, std::chrono::milliseconds(50));
+        m_cond.wait_for(lock, std::chrono::milliseconds(LOG_IDLE_MS),
+                        [this] { return !m_writer_idle.load() || m_exit_flag; });
+        m_writer_idle.store(false, std::memory_order_relaxed);
     }
 
     // 退出前把剩余日志写完
-    while (m_log_queue.try_dequeue(log_line)) {
-        std::lock_guard<std::mutex> lock(m_file_mutex);
-        fputs(log_line.c_str(), m_fp);
+    drain();
+}
+
+// 已退出线程的丢弃数并入 m_dropped_retired 后释放缓冲区
+void Log::release_retired(std::vector<log_thread_buffer*> &retired) {
+    for (log_thread_buffer *buf : retired) {
+        for (int level = 0; level < 4; level++)
+            m_dropped_retired[level] += buf->dropped[level].load(std::memory_order_relaxed);
+        m_buffers.erase(std::find(m_buffers.begin(), m_buffers.end(), buf));
+        delete buf;
     }
+}
+
+bool Log::drain() {
+    std::lock_guard<std::mutex> lock(m_buffers_mutex);
+    bool taken_any = false;
 
-    // 最后一次强制 flush
-    std::lock_guard<std::mutex> lock(m_file_mutex);
-    fflush(m_fp);
+    if (m_defer_mode != DEFER_OFF) {
+        std::vector<log_thread_buffer*> retired;
+        for (log_thread_buffer *buf : m_buffers) {
+            if (buf->retired.load(std::memory_order_acquire))
+                retired.push_back(buf);
+            if (!buf->ring.empty()) {
+                taken_any = true;
+                drain_records(buf);
+            }
+        }
+        out_flush();
+        report_drops();
+        release_retired(retired);
+        return taken_any;
+    }
+
+    struct iovec iov[LOG_MAX_IOV];
+    log_thread_buffer *taken_buf[LOG_MAX_IOV];
+    size_t taken_len[LOG_MAX_IOV];
+    int iov_count = 0;
+    int taken = 0;
+
+    auto write_batch = [&]() {
+        if (iov_count > 0) {
+            size_t bytes = 0, lines = 0;
+            for (int i = 0; i < iov_count; i++) {
+                const char *p = (const char *)iov[i].iov_base;
+                const char *end = p + iov[i].iov_len;
+                bytes += iov[i].iov_len;
+                while ((p = (const char *)memchr(p, '\n', end - p)) != nullptr) {
+                    lines++;
+                    p++;
+                }
+            }
+            before_write(bytes, lines);
+            write_all(iov, iov_count);
+        }
+        for (int i = 0; i < taken; i++)
+            taken_buf[i]->ring.consume(taken_len[i]);
+        iov_count = 0;
+        taken = 0;
+    };
+
+    // 先看线程是否已退出再取数据：退出前写入的日志这一轮一定能取到，取完即可释放
+    std::vector<log_thread_buffer*> retired;
+    for (log_thread_buffer *buf : m_buffers) {
+        if (buf->retired.load(std::memory_order_acquire))
+            retired.push_back(buf);
+
+        if (iov_count + 2 > LOG_MAX_IOV)
+            write_batch();
+        size_t total = 0;
+        int n = buf->ring.peek(iov + iov_count, &total);
+        if (n > 0) {
+            taken_any = true;
+            iov_count += n;
+            taken_buf[taken] = buf;
+            taken_len[taken] = total;
+            taken++;
+        }
+    }
+    write_batch();
+
+    report_drops();
+    release_retired(retired);
+    return taken_any;
 }
 
-void Log::write_log(int level, const char* format, ...) {
-    // 获取时间并格式化
-    struct timeval now;
-    gettimeofday(&now, NULL);
-    struct tm* sys_tm = localtime(&now.tv_sec);
+// 丢弃数只在变化时汇总一次，最多每秒一行，写在被丢弃的日志原本所在的位置附近
+void Log::report_drops() {
+    uint64_t by_level[4];
+    uint64_t total = 0;
+    for (int level = 0; level < 4; level++) {
+        by_level[level] = m_dropped_retired[level];
+        for (log_thread_buffer *buf : m_buffers)
+            by_level[level] += buf->dropped[level].load(std::memory_order_relaxed);
+        total += by_level[level];
+    }
+    m_dropped_total.store(total, std::memory_order_relaxed);
+    if (total == m_dropped_reported)
+        return;
+
+    int64_t now = now_ns();
+    if (now - m_drop_report_ns < LOG_DROP_REPORT_NS && !m_exit_flag)
+        return;
+
+    char text[256];
+    snprintf(text, sizeof(text),
+             "log overload: dropped %llu lines in the last %lld ms "
+             "(total debug %llu, info %llu, warn %llu, error %llu)",
+             (unsigned long long)(total - m_dropped_reported),
+             (long long)((now - m_drop_report_ns) / 1000000),
+             (unsigned long long)by_level[0], (unsigned long long)by_level[1],
+             (unsigned long long)by_level[2], (unsigned long long)by_level[3]);
+    m_dropped_reported = total;
+    m_drop_report_ns = now;
+    write_internal(LOG_LEVEL_WARN, text);
+}
+
+// 写线程产生的日志不经过环，按当前模式直接写出
+void Log::write_internal(int level, const char *text) {
+    if (m_defer_mode == DEFER_BINARY) {
+        char rec[512];
+        log_record_header header;
+        char *end = log_encode_args(rec + sizeof(header), rec + sizeof(rec), text);
+        header.size = (uint32_t)(end - rec);
+        header.site = (uint32_t)m_text_site[level];
+        header.time_ns = now_ns();
+        memcpy(rec, &header, sizeof(header));
+        out_binary_record(header, rec);
+        out_flush();
+        return;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    char line[512];
+    int len = snprintf(line, sizeof(line) - 1, "%s.%06ld %s %s", WallClock::log_time(now.tv_sec),
+                       now.tv_nsec / 1000, level_name(level), text);
+    if (len < 0)
+        return;
+    if (len > (int)sizeof(line) - 2)
+        len = sizeof(line) - 2;
+    line[len++] = '\n';
+
+    if (m_defer_mode == DEFER_TEXT) {
+        out_append(line, len);
+        m_out_lines++;
+        out_flush();
+        return;
+    }
+    before_write(len, 1);
+    struct iovec iov = {line, (size_t)len};
+    write_all(&iov, 1);
+}
+
+// 环中都是完整的记录；跨环尾的记录先拼到 m_scratch
+void Log::drain_records(log_thread_buffer *buf) {
+    struct iovec iov[2];
+    size_t total = 0;
+    int n = buf->ring.peek(iov, &total);
+    if (n == 0)
+        return;
 
-    const char* level_str = "[info]:";
-    switch(level){
-        case 0: level_str = "[debug]:"; break;
-        case 1: level_str = "[info]:"; break;
-        case 2: level_str = "[warn]:"; break;
-        case 3: level_str = "[error]:"; break;
+    auto copy_out = [&](size_t off, char *dst, size_t len) {
+        size_t first = off < iov[0].iov_len ? iov[0].iov_len - off : 0;
+        if (first > len) first = len;
+        if (first)
+            memcpy(dst, (char *)iov[0].iov_base + off, first);
+        if (len > first)
+            memcpy(dst + first, (char *)iov[1].iov_base + (off + first - iov[0].iov_len), len - first);
+    };
+
+    size_t off = 0;
+    while (off < total) {
+        log_record_header header;
+        copy_out(off, (char *)&header, sizeof(header));
+
+        const char *rec;
+        if (off + header.size <= iov[0].iov_len)
+            rec = (const char *)iov[0].iov_base + off;
+        else if (off >= iov[0].iov_len)
+            rec = (const char *)iov[1].iov_base + (off - iov[0].iov_len);
+        else {
+            copy_out(off, m_scratch, header.size);
+            rec = m_scratch;
+        }
+        off += header.size;
+
+        if (m_defer_mode == DEFER_BINARY) {
+            out_binary_record(header, rec);
+            continue;
+        }
+
+        // 文本：在写线程里格式化，直接写进输出缓冲
+        const log_site *site = log_get_site(header.site);
+        if (!site)
+            continue;
+        size_t room = m_log_buf_size + 64;
+        if (m_out_size - m_out_len < room)
+            out_flush();
+        char *line = m_out + m_out_len;
+        time_t sec = header.time_ns / 1000000000;
+        int len = snprintf(line, room, "%s.%06ld %s ", WallClock::log_time(sec),
+                           (long)(header.time_ns % 1000000000 / 1000), level_name(site->level));
+        len += log_format_args(site->format, rec + sizeof(header), header.size - sizeof(header),
+                               line + len, m_log_buf_size - 1);
+        line[len++] = '\n';
+        m_out_len += len;
+        m_out_lines++;
+    }
+    buf->ring.consume(total);
+}
+
+// 调用点第一次出现前先写出它的定义，解码工具据此还原
+void Log::out_binary_record(const log_record_header &header, const char *rec) {
+    if (header.site >= m_site_written.size())
+        m_site_written.resize(header.site + 1, false);
+    if (!m_site_written[header.site]) {
+        if (!log_get_site(header.site))
+            return;
+        m_site_written[header.site] = true;
+        std::string def;
+        append_site_def(def, header.site);
+        out_append(def.data(), def.size());
+    }
+    out_append(rec, header.size);
+    m_out_lines++;
+}
+
+void Log::out_append(const char *data, size_t len) {
+    if (m_out_size - m_out_len < len)
+        out_flush();
+    memcpy(m_out + m_out_len, data, len);
+    m_out_len += len;
+}
+
+void Log::out_flush() {
+    if (m_out_len == 0)
+        return;
+    before_write(m_out_len, m_out_lines);
+    struct iovec iov = {m_out, m_out_len};
+    write_all(&iov, 1);
+    m_out_len = 0;
+    m_out_lines = 0;
+}
+
+void Log::append_site_def(std::string &out, uint32_t id) {
+    const log_site *site = log_get_site(id);
+    if (!site)
+        return;
+    size_t fmt_len = strlen(site->format) + 1;
+    size_t file_len = strlen(site->file) + 1;
+    log_record_header def;
+    def.size = (uint32_t)(sizeof(def) + 2 * sizeof(int32_t) + fmt_len + file_len);
+    def.site = id | LOG_SITE_DEF;
+    def.time_ns = 0;
+    int32_t level = site->level, line = site->line;
+    out.append((const char *)&def, sizeof(def));
+    out.append((const char *)&level, sizeof(level));
+    out.append((const char *)&line, sizeof(line));
+    out.append(site->format, fmt_len);
+    out.append(site->file, file_len);
+}
+
+void Log::write_site_defs() {
+    std::string out(LOG_BINARY_MAGIC, sizeof(LOG_BINARY_MAGIC));
+    for (size_t id = 0; id < m_site_written.size(); id++) {
+        if (m_site_written[id])
+            append_site_def(out, (uint32_t)id);
     }
+    struct iovec iov = {(void *)out.data(), out.size()};
+    write_all(&iov, 1);
+    m_bytes += out.size();
+}
+
+// ========== 轮转 ==========
+
+void Log::set_rotation(long long max_bytes, int keep_files, bool compress) {
+    m_max_bytes = max_bytes > 0 ? max_bytes : 0;
+    m_keep_files = keep_files > 0 ? keep_files : 0;
+    m_compress = compress;
+}
+
+// YYYY_MM_DD_<name>[.bin][.N]
+void Log::make_path(char *path, size_t size, const struct tm &day, int seq) const {
+    int n = snprintf(path, size, "%s%d_%02d_%02d_%s%s", dir_name, day.tm_year + 1900, day.tm_mon + 1,
+                     day.tm_mday, log_name, m_defer_mode == DEFER_BINARY ? ".bin" : "");
+    if (seq > 0 && n > 0 && (size_t)n < size)
+        snprintf(path + n, size - n, ".%d", seq);
+}
+
+bool Log::open_file() {
+    // O_APPEND：每次 write 原子地追加到文件末尾，同步模式下多线程直接写不会交错
+    m_fd = open(m_path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (m_fd < 0)
+        return false;
+    struct stat st;
+    m_bytes = fstat(m_fd, &st) == 0 ? st.st_size : 0;
+    m_count = 0;
+    return true;
+}
+
+// 检查放在写之前：日期用秒级缓存的本地时间判断，不额外调用 localtime
+void Log::before_write(size_t bytes, size_t lines) {
+    if (m_fd < 0)
+        return;
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME_COARSE, &now);
+    int mday = 0;
+    WallClock::log_time(now.tv_sec, &mday);
+
+    bool new_day = mday != m_today;
+    if (new_day
+        || (m_max_bytes > 0 && m_bytes > 0 && m_bytes + (long long)bytes > m_max_bytes)
+        || (m_split_lines > 0 && m_count >= m_split_lines)) {
+        rotate(new_day);
+    }
+    m_bytes += bytes;
+    m_count += lines;
+}
+
+// 按大小/行数轮转时当前文件改名为 .N 后重新打开；跨天时旧文件保留原名，新文件用新日期
+// 关闭的文件交给归档线程压缩，写线程只做 close/rename/open
+void Log::rotate(bool new_day) {
+    close(m_fd);
+    m_fd = -1;
+
+    char closed[sizeof(m_path)];
+    if (new_day) {
+        strcpy(closed, m_path);
+        time_t t = time(NULL);
+        localtime_r(&t, &m_day);
+        m_today = m_day.tm_mday;
+        m_seq = 0;
+    } else {
+        make_path(closed, sizeof(closed), m_day, ++m_seq);
+        if (rename(m_path, closed) != 0)
+            strcpy(closed, m_path);
+    }
+
+    make_path(m_path, sizeof(m_path), m_day, 0);
+    if (!open_file())
+        return;
+    m_archiver.set_active(m_path);
+    m_archiver.submit(closed);
+
+    // 二进制日志：新文件也要能单独解码
+    if (m_defer_mode == DEFER_BINARY)
+        write_site_defs();
+}
+
+int64_t Log::now_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+// writev 可能只写出一部分，按已写字节推进后继续
+void Log::write_all(struct iovec *iov, int count) {
+    while (count > 0) {
+        ssize_t n = writev(m_fd, iov, count);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        while (count > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+}
+
+void Log::write_log(int level, const char* format, ...) {
+    if (m_fd < 0)
+        return;
 
     va_list valst;
+    if (m_defer_mode != DEFER_OFF) {
+        // 延迟模式下直接调用 write_log（不经过 LOG_* 宏）：先格式化正文，作为一个字符串参数记录
+        char text[1024];
+        va_start(valst, format);
+        vsnprintf(text, sizeof(text), format, valst);
+        va_end(valst);
+        if (level < 0 || level > 3)
+            level = LOG_LEVEL_INFO;
+        write_deferred(level, m_text_site[level], (const char *)text);
+        return;
+    }
+
+    // 获取时间并格式化：clock_gettime 走 vDSO，日期时间字符串按秒缓存，不再每行调用 localtime
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    const char *stamp = WallClock::log_time(now.tv_sec);
+
+    // 格式化到本线程的缓冲区，不与其他线程共享
+    log_thread_buffer *buf = thread_buffer();
+    char *line = buf->line;
+    int size = buf->line_size;
+
     va_start(valst, format);
-    int n = snprintf(m_buf, m_log_buf_size, "%d-%02d-%02d %02d:%02d:%02d.%06ld %s ",
-                     sys_tm->tm_year+1900, sys_tm->tm_mon+1, sys_tm->tm_mday,
-                     sys_tm->tm_hour, sys_tm->tm_min, sys_tm->tm_sec, now.tv_usec, level_str);
-    int m = vsnprintf(m_buf+n, m_log_buf_size - n, format, valst);
-    m_buf[n+m] = '\n';
-    m_buf[n+m+1] = '\0';
+    int n = snprintf(line, size, "%s.%06ld %s ",
+                     stamp, now.tv_nsec / 1000, level_name(level));
+    int m = vsnprintf(line + n, size - n, format, valst);
     va_end(valst);
+    // 超长的行截断，保证末尾有换行
+    if (m < 0) m = 0;
+    if (n + m > size - 2) m = size - 2 - n;
+    line[n + m] = '\n';
+    size_t len = n + m + 1;
 
-    std::string log_line(m_buf);
+    if (!m_is_async) {
+        std::lock_guard<std::mutex> lock(m_sync_mutex);
+        before_write(len, 1);
+        struct iovec iov = {line, len};
+        write_all(&iov, 1);
+        return;
+    }
+    push_line(buf, level, line, len);
+}
 
-    if (m_is_async) {
-        m_log_queue.enqueue(log_line);
-        m_cond.notify_one();
-    } else {
-        std::lock_guard<std::mutex> lock(m_file_mutex);
-        fputs(log_line.c_str(), m_fp);
-        fflush(m_fp); // 同步日志每次自动flush
+void Log::push_line(log_thread_buffer *buf, int level, const char *data, size_t len) {
+    // 写线程已退出：文本直接写文件，延迟模式的记录无法再格式化，丢弃
+    if (m_exit_flag) {
+        if (m_defer_mode == DEFER_OFF) {
+            struct iovec iov = {(void *)data, len};
+            write_all(&iov, 1);
+        }
+        return;
+    }
+
+    if (m_overflow_policy != OVERFLOW_BLOCK && overflow_drop(buf, level, len)) {
+        if (level < 0 || level > 3)
+            level = LOG_LEVEL_INFO;
+        // 只有本线程写，不需要原子加
+        buf->dropped[level].store(buf->dropped[level].load(std::memory_order_relaxed) + 1,
+                                  std::memory_order_relaxed);
+        return;
+    }
+
+    // 阻塞策略：环满时唤醒写线程并等待腾出空间（不丢日志）
+    log_ring &ring = buf->ring;
+    while (!ring.push(data, len)) {
+        if (m_exit_flag)
+            return push_line(buf, level, data, len);
+        wake_writer();
+        std::this_thread::yield();
+    }
+    signal_writer();
+}
+
+// 过半判断先用缓存的消费者位置（只会偏大），看起来过半时才重新读取
+bool Log::overflow_drop(log_thread_buffer *buf, int level, size_t len) {
+    log_ring &ring = buf->ring;
+    size_t half = ring.capacity() / 2;
+    size_t used = ring.producer_used();
+    if (used < half)
+        return false;
+    used = ring.producer_used(true);
+
+    if (ring.capacity() - used < len)
+        return true;
+    if (used < half || level >= LOG_LEVEL_WARN)
+        return false;
+    switch (m_overflow_policy) {
+        case OVERFLOW_DROP_DEBUG:
+            return level <= LOG_LEVEL_DEBUG;
+        case OVERFLOW_SAMPLE:
+            return buf->sample_seq++ % LOG_SAMPLE_EVERY != 0;
+        default:
+            return false;
     }
-    
 }
 
 void Log::flush() {
-    std::lock_guard<std::mutex> lock(m_file_mutex);
-    fflush(m_fp);
+    if (m_is_async)
+        wake_writer();
 }
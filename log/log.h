@@ -1,8 +1,8 @@
 #ifndef LOG_H
 #define LOG_H
 
-#include "../third_party/concurrentqueue/concurrentqueue.h"
 #include <string>
+#include <vector>
 #include <mutex>
 #include <thread>
 #include <condition_variable>
@@ -12,6 +12,38 @@
 #include <cstdarg>
 #include <ctime>
 #include <iostream>
+#include "log_ring.h"
+#include "log_record.h"
+#include "log_rotate.h"
+
+// ========== 日志级别 ==========
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO  1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_OFF   4
+
+// 编译期最低级别（make LOG_LEVEL=1 去掉所有 LOG_DEBUG），低于它的调用点整段被编译器删除
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+// 运行期最低级别：普通全局原子变量，调用点只做一次 relaxed 读和比较，不经过单例
+extern std::atomic<int> g_log_level;
+
+// 每个写日志的线程一份，首次写日志时分配，之后每行日志不再申请内存
+struct log_thread_buffer {
+    log_thread_buffer(int line_size, size_t ring_size)
+        : line(new char[line_size]), line_size(line_size), ring(ring_size) {}
+    ~log_thread_buffer() { delete[] line; }
+
+    char *line;                         // 格式化缓冲区
+    int line_size;
+    log_ring ring;                      // 到日志写线程的单生产者单消费者环
+    std::atomic<bool> retired{false};   // 所属线程已退出，写线程取空后释放
+    std::atomic<uint64_t> dropped[4] = {};   // 按级别统计的丢弃行数，只有所属线程写，写线程读
+    unsigned sample_seq = 0;            // 采样策略的计数，只有所属线程使用
+};
 
 class Log{
 public:
@@ -22,24 +54,91 @@ public:
         return &instance;
     }
 
-    bool init(const char *file_name, const int close_log, int log_buf_size = 8192, int split_lines = 5000000, bool is_async = 1);
+    // 延迟格式化：调用点只记录格式串编号和原始参数（需异步日志）
+    enum DEFER_MODE {
+        DEFER_OFF = 0,      // 调用线程格式化
+        DEFER_TEXT,         // 写线程格式化，输出文本日志
+        DEFER_BINARY        // 直接写二进制记录（.bin），用 log_decode 离线转成文本
+    };
+
+    // 异步日志环写满（或超过半满）时的处理
+    enum OVERFLOW_POLICY {
+        OVERFLOW_BLOCK = 0,     // 等待写线程腾出空间，不丢日志
+        OVERFLOW_DROP_NEWEST,   // 写满时丢弃当前这一行
+        OVERFLOW_DROP_DEBUG,    // 过半后先丢 DEBUG，写满时丢弃当前这一行
+        OVERFLOW_SAMPLE         // 过半后 WARN 以下每 LOG_SAMPLE_EVERY 行保留一行，写满时丢弃当前这一行
+    };
+
+    bool init(const char *file_name, const int close_log, int log_buf_size = 8192, int split_lines = 5000000, bool is_async = 1,
+              int defer_mode = DEFER_OFF);
+
+    // 轮转配置，须在 init 之前调用：单个文件最大字节数（0 不限），保留的归档文件数（0 不限），是否压缩归档
+    // 按行数（split_lines）、字节数和日期轮转，都由写线程（同步模式下由写日志的线程加锁）完成
+    void set_rotation(long long max_bytes, int keep_files, bool compress);
+
+    // 环满策略，须在 init 之前调用；丢弃的行数由写线程定期以 WARN 写进日志
+    void set_overflow_policy(int policy);
+    uint64_t dropped_lines() const { return m_dropped_total.load(std::memory_order_relaxed); }
+    // 各线程环中等待写出的字节数（监控用，会短暂持有登记表锁）
+    size_t queued_bytes();
 
     void write_log(int level, const char *format, ...);
 
+    bool is_deferred() const { return m_defer_mode != DEFER_OFF; }
+
+    // 延迟格式化入口（由 LOG_* 宏调用）：编码参数放入本线程的环，不调用 printf 系列函数
+    template <typename... Args>
+    void write_deferred(int level, int site, Args... args) {
+        if (site < 0)
+            return;     // 调用点数超出 LOG_MAX_SITES，丢弃
+        log_thread_buffer *buf = thread_buffer();
+        log_record_header header;
+        char *begin = buf->line;
+        char *end = log_encode_args(begin + sizeof(header), begin + buf->line_size, args...);
+        header.size = (uint32_t)(end - begin);
+        header.site = (uint32_t)site;
+        header.time_ns = now_ns();
+        memcpy(begin, &header, sizeof(header));
+        push_line(buf, level, begin, header.size);
+    }
+
+    // 异步模式下唤醒写线程，把各线程环中的日志写出
     void flush(void);
 
-    // 日志刷新模式
-    enum class FlushMode {
-        Immediate,  // 每条日志立即 flush
-        Interval    // 定时 flush
-    };
-    bool get_debug_enable() {return m_debug_enable;}
+    bool get_debug_enable() {return g_log_level.load(std::memory_order_relaxed) <= LOG_LEVEL_DEBUG;}
     int get_is_close_log() {return m_close_log;}
 
+    // 运行期调整级别（关闭日志时无效）
+    void set_level(int level);
+    // SIGUSR1 处理函数：在 DEBUG 和启动时的级别之间切换，只写原子变量，可在信号处理函数中调用
+    static void toggle_debug(int sig);
+
 private:
     Log();
     virtual ~Log();
     void async_write_log();
+    log_thread_buffer *thread_buffer();   // 当前线程的缓冲区，首次调用时分配并登记
+    bool drain();                         // 写线程：取空所有环，合并成少量 writev；返回是否取到数据
+    bool rings_empty();
+    void release_retired(std::vector<log_thread_buffer*> &retired);
+    void report_drops();                  // 写线程：有新的丢弃时写一行汇总
+    void write_internal(int level, const char *text);   // 写线程自己产生的日志
+    void write_all(struct iovec *iov, int count);
+    void wake_writer();                   // 强制唤醒（flush、退出）
+    void signal_writer();                 // 生产者写入后调用：只在写线程空闲时唤醒
+    void push_line(log_thread_buffer *buf, int level, const char *data, size_t len);   // 放入本线程的环，满时按策略处理
+    bool overflow_drop(log_thread_buffer *buf, int level, size_t len);     // 按策略判断这一行是否丢弃
+    void drain_records(log_thread_buffer *buf);   // 延迟格式化：解析环中的记录放入 m_out
+    void out_binary_record(const log_record_header &header, const char *rec);
+    void out_append(const char *data, size_t len);
+    void out_flush();
+    void make_path(char *path, size_t size, const struct tm &day, int seq) const;
+    bool open_file();
+    void before_write(size_t bytes, size_t lines);   // 写文件前检查是否需要轮转，并累计行数/字节数
+    void rotate(bool new_day);
+    void write_site_defs();                           // 二进制日志：新文件开头补写已出现过的调用点定义
+    void append_site_def(std::string &out, uint32_t id);
+    static int64_t now_ns();
 
 
 private:
@@ -49,28 +148,69 @@ private:
     int m_log_buf_size; // 日志缓冲区大小 
     long long m_count;  // 日志行数记录
     int m_today;        // 因为按天分类，记录当前时间是哪一天
-    FILE *m_fp;         // 打开log的文件指针 
-    char *m_buf;
+    int m_fd;           // 日志文件，O_APPEND 打开，同步模式下各线程直接 write
 
-    // 刷盘模式
-    FlushMode m_flush_mode;
-    int m_flush_interval_sec; // 定时刷盘间隔
-    bool m_debug_enable;  // 是否开启debug选项
+    // 轮转
+    char m_path[256];           // 正在写的文件
+    struct tm m_day;            // 正在写的文件对应的日期
+    long long m_bytes;          // 当前文件字节数
+    long long m_max_bytes;      // 超过即轮转，0 不限
+    int m_seq;                  // 当天已轮转的文件数，轮转后的文件名加 .N
+    int m_keep_files;
+    bool m_compress;
+    log_archiver m_archiver;    // 后台压缩与清理
+    std::mutex m_sync_mutex;    // 同步模式下保护轮转与文件描述符
 
-    // 异步日志
-    moodycamel::ConcurrentQueue<std::string> m_log_queue;
+    static std::atomic<int> s_base_level;   // 启动时的级别，切换 DEBUG 时回到它
+
+    // 异步日志：各线程格式化后放入自己的环，写线程定期或按需取出
+    std::vector<log_thread_buffer*> m_buffers;   // 已登记的线程缓冲区
+    std::mutex m_buffers_mutex;                  // 只在线程首次写日志和写线程遍历时加锁
     std::condition_variable m_cond;
     std::mutex m_cond_mutex;
     std::thread m_thread;
     std::atomic<bool> m_exit_flag{false};
+    std::atomic<bool> m_writer_idle{false};   // 写线程准备睡眠，生产者据此决定是否唤醒
+
+    // 环满处理与丢弃统计
+    int m_overflow_policy;
+    uint64_t m_dropped_retired[4];             // 已退出线程的丢弃数
+    uint64_t m_dropped_reported;               // 已写进日志的丢弃总数
+    int64_t m_drop_report_ns;                  // 上次汇总的时间
+    std::atomic<uint64_t> m_dropped_total{0};
 
     bool m_is_async;           // 是否同步标志位
-    std::mutex m_file_mutex;
+    int m_defer_mode;          // DEFER_MODE
+    int m_text_site[4];        // 延迟模式下直接调用 write_log 的文本记录，按级别各一个调用点
+
+    // 写线程输出缓冲（延迟格式化时使用）
+    char *m_out;
+    size_t m_out_len;
+    size_t m_out_lines;                   // m_out 中的记录数，轮转按行数计
+    size_t m_out_size;
+    char *m_scratch;                      // 跨环尾的记录拼接成连续内存
+    std::vector<bool> m_site_written;     // 二进制日志：已写出定义的调用点
     int m_close_log; // 关闭日志
 };
-#define LOG_DEBUG(format, ...) if(0 == Log::get_instance()->get_is_close_log() && Log::get_instance()->get_debug_enable()) {Log::get_instance()->write_log(0, format, ##__VA_ARGS__); }
-#define LOG_INFO(format, ...) if(0 == Log::get_instance()->get_is_close_log()) {Log::get_instance()->write_log(1, format, ##__VA_ARGS__); }
-#define LOG_WARN(format, ...) if(0 == Log::get_instance()->get_is_close_log()) {Log::get_instance()->write_log(2, format, ##__VA_ARGS__); }
-#define LOG_ERROR(format, ...) if(0 == Log::get_instance()->get_is_close_log()) {Log::get_instance()->write_log(3, format, ##__VA_ARGS__); }
+
+#define LOG_ENABLED(level) ((level) >= LOG_MIN_LEVEL && (level) >= g_log_level.load(std::memory_order_relaxed))
+
+// 延迟模式下每个调用点第一次执行时登记格式串，之后只记录编号和参数
+#define LOG_WRITE(level, format, ...) \
+    do { \
+        Log *log_instance_ = Log::get_instance(); \
+        if (log_instance_->is_deferred()) { \
+            static const int log_site_id_ = log_register_site(level, format, __FILE__, __LINE__); \
+            log_instance_->write_deferred(level, log_site_id_, ##__VA_ARGS__); \
+        } else { \
+            log_instance_->write_log(level, format, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+// 级别未开启时只有一次比较，参数表达式不会求值
+#define LOG_DEBUG(format, ...) if(LOG_ENABLED(LOG_LEVEL_DEBUG)) {LOG_WRITE(LOG_LEVEL_DEBUG, format, ##__VA_ARGS__); }
+#define LOG_INFO(format, ...) if(LOG_ENABLED(LOG_LEVEL_INFO)) {LOG_WRITE(LOG_LEVEL_INFO, format, ##__VA_ARGS__); }
+#define LOG_WARN(format, ...) if(LOG_ENABLED(LOG_LEVEL_WARN)) {LOG_WRITE(LOG_LEVEL_WARN, format, ##__VA_ARGS__); }
+#define LOG_ERROR(format, ...) if(LOG_ENABLED(LOG_LEVEL_ERROR)) {LOG_WRITE(LOG_LEVEL_ERROR, format, ##__VA_ARGS__); }
 
 #endif
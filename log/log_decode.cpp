@@ -0,0 +1,122 @@
+// 二进制日志解码：把 -l 3 产生的 .bin 日志转成与文本日志相同格式的文本
+// 用法：./log_decode logs/2024_01_01_ServerLog.bin > ServerLog.txt
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "log_record.h"
+#include "../utils/clock.h"
+
+struct decoded_site {
+    bool defined = false;
+    int level = 1;
+    std::string format;
+    std::string file;
+    int line = 0;
+};
+
+static const char *level_name(int level) {
+    switch (level) {
+        case 0: return "[debug]:";
+        case 2: return "[warn]:";
+        case 3: return "[error]:";
+        default: return "[info]:";
+    }
+}
+
+static int decode(FILE *fp, const char *path) {
+    std::vector<decoded_site> sites;
+    std::vector<char> rec;
+    char text[8192];
+    long long records = 0;
+    long long unknown = 0;
+
+    char magic[sizeof(LOG_BINARY_MAGIC)];
+    if (fread(magic, 1, sizeof(magic), fp) != sizeof(magic) || memcmp(magic, LOG_BINARY_MAGIC, sizeof(magic)) != 0) {
+        fprintf(stderr, "%s: not a binary log\n", path);
+        return 1;
+    }
+
+    for (;;) {
+        log_record_header header;
+        size_t n = fread(&header, 1, sizeof(header), fp);
+        if (n == 0)
+            break;
+        if (n != sizeof(header)) {
+            fprintf(stderr, "%s: truncated record header\n", path);
+            break;
+        }
+
+        // 追加写入的文件里每次启动都会再写一个文件头，调用点编号从头开始
+        if (memcmp(&header, LOG_BINARY_MAGIC, sizeof(LOG_BINARY_MAGIC)) == 0) {
+            sites.clear();
+            if (fseek(fp, (long)sizeof(LOG_BINARY_MAGIC) - (long)sizeof(header), SEEK_CUR) != 0)
+                break;
+            continue;
+        }
+
+        if (header.size < sizeof(header)) {
+            fprintf(stderr, "%s: corrupt record size %u\n", path, header.size);
+            return 1;
+        }
+        rec.resize(header.size - sizeof(header));
+        if (!rec.empty() && fread(rec.data(), 1, rec.size(), fp) != rec.size()) {
+            fprintf(stderr, "%s: truncated record\n", path);
+            break;
+        }
+
+        if (header.site & LOG_SITE_DEF) {
+            uint32_t id = header.site & ~LOG_SITE_DEF;
+            if (id >= sites.size())
+                sites.resize(id + 1);
+            decoded_site &site = sites[id];
+            int32_t level, line;
+            if (rec.size() < 2 * sizeof(int32_t) + 2)
+                continue;
+            memcpy(&level, rec.data(), sizeof(level));
+            memcpy(&line, rec.data() + sizeof(level), sizeof(line));
+            const char *strings = rec.data() + 2 * sizeof(int32_t);
+            site.defined = true;
+            site.level = level;
+            site.line = line;
+            site.format = strings;
+            site.file = strings + site.format.size() + 1;
+            continue;
+        }
+
+        records++;
+        if (header.site >= sites.size() || !sites[header.site].defined) {
+            unknown++;
+            continue;
+        }
+        const decoded_site &site = sites[header.site];
+        log_format_args(site.format.c_str(), rec.data(), rec.size(), text, sizeof(text));
+        time_t sec = header.time_ns / 1000000000;
+        printf("%s.%06ld %s %s\n", WallClock::log_time(sec),
+               (long)(header.time_ns % 1000000000 / 1000), level_name(site.level), text);
+    }
+
+    if (unknown)
+        fprintf(stderr, "%s: %lld of %lld records reference undefined sites\n", path, unknown, records);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <binary log>...\n", argv[0]);
+        return 1;
+    }
+    int ret = 0;
+    for (int i = 1; i < argc; i++) {
+        FILE *fp = fopen(argv[i], "rb");
+        if (!fp) {
+            perror(argv[i]);
+            ret = 1;
+            continue;
+        }
+        ret |= decode(fp, argv[i]);
+        fclose(fp);
+    }
+    return ret;
+}
@@ -0,0 +1,186 @@
+#include "log_record.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <mutex>
+
+// ========== 调用点登记 ==========
+// 编号按登记顺序分配，只增不减；写线程拿到记录时该编号一定已登记（记录在登记之后才写入环）
+static log_site g_sites[LOG_MAX_SITES];
+static std::atomic<int> g_site_count{0};
+static std::mutex g_site_mutex;
+
+int log_register_site(int level, const char *format, const char *file, int line) {
+    std::lock_guard<std::mutex> lock(g_site_mutex);
+    int id = g_site_count.load(std::memory_order_relaxed);
+    if (id >= LOG_MAX_SITES)
+        return -1;
+    g_sites[id].level = level;
+    g_sites[id].line = line;
+    g_sites[id].format = format;
+    g_sites[id].file = file;
+    g_site_count.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+const log_site *log_get_site(int id) {
+    if (id < 0 || id >= g_site_count.load(std::memory_order_acquire))
+        return nullptr;
+    return &g_sites[id];
+}
+
+// ========== 按格式串还原 ==========
+
+namespace {
+
+struct arg_reader {
+    const char *p;
+    const char *end;
+
+    // 取下一个参数；字符串返回指针和长度，数值统一转成三种表示，按转换说明选用
+    bool next(char *type, long long *i, unsigned long long *u, double *d, const char **s, uint32_t *len) {
+        if (p >= end)
+            return false;
+        *type = *p++;
+        if (*type == LOG_ARG_STR) {
+            if (end - p < (ptrdiff_t)sizeof(uint32_t))
+                return false;
+            memcpy(len, p, sizeof(*len));
+            p += sizeof(*len);
+            if (end - p < (ptrdiff_t)*len)
+                return false;
+            *s = p;
+            p += *len;
+            return true;
+        }
+        if (end - p < 8)
+            return false;
+        int64_t vi;
+        uint64_t vu;
+        double vd;
+        switch (*type) {
+            case LOG_ARG_INT:
+                memcpy(&vi, p, 8);
+                *i = vi; *u = (unsigned long long)vi; *d = (double)vi;
+                break;
+            case LOG_ARG_DOUBLE:
+                memcpy(&vd, p, 8);
+                *i = (long long)vd; *u = (unsigned long long)vd; *d = vd;
+                break;
+            default:    // LOG_ARG_UINT / LOG_ARG_PTR
+                memcpy(&vu, p, 8);
+                *i = (long long)vu; *u = vu; *d = (double)vu;
+                break;
+        }
+        p += 8;
+        return true;
+    }
+};
+
+}
+
+size_t log_format_args(const char *format, const char *args, size_t args_len, char *out, size_t out_size) {
+    if (out_size == 0)
+        return 0;
+    size_t o = 0;
+    auto put = [&](const char *s, size_t n) {
+        if (n > out_size - 1 - o)
+            n = out_size - 1 - o;
+        memcpy(out + o, s, n);
+        o += n;
+    };
+    auto put_printf = [&](int n) {
+        if (n < 0) return;
+        o += (size_t)n < out_size - o ? (size_t)n : out_size - 1 - o;
+    };
+
+    arg_reader reader = {args, args + args_len};
+    const char *f = format;
+    while (*f && o < out_size - 1) {
+        if (*f != '%') {
+            const char *pct = strchr(f, '%');
+            size_t n = pct ? (size_t)(pct - f) : strlen(f);
+            put(f, n);
+            f += n;
+            continue;
+        }
+        if (f[1] == '%') {
+            put("%", 1);
+            f += 2;
+            continue;
+        }
+
+        // 取出标志、宽度、精度，丢掉长度修饰，按实际存储的类型重新拼转换说明
+        char spec[40];
+        size_t k = 0;
+        spec[k++] = '%';
+        const char *s = f + 1;
+        while (*s && strchr("-+ #0123456789", *s) && k < 16)
+            spec[k++] = *s++;
+        int precision = -1;
+        if (*s == '.') {
+            precision = atoi(s + 1);
+            s++;
+            while (*s >= '0' && *s <= '9')
+                s++;
+        }
+        while (*s && strchr("hlLqjzt", *s))
+            s++;
+        char conv = *s;
+        if (!conv)
+            break;
+        f = s + 1;
+
+        char type;
+        long long i = 0;
+        unsigned long long u = 0;
+        double d = 0;
+        const char *str = nullptr;
+        uint32_t len = 0;
+        if (!reader.next(&type, &i, &u, &d, &str, &len)) {
+            put("?", 1);
+            continue;
+        }
+
+        // 字符串不以 0 结尾，用 %.*s 按长度输出
+        if (type == LOG_ARG_STR) {
+            if (precision >= 0 && (uint32_t)precision < len)
+                len = precision;
+            snprintf(spec + k, sizeof(spec) - k, ".*s");
+            put_printf(snprintf(out + o, out_size - o, spec, (int)len, str));
+            continue;
+        }
+        if (precision >= 0)
+            k += snprintf(spec + k, sizeof(spec) - k, ".%d", precision);
+
+        // 数值参数遇到 %s 等不匹配的转换时按存储类型输出
+        if (!strchr("dioucxXfFeEgGaAp", conv))
+            conv = type == LOG_ARG_DOUBLE ? 'g' : (type == LOG_ARG_INT ? 'd' : 'u');
+
+        switch (conv) {
+            case 'd': case 'i':
+                snprintf(spec + k, sizeof(spec) - k, "lld");
+                put_printf(snprintf(out + o, out_size - o, spec, i));
+                break;
+            case 'o': case 'u': case 'x': case 'X':
+                snprintf(spec + k, sizeof(spec) - k, "ll%c", conv);
+                put_printf(snprintf(out + o, out_size - o, spec, u));
+                break;
+            case 'c':
+                snprintf(spec + k, sizeof(spec) - k, "c");
+                put_printf(snprintf(out + o, out_size - o, spec, (int)i));
+                break;
+            case 'p':
+                snprintf(spec + k, sizeof(spec) - k, "p");
+                put_printf(snprintf(out + o, out_size - o, spec, (void *)(uintptr_t)u));
+                break;
+            default:    // 浮点
+                snprintf(spec + k, sizeof(spec) - k, "%c", conv);
+                put_printf(snprintf(out + o, out_size - o, spec, d));
+                break;
+        }
+    }
+    out[o] = '\0';
+    return o;
+}
@@ -0,0 +1,126 @@
+#ifndef LOG_RECORD_H
+#define LOG_RECORD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <type_traits>
+
+// ========== 延迟格式化日志记录 ==========
+// 调用点只记录格式串编号和原始参数，由写线程或离线解码工具格式化
+// 记录布局：log_record_header + 参数（每个参数一字节类型 + 值），均为本机字节序
+
+// 调用点信息：格式串和文件名都是字面量，只保存指针
+struct log_site {
+    int level;
+    int line;
+    const char *format;
+    const char *file;
+};
+
+struct log_record_header {
+    uint32_t size;      // 整条记录字节数（含头）
+    uint32_t site;      // 调用点编号；最高位为 1 时是调用点定义（只出现在二进制日志文件中）
+    int64_t time_ns;    // CLOCK_REALTIME 纳秒
+};
+
+static const uint32_t LOG_SITE_DEF = 0x80000000u;
+static const int LOG_MAX_SITES = 8192;
+static const char LOG_BINARY_MAGIC[8] = {'W', 'S', 'B', 'L', 'O', 'G', '1', '\n'};   // 二进制日志每次启动写一次
+
+// 参数类型
+enum LOG_ARG_TYPE : char {
+    LOG_ARG_INT = 'i',
+    LOG_ARG_UINT = 'u',
+    LOG_ARG_DOUBLE = 'd',
+    LOG_ARG_PTR = 'p',
+    LOG_ARG_STR = 's'       // uint32 长度 + 字节，不含结尾 0
+};
+
+// 登记调用点，返回编号（每个调用点只在第一次执行时调用，超出上限返回 -1）
+int log_register_site(int level, const char *format, const char *file, int line);
+const log_site *log_get_site(int id);
+
+// 按格式串把参数格式化到 out，返回写入长度（不含结尾 0）
+// 参数不足（编码时被截断）的转换说明输出为 "?"
+size_t log_format_args(const char *format, const char *args, size_t args_len, char *out, size_t out_size);
+
+// ========== 参数编码 ==========
+// 空间不够时不写入该参数，字符串按剩余空间截断
+
+inline char *log_encode_value(char *p, char *end, char type, const void *value, size_t len) {
+    if (p == nullptr || end - p < (ptrdiff_t)(1 + len))
+        return nullptr;
+    *p++ = type;
+    memcpy(p, value, len);
+    return p + len;
+}
+
+inline char *log_encode(char *p, char *end, const char *s) {
+    if (p == nullptr || end - p < 1 + (ptrdiff_t)sizeof(uint32_t))
+        return nullptr;
+    if (s == nullptr)
+        s = "(null)";
+    size_t len = strlen(s);
+    size_t room = end - p - 1 - sizeof(uint32_t);
+    if (len > room)
+        len = room;
+    uint32_t n = (uint32_t)len;
+    *p++ = LOG_ARG_STR;
+    memcpy(p, &n, sizeof(n));
+    p += sizeof(n);
+    memcpy(p, s, len);
+    return p + len;
+}
+
+inline char *log_encode(char *p, char *end, char *s) {
+    return log_encode(p, end, (const char *)s);
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, char *>::type
+log_encode(char *p, char *end, T v) {
+    int64_t x = v;
+    return log_encode_value(p, end, LOG_ARG_INT, &x, sizeof(x));
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value, char *>::type
+log_encode(char *p, char *end, T v) {
+    uint64_t x = v;
+    return log_encode_value(p, end, LOG_ARG_UINT, &x, sizeof(x));
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_enum<T>::value, char *>::type
+log_encode(char *p, char *end, T v) {
+    int64_t x = (int64_t)v;
+    return log_encode_value(p, end, LOG_ARG_INT, &x, sizeof(x));
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_floating_point<T>::value, char *>::type
+log_encode(char *p, char *end, T v) {
+    double x = v;
+    return log_encode_value(p, end, LOG_ARG_DOUBLE, &x, sizeof(x));
+}
+
+template <typename T>
+inline char *log_encode(char *p, char *end, T *v) {
+    uint64_t x = (uint64_t)(uintptr_t)v;
+    return log_encode_value(p, end, LOG_ARG_PTR, &x, sizeof(x));
+}
+
+inline char *log_encode_args(char *p, char *) {
+    return p;
+}
+
+template <typename T, typename... Args>
+inline char *log_encode_args(char *p, char *end, T first, Args... rest) {
+    char *next = log_encode(p, end, first);
+    if (next == nullptr)
+        return p;   // 放不下就停止，解码时缺少的参数输出 "?"
+    return log_encode_args(next, end, rest...);
+}
+
+#endif
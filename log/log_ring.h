@@ -0,0 +1,97 @@
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <sys/uio.h>
+
+// 单生产者单消费者字节环：生产者为写日志的线程，消费者为日志写线程
+// 只存放完整的日志行，消费者一次取出全部可读字节（回绕时为两段），直接交给 writev
+// 读写位置分在不同缓存行，生产者只在空间不够时才读消费者的位置
+class log_ring {
+public:
+    explicit log_ring(size_t capacity)   // capacity 须为 2 的幂
+        : m_buf(new char[capacity]), m_mask(capacity - 1) {}
+    ~log_ring() { delete[] m_buf; }
+    log_ring(const log_ring&) = delete;
+    log_ring& operator=(const log_ring&) = delete;
+
+    size_t capacity() const { return m_mask + 1; }
+
+    // 生产者：整行写入，空间不足返回 false，不写入部分内容
+    bool push(const char *data, size_t len) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (capacity() - (tail - m_head_cache) < len) {
+            m_head_cache = m_head.load(std::memory_order_acquire);
+            if (capacity() - (tail - m_head_cache) < len)
+                return false;
+        }
+
+        size_t pos = tail & m_mask;
+        size_t first = capacity() - pos;
+        if (first >= len) {
+            memcpy(m_buf + pos, data, len);
+        } else {
+            memcpy(m_buf + pos, data, first);
+            memcpy(m_buf, data + first, len - first);
+        }
+        m_tail.store(tail + len, std::memory_order_release);
+        return true;
+    }
+
+    // 消费者：取出当前可读区域（最多两段），返回段数；处理完后用 consume 归还
+    int peek(struct iovec *iov, size_t *total) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        size_t tail = m_tail.load(std::memory_order_acquire);
+        *total = tail - head;
+        if (*total == 0)
+            return 0;
+
+        size_t pos = head & m_mask;
+        size_t first = capacity() - pos;
+        iov[0].iov_base = m_buf + pos;
+        if (first >= *total) {
+            iov[0].iov_len = *total;
+            return 1;
+        }
+        iov[0].iov_len = first;
+        iov[1].iov_base = m_buf;
+        iov[1].iov_len = *total - first;
+        return 2;
+    }
+
+    void consume(size_t len) {
+        m_head.store(m_head.load(std::memory_order_relaxed) + len, std::memory_order_release);
+    }
+
+    // 生产者：已用字节数的估计（按缓存的消费者位置，只会偏大）；refresh 时重新读取消费者位置
+    size_t producer_used(bool refresh = false) {
+        if (refresh)
+            m_head_cache = m_head.load(std::memory_order_acquire);
+        return m_tail.load(std::memory_order_relaxed) - m_head_cache;
+    }
+
+    // 任意线程：当前已用字节数的近似值（用于监控）
+    size_t size() const {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+    bool empty() const {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+private:
+    char *m_buf;
+    size_t m_mask;
+
+    // 用填充隔开读写位置（对象在堆上分配，C++14 下 alignas(64) 不保证生效）
+    char m_pad0[64];
+    std::atomic<size_t> m_head{0};   // 消费者写
+    char m_pad1[64];
+    std::atomic<size_t> m_tail{0};   // 生产者写
+    size_t m_head_cache = 0;         // 生产者缓存的消费者位置
+    char m_pad2[64];
+};
+
+#endif
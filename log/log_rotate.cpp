@@ -0,0 +1,182 @@
+#include "log_rotate.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <vector>
+#ifdef LOG_ZLIB
+#include <zlib.h>
+#endif
+
+// ioprio_set 没有 glibc 封装
+static const int IOPRIO_WHO_PROCESS = 1;
+static const int IOPRIO_CLASS_IDLE = 3;
+static const int IOPRIO_CLASS_SHIFT = 13;
+
+log_archiver::log_archiver() : m_keep_files(0), m_compress(false), m_stop(false) {}
+
+log_archiver::~log_archiver() {
+    stop();
+}
+
+void log_archiver::start(const std::string& dir, const std::string& name, int keep_files, bool compress) {
+    m_dir = dir.empty() ? "./" : dir;
+    m_name = name;
+    m_keep_files = keep_files;
+#ifdef LOG_ZLIB
+    m_compress = compress;
+#else
+    m_compress = false;
+    (void)compress;
+#endif
+    m_stop = false;
+    m_thread = std::thread(&log_archiver::run, this);
+    // 启动时先按保留数清理一次上次运行留下的归档
+    submit("");
+}
+
+void log_archiver::stop() {
+    if (!m_thread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_one();
+    m_thread.join();
+}
+
+void log_archiver::set_active(const std::string& path) {
+    size_t slash = path.rfind('/');
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_active = slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+void log_archiver::submit(const std::string& path) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back(path);
+    }
+    m_cond.notify_one();
+}
+
+void log_archiver::run() {
+    // 只影响本线程：CPU 最低优先级，磁盘 IO 只在空闲时进行
+    pid_t tid = (pid_t)syscall(SYS_gettid);
+    setpriority(PRIO_PROCESS, tid, 19);
+    syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, tid, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT);
+
+    for (;;) {
+        std::string path;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cond.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+            // 退出时剩下的文件不再压缩，下次轮转或启动时按保留数清理
+            if (m_stop)
+                return;
+            path = m_queue.front();
+            m_queue.pop_front();
+        }
+
+        if (!path.empty() && m_compress)
+            compress_file(path);
+        enforce_retention();
+    }
+}
+
+// 先写到临时文件，完成后改名，中途退出不会留下半个 .gz
+bool log_archiver::compress_file(const std::string& path) {
+#ifdef LOG_ZLIB
+    int in = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0)
+        return false;
+
+    std::string gz_path = path + ".gz";
+    std::string tmp_path = gz_path + ".tmp";
+    gzFile out = gzopen(tmp_path.c_str(), "wb6");
+    if (!out) {
+        close(in);
+        return false;
+    }
+
+    char buf[64 * 1024];
+    bool ok = true;
+    ssize_t n;
+    while ((n = read(in, buf, sizeof(buf))) > 0) {
+        if (gzwrite(out, buf, (unsigned)n) != n) {
+            ok = false;
+            break;
+        }
+    }
+    if (n < 0)
+        ok = false;
+    close(in);
+    if (gzclose(out) != Z_OK)
+        ok = false;
+
+    if (!ok || rename(tmp_path.c_str(), gz_path.c_str()) != 0) {
+        unlink(tmp_path.c_str());
+        return false;
+    }
+    unlink(path.c_str());
+    return true;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+// 归档文件：YYYY_MM_DD_<name> 开头、不是正在写的文件、不是压缩中的临时文件
+void log_archiver::enforce_retention() {
+    if (m_keep_files <= 0)
+        return;
+
+    std::string active;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        active = m_active;
+    }
+
+    DIR *dir = opendir(m_dir.c_str());
+    if (!dir)
+        return;
+
+    std::vector<std::pair<time_t, std::string>> archives;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        const char *fname = entry->d_name;
+        size_t len = strlen(fname);
+        if (len < 11 + m_name.size())
+            continue;
+        bool dated = true;
+        for (int i = 0; i < 10; i++) {
+            bool sep = (i == 4 || i == 7);
+            if (sep ? fname[i] != '_' : (fname[i] < '0' || fname[i] > '9'))
+                dated = false;
+        }
+        if (!dated || fname[10] != '_' || strncmp(fname + 11, m_name.c_str(), m_name.size()) != 0)
+            continue;
+        if (len > 4 && strcmp(fname + len - 4, ".tmp") == 0)
+            continue;
+
+        if (active == fname)
+            continue;
+        std::string path = m_dir + fname;
+        struct stat st;
+        if (stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode))
+            archives.push_back(std::make_pair(st.st_mtime, path));
+    }
+    closedir(dir);
+
+    if ((int)archives.size() <= m_keep_files)
+        return;
+    std::sort(archives.begin(), archives.end());
+    for (size_t i = 0; i + m_keep_files < archives.size(); i++)
+        unlink(archives[i].second.c_str());
+}
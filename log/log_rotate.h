@@ -0,0 +1,43 @@
+#ifndef LOG_ROTATE_H
+#define LOG_ROTATE_H
+
+#include <string>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+// 轮转后的日志归档：后台线程以最低 CPU/IO 优先级压缩（zlib，.gz），并按保留数删除最旧的归档
+// 日志写线程只负责关闭旧文件并提交路径，不在写线程上做任何压缩或目录扫描
+class log_archiver {
+public:
+    log_archiver();
+    ~log_archiver();
+
+    // dir 为日志目录（可为空表示当前目录），name 为日志名，归档文件形如 YYYY_MM_DD_<name>[.bin][.N][.gz]
+    // keep_files 为保留的归档文件数（不含正在写的文件，0 表示不限）
+    void start(const std::string& dir, const std::string& name, int keep_files, bool compress);
+    void stop();
+
+    void set_active(const std::string& path);   // 正在写的文件，不参与清理
+    void submit(const std::string& path);       // 已关闭的日志文件，压缩后做保留清理；空路径只做清理
+
+private:
+    void run();
+    bool compress_file(const std::string& path);
+    void enforce_retention();
+
+    std::string m_dir;
+    std::string m_name;
+    std::string m_active;      // 正在写的文件名（不含目录）
+    int m_keep_files;
+    bool m_compress;
+
+    std::deque<std::string> m_queue;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::thread m_thread;
+    bool m_stop;
+};
+
+#endif
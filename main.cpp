@@ -15,8 +15,11 @@ int main(int argc, char *argv[]){
 
     // 初始化
     server.init(config.PORT, user, passwd, databasename, config.LOGWrite,
-                config.OPT_LINGER, config.TRIGMode,  config.sql_num, config.thread_num,
-                config.close_log);
+                config.OPT_LINGER, config.TRIGMode,  config.sql_num, config.sql_min_num,
+                config.sql_timeout, config.sql_slice, config.sql_async, config.user_store,
+                config.user_db_path, config.header_timeout, config.body_timeout,
+                config.write_timeout, config.idle_timeout, config.log_max_mb, config.log_keep,
+                config.log_overflow, config.access_sample, config.admin_port, config.admin_addr, config.trace_sample, config.defer_accept, config.thread_num, config.close_log);
 
     //日志
     server.log_write();
@@ -24,6 +27,9 @@ int main(int argc, char *argv[]){
     //数据库
     server.sql_pool();
 
+    //用户存储
+    server.user_store();
+
     //触发模式
     server.trig_mode();
 
@@ -38,6 +44,9 @@ int main(int argc, char *argv[]){
     // 启动所有SubReactors
     server.start_sub_reactors();
 
+    //管理端口
+    server.admin_listen();
+
     //printf("进入监听\n");
 
     //printf("即将进入运行\n");
@@ -0,0 +1,138 @@
+#include "admin_server.h"
+
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "../log/log.h"
+
+static const int ADMIN_POLL_MS = 200;          // 检查退出标志的间隔
+static const int ADMIN_IO_TIMEOUT_S = 2;       // 单个请求的读写超时
+static const size_t ADMIN_MAX_REQUEST = 4096;
+
+void admin_server::add_route(const std::string &path, const char *content_type, handler h) {
+    m_routes.push_back(route{path, content_type, h});
+}
+
+bool admin_server::start(const std::string &addr, int port) {
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (inet_pton(AF_INET, addr.c_str(), &address.sin_addr) != 1) {
+        LOG_ERROR("admin: bad listen address %s", addr.c_str());
+        return false;
+    }
+
+    m_listenfd = socket(PF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m_listenfd < 0)
+        return false;
+
+    int flag = 1;
+    setsockopt(m_listenfd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+
+    if (bind(m_listenfd, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(m_listenfd, 16) < 0) {
+        LOG_ERROR("admin: listen on %s:%d failed: %s", addr.c_str(), port, strerror(errno));
+        close(m_listenfd);
+        m_listenfd = -1;
+        return false;
+    }
+
+    m_port = port;
+    m_running = true;
+    m_thread = std::thread(&admin_server::run, this);
+    LOG_INFO("admin: listening on %s:%d", addr.c_str(), port);
+    return true;
+}
+
+void admin_server::stop() {
+    if (!m_running.exchange(false))
+        return;
+    if (m_thread.joinable())
+        m_thread.join();
+    close(m_listenfd);
+    m_listenfd = -1;
+}
+
+void admin_server::run() {
+    while (m_running) {
+        struct pollfd pfd = {m_listenfd, POLLIN, 0};
+        int n = poll(&pfd, 1, ADMIN_POLL_MS);
+        if (n <= 0)
+            continue;
+        int connfd = accept4(m_listenfd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (connfd < 0)
+            continue;
+        serve(connfd);
+        close(connfd);
+    }
+}
+
+// 只支持 GET，读到请求头结束即可，忽略请求体
+void admin_server::serve(int connfd) {
+    struct timeval tv = {ADMIN_IO_TIMEOUT_S, 0};
+    setsockopt(connfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(connfd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    char buf[ADMIN_MAX_REQUEST + 1];
+    size_t len = 0;
+    while (len < ADMIN_MAX_REQUEST) {
+        ssize_t n = recv(connfd, buf + len, ADMIN_MAX_REQUEST - len, 0);
+        if (n <= 0)
+            return;
+        len += n;
+        buf[len] = '\0';
+        if (strstr(buf, "\r\n\r\n") || strstr(buf, "\n\n"))
+            break;
+    }
+    buf[len] = '\0';
+
+    const char *status = "200 OK";
+    const char *content_type = "text/plain; charset=utf-8";
+    std::string body;
+
+    char method[8] = "", target[1024] = "";
+    if (sscanf(buf, "%7s %1023s", method, target) != 2 || strcmp(method, "GET") != 0) {
+        status = "405 Method Not Allowed";
+        body = "only GET is supported\n";
+    } else {
+        std::string path = target, query;
+        size_t q = path.find('?');
+        if (q != std::string::npos) {
+            query = path.substr(q + 1);
+            path.erase(q);
+        }
+        const route *found = nullptr;
+        for (const route &r : m_routes) {
+            if (r.path == path)
+                found = &r;
+        }
+        if (found) {
+            content_type = found->content_type;
+            body = found->h(query);
+        } else {
+            status = "404 Not Found";
+            for (const route &r : m_routes)
+                body += r.path + "\n";
+        }
+    }
+
+    char head[256];
+    int head_len = snprintf(head, sizeof(head),
+                            "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+                            status, content_type, body.size());
+    std::string response(head, head_len);
+    response += body;
+
+    size_t sent = 0;
+    while (sent < response.size()) {
+        ssize_t n = send(connfd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0)
+            return;
+        sent += n;
+    }
+}
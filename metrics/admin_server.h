@@ -0,0 +1,44 @@
+#ifndef ADMIN_SERVER_H
+#define ADMIN_SERVER_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+// 管理端口：独立线程、阻塞 I/O，一次处理一个请求后关闭连接
+// 与业务端口分开，抓取指标不占用任何 SubReactor 的事件循环
+class admin_server {
+public:
+    // 处理函数返回响应体；query 为 '?' 之后的部分（可能为空）
+    typedef std::function<std::string(const std::string &query)> handler;
+
+    admin_server() : m_listenfd(-1), m_port(0) {}
+    ~admin_server() { stop(); }
+
+    // 须在 start 之前登记
+    void add_route(const std::string &path, const char *content_type, handler h);
+
+    // addr 为监听地址（IPv4 点分形式），公开指标时需显式指定 0.0.0.0
+    bool start(const std::string &addr, int port);
+    void stop();
+
+private:
+    void run();
+    void serve(int connfd);
+
+    struct route {
+        std::string path;
+        const char *content_type;
+        handler h;
+    };
+
+    std::vector<route> m_routes;
+    int m_listenfd;
+    int m_port;
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+};
+
+#endif
@@ -0,0 +1,175 @@
+#include "metrics.h"
+
+#include <stdio.h>
+#include "../mydb/sql_connection_pool.h"
+#include "../mydb/local_connection_pool.h"
+#include "../log/log.h"
+#include "../utils/format.h"
+
+thread_local reactor_metrics *reactor_metrics::t_current = nullptr;
+
+double latency_histogram::percentile(const uint64_t *counts, double q) {
+    uint64_t total = 0;
+    for (int i = 0; i < BUCKETS; i++)
+        total += counts[i];
+    if (total == 0)
+        return 0;
+
+    uint64_t rank = (uint64_t)(q * total);
+    if (rank >= total)
+        rank = total - 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        seen += counts[i];
+        if (seen > rank) {
+            uint64_t lo = lower(i);
+            uint64_t hi = i + 1 < BUCKETS ? lower(i + 1) : lo * 2;
+            return (lo + hi) / 2.0;
+        }
+    }
+    return (double)lower(BUCKETS - 1);
+}
+
+metrics_registry *metrics_registry::instance() {
+    static metrics_registry registry;
+    return &registry;
+}
+
+void metrics_registry::add_reactor(int id, const reactor_metrics *metrics, const std::atomic<int> *connections,
+                                   const local_connection_pool *local_pool) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_reactors.push_back(reactor_entry{id, metrics, connections, local_pool});
+}
+
+void metrics_registry::remove_reactor(int id) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < m_reactors.size(); i++) {
+        if (m_reactors[i].id == id) {
+            m_reactors.erase(m_reactors.begin() + i);
+            return;
+        }
+    }
+}
+
+// ========== Prometheus 文本格式 ==========
+
+namespace {
+
+void header(std::string &out, const char *name, const char *type, const char *help) {
+    appendf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+const char *status_code(int slot) {
+    static const char *const codes[reactor_metrics::STATUS_SLOTS] = {"200", "400", "403", "404", "500", "other"};
+    return codes[slot];
+}
+
+}
+
+std::string metrics_registry::render() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::string out;
+    out.reserve(16 * 1024);
+
+    header(out, "webserver_accepts_total", "counter", "Connections handed to each SubReactor.");
+    for (const reactor_entry &r : m_reactors)
+        appendf(out, "webserver_accepts_total{reactor=\"%d\"} %llu\n", r.id,
+                (unsigned long long)r.metrics->accepts.get());
+
+    header(out, "webserver_connections", "gauge", "Open connections per SubReactor.");
+    for (const reactor_entry &r : m_reactors)
+        appendf(out, "webserver_connections{reactor=\"%d\"} %d\n", r.id, r.connections->load(std::memory_order_relaxed));
+
+    header(out, "webserver_requests_total", "counter", "Completed responses by status code.");
+    for (const reactor_entry &r : m_reactors) {
+        for (int s = 0; s < reactor_metrics::STATUS_SLOTS; s++)
+            appendf(out, "webserver_requests_total{reactor=\"%d\",code=\"%s\"} %llu\n", r.id, status_code(s),
+                    (unsigned long long)r.metrics->requests[s].get());
+    }
+
+    header(out, "webserver_sent_bytes_total", "counter", "Response bytes by send path.");
+    for (const reactor_entry &r : m_reactors) {
+        appendf(out, "webserver_sent_bytes_total{reactor=\"%d\",path=\"mmap\"} %llu\n", r.id,
+                (unsigned long long)r.metrics->bytes_mmap.get());
+        appendf(out, "webserver_sent_bytes_total{reactor=\"%d\",path=\"sendfile\"} %llu\n", r.id,
+                (unsigned long long)r.metrics->bytes_sendfile.get());
+    }
+
+    header(out, "webserver_timer_expired_total", "counter", "Connections closed by a phase deadline.");
+    for (const reactor_entry &r : m_reactors)
+        appendf(out, "webserver_timer_expired_total{reactor=\"%d\"} %llu\n", r.id,
+                (unsigned long long)r.metrics->timer_expired.get());
+
+    // 延迟直方图：各 SubReactor 的细粒度计数在这里合并，按 2 的幂输出 le 边界（与细分格对齐，计数精确）
+    std::vector<uint64_t> merged(latency_histogram::BUCKETS, 0);
+    uint64_t sum_us = 0;
+    header(out, "webserver_request_duration_seconds", "histogram", "Time from the first request byte to the last response byte.");
+    for (const reactor_entry &r : m_reactors) {
+        std::vector<uint64_t> counts(latency_histogram::BUCKETS, 0);
+        uint64_t reactor_sum = 0;
+        r.metrics->latency.merge_into(counts.data(), &reactor_sum);
+        for (int i = 0; i < latency_histogram::BUCKETS; i++)
+            merged[i] += counts[i];
+        sum_us += reactor_sum;
+    }
+    uint64_t cumulative = 0;
+    int idx = 0;
+    for (int exp = 4; exp <= 25; exp++) {     // 16us ~ 33.5s
+        uint64_t bound = 1ULL << exp;
+        while (idx < latency_histogram::BUCKETS && latency_histogram::lower(idx) < bound)
+            cumulative += merged[idx++];
+        appendf(out, "webserver_request_duration_seconds_bucket{le=\"%g\"} %llu\n", bound / 1e6,
+                (unsigned long long)cumulative);
+    }
+    while (idx < latency_histogram::BUCKETS)
+        cumulative += merged[idx++];
+    appendf(out, "webserver_request_duration_seconds_bucket{le=\"+Inf\"} %llu\n", (unsigned long long)cumulative);
+    appendf(out, "webserver_request_duration_seconds_sum %.6f\n", sum_us / 1e6);
+    appendf(out, "webserver_request_duration_seconds_count %llu\n", (unsigned long long)cumulative);
+
+    header(out, "webserver_request_duration_quantile_seconds", "gauge", "Latency quantiles from the merged histogram (within 12.5%).");
+    static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+    for (double q : quantiles)
+        appendf(out, "webserver_request_duration_quantile_seconds{quantile=\"%g\"} %.6f\n", q,
+                latency_histogram::percentile(merged.data(), q) / 1e6);
+
+    // 日志
+    Log *log = Log::get_instance();
+    header(out, "webserver_log_queue_bytes", "gauge", "Bytes waiting in the per-thread async log rings.");
+    appendf(out, "webserver_log_queue_bytes %zu\n", log->queued_bytes());
+    header(out, "webserver_log_dropped_total", "counter", "Log lines dropped by the overflow policy.");
+    appendf(out, "webserver_log_dropped_total %llu\n", (unsigned long long)log->dropped_lines());
+
+    // 数据库连接池
+    if (m_pool) {
+        connection_pool::Stats s = m_pool->GetStats();
+        header(out, "webserver_mysql_connections", "gauge", "MySQL pool connections by state.");
+        appendf(out, "webserver_mysql_connections{state=\"in_use\"} %d\n", s.in_use);
+        appendf(out, "webserver_mysql_connections{state=\"idle\"} %d\n", s.idle);
+        header(out, "webserver_mysql_acquire_timeouts_total", "counter", "Pool acquires that timed out.");
+        appendf(out, "webserver_mysql_acquire_timeouts_total %llu\n", s.timeouts);
+
+        // 连接池自带的等待直方图按 10 倍分格：10us ... 1s
+        header(out, "webserver_mysql_wait_seconds", "histogram", "Time spent waiting for a pooled connection.");
+        uint64_t waits = 0;
+        double bound = 1e-5;
+        for (int i = 0; i < connection_pool::WAIT_BUCKETS - 1; i++, bound *= 10) {
+            waits += s.wait_hist[i];
+            appendf(out, "webserver_mysql_wait_seconds_bucket{le=\"%g\"} %llu\n", bound, (unsigned long long)waits);
+        }
+        waits += s.wait_hist[connection_pool::WAIT_BUCKETS - 1];
+        appendf(out, "webserver_mysql_wait_seconds_bucket{le=\"+Inf\"} %llu\n", (unsigned long long)waits);
+        appendf(out, "webserver_mysql_wait_seconds_count %llu\n", (unsigned long long)waits);
+
+        header(out, "webserver_mysql_local_acquires_total", "counter", "Acquires served by each SubReactor's private slice or borrowed from the pool.");
+        for (const reactor_entry &r : m_reactors) {
+            if (!r.local_pool)
+                continue;
+            appendf(out, "webserver_mysql_local_acquires_total{reactor=\"%d\",source=\"slice\"} %llu\n", r.id,
+                    r.local_pool->GetLocalHits());
+            appendf(out, "webserver_mysql_local_acquires_total{reactor=\"%d\",source=\"global\"} %llu\n", r.id,
+                    r.local_pool->GetSteals());
+        }
+    }
+    return out;
+}
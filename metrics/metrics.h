@@ -0,0 +1,129 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class connection_pool;
+class local_connection_pool;
+
+// 运行时指标：每个 SubReactor 一份，只有所属线程写，抓取线程 relaxed 读后合并
+// 写端不加锁、不用 lock 前缀指令；抓取只读原子变量，不进入任何事件循环
+
+// 单写者计数器
+struct metric_counter {
+    std::atomic<uint64_t> value{0};
+
+    void add(uint64_t n = 1) { value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+    uint64_t get() const { return value.load(std::memory_order_relaxed); }
+};
+
+// HDR 风格的对数线性直方图（微秒）：每个 2 的幂区间再分 8 格，相对误差不超过 12.5%
+// 记录只是一次下标计算加一次单写者自增；合并和求分位数在抓取时做
+class latency_histogram {
+public:
+    static const int SUB_BITS = 3;
+    static const int SUB_COUNT = 1 << SUB_BITS;
+    static const int MAX_EXP = 35;                                      // 2^35us 约 9.5 小时，更大的值归入最后一格
+    static const int BUCKETS = SUB_COUNT + (MAX_EXP - SUB_BITS + 1) * SUB_COUNT;
+
+    static int index(uint64_t us) {
+        if (us < (uint64_t)SUB_COUNT)
+            return (int)us;
+        int exp = 63 - __builtin_clzll(us);
+        if (exp > MAX_EXP)
+            return BUCKETS - 1;
+        int sub = (int)(us >> (exp - SUB_BITS)) - SUB_COUNT;
+        return SUB_COUNT + (exp - SUB_BITS) * SUB_COUNT + sub;
+    }
+    // 第 idx 格的下界（含）
+    static uint64_t lower(int idx) {
+        if (idx < SUB_COUNT)
+            return idx;
+        int exp = (idx - SUB_COUNT) / SUB_COUNT + SUB_BITS;
+        int sub = (idx - SUB_COUNT) % SUB_COUNT;
+        return (uint64_t)(SUB_COUNT + sub) << (exp - SUB_BITS);
+    }
+
+    void record(uint64_t us) {
+        m_counts[index(us)].add();
+        m_sum.add(us);
+    }
+
+    // 累加到 counts（长度 BUCKETS）和 sum
+    void merge_into(uint64_t *counts, uint64_t *sum) const {
+        for (int i = 0; i < BUCKETS; i++)
+            counts[i] += m_counts[i].get();
+        *sum += m_sum.get();
+    }
+
+    // 在合并后的计数上求分位数，返回所在格的中点（微秒）
+    static double percentile(const uint64_t *counts, double q);
+
+private:
+    metric_counter m_counts[BUCKETS];
+    metric_counter m_sum;
+};
+
+// 一个 SubReactor 的指标
+struct reactor_metrics {
+    // 按状态码统计的请求数（http_conn 只会产生这几种）
+    enum STATUS_SLOT { STATUS_200 = 0, STATUS_400, STATUS_403, STATUS_404, STATUS_500, STATUS_OTHER, STATUS_SLOTS };
+    static int status_slot(int status) {
+        switch (status) {
+            case 200: return STATUS_200;
+            case 400: return STATUS_400;
+            case 403: return STATUS_403;
+            case 404: return STATUS_404;
+            case 500: return STATUS_500;
+            default:  return STATUS_OTHER;
+        }
+    }
+
+    metric_counter accepts;                     // 分配到本 SubReactor 的连接
+    metric_counter requests[STATUS_SLOTS];
+    metric_counter bytes_mmap;                  // writev 发出的字节（响应头 + mmap 的小文件）
+    metric_counter bytes_sendfile;              // sendfile 路径发出的字节（含响应头）
+    metric_counter timer_expired;               // 按期限关闭的连接
+    latency_histogram latency;                  // 读到请求第一个字节到响应写完
+    int reactor = -1;                           // 所属 SubReactor 编号（USDT 探针参数）
+
+    // 当前线程所属 SubReactor 的指标（非 SubReactor 线程为 nullptr）
+    static reactor_metrics *current() { return t_current; }
+    static void set_current(reactor_metrics *metrics) { t_current = metrics; }
+
+private:
+    static thread_local reactor_metrics *t_current;
+};
+
+// 指标登记表：SubReactor 创建时登记，抓取时按 Prometheus 文本格式输出
+class metrics_registry {
+public:
+    static metrics_registry *instance();
+
+    void add_reactor(int id, const reactor_metrics *metrics, const std::atomic<int> *connections,
+                     const local_connection_pool *local_pool);
+    void remove_reactor(int id);
+    void set_pool(connection_pool *pool) { m_pool = pool; }
+
+    std::string render();
+
+private:
+    metrics_registry() : m_pool(nullptr) {}
+
+    struct reactor_entry {
+        int id;
+        const reactor_metrics *metrics;
+        const std::atomic<int> *connections;
+        const local_connection_pool *local_pool;
+    };
+
+    std::mutex m_mutex;                         // 只保护登记表，写端从不获取
+    std::vector<reactor_entry> m_reactors;
+    connection_pool *m_pool;                    // 使用 MySQL 时的全局连接池
+};
+
+#endif
@@ -0,0 +1,155 @@
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../utils/clock.h"
+#include "../utils/format.h"
+#include "../utils/seq_ring.h"
+
+thread_local request_tracer *request_tracer::t_current = nullptr;
+
+static const char *const PHASE_NAMES[TRACE_PHASES] = {
+    "request", "queue", "sql_wait", "read_once", "process", "db_acquire", "db_query", "build_response", "write"
+};
+
+// 前三种阶段跨越多轮事件循环，与其他连接的阶段交错，导出为异步区间
+static bool is_async_phase(uint32_t phase) {
+    return phase == TRACE_REQUEST || phase == TRACE_QUEUE || phase == TRACE_SQL_WAIT;
+}
+
+void request_tracer::init(int reactor, int sample_every, size_t capacity) {
+    m_reactor = reactor;
+    m_sample_every = sample_every > 0 ? sample_every : 0;
+    m_sample_count = 0;
+    if (m_sample_every > 0)
+        m_records.assign(capacity, trace_record());
+}
+
+// 只由所属 SubReactor 线程调用，/debug/trace 在管理线程上并发读
+void request_tracer::record(uint32_t request, int fd, TRACE_PHASE phase, uint64_t begin, uint64_t end) {
+    if (m_records.empty())
+        return;
+
+    uint64_t seq = m_next_seq.load(std::memory_order_relaxed);
+    trace_record *rec = &m_records[seq % m_records.size()];
+    seq_slot_open(&rec->seq);
+
+    rec->begin = begin;
+    rec->end = end;
+    rec->request = request;
+    rec->fd = fd;
+    rec->phase = phase;
+    rec->reserved = 0;
+
+    seq_slot_publish(&rec->seq, seq + 1);
+    m_next_seq.store(seq + 1, std::memory_order_release);
+}
+
+// 读取期间被覆盖的槽（前后两次序号不一致）直接跳过
+void request_tracer::snapshot(std::vector<trace_record> &out) const {
+    size_t capacity = m_records.size();
+    if (capacity == 0)
+        return;
+
+    uint64_t next = m_next_seq.load(std::memory_order_acquire);
+    uint64_t first = next > capacity ? next - capacity : 0;
+    for (uint64_t seq = first; seq < next; seq++) {
+        const trace_record *slot = &m_records[seq % capacity];
+        if (!seq_slot_ready(&slot->seq, seq + 1))
+            continue;
+        trace_record copy;
+        copy.begin = slot->begin;
+        copy.end = slot->end;
+        copy.request = slot->request;
+        copy.fd = slot->fd;
+        copy.phase = slot->phase;
+        if (!seq_slot_unchanged(&slot->seq, seq + 1))
+            continue;
+        copy.seq = seq + 1;
+        if (copy.phase < TRACE_PHASES)
+            out.push_back(copy);
+    }
+}
+
+trace_registry *trace_registry::instance() {
+    static trace_registry registry;
+    return &registry;
+}
+
+trace_registry::trace_registry() : m_base_ticks(trace_ticks()), m_base_ns(mono_ns()) {}
+
+void trace_registry::add_tracer(const request_tracer *tracer) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tracers.push_back(tracer);
+}
+
+void trace_registry::remove_tracer(const request_tracer *tracer) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < m_tracers.size(); i++) {
+        if (m_tracers[i] == tracer) {
+            m_tracers.erase(m_tracers.begin() + i);
+            return;
+        }
+    }
+}
+
+// ========== Chrome trace JSON ==========
+
+// 同步阶段在所属 SubReactor 的线程轨道上按嵌套显示（"X"）；
+// 异步阶段以 "reactor.request" 为 id 单独成轨（"b"/"e"），同一请求的异步区间叠在一起
+std::string trace_registry::render_chrome(const std::string &query) {
+    long window_ms = 0;
+    size_t pos = query.find("ms=");
+    if (pos != std::string::npos && (pos == 0 || query[pos - 1] == '&'))
+        window_ms = atol(query.c_str() + pos + 3);
+
+    // TSC 频率：进程启动以来的 TSC 增量 / 单调时钟增量；刚启动时间隔太短，先等一会
+    uint64_t now_ns = mono_ns();
+    if (now_ns - m_base_ns < 10000000ULL) {
+        struct timespec wait = {0, 10000000L};
+        nanosleep(&wait, nullptr);
+    }
+    uint64_t now_ticks = trace_ticks();
+    now_ns = mono_ns();
+    double ticks_per_us = (double)(now_ticks - m_base_ticks) * 1000.0 / (double)(now_ns - m_base_ns);
+    if (ticks_per_us <= 0)
+        ticks_per_us = 1000.0;
+    uint64_t cutoff = 0;
+    if (window_ms > 0 && (double)window_ms * 1000.0 * ticks_per_us < (double)now_ticks)
+        cutoff = now_ticks - (uint64_t)((double)window_ms * 1000.0 * ticks_per_us);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::string out;
+    out.reserve(64 * 1024);
+    out += "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    appendf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"webserver\"}}");
+
+    std::vector<trace_record> records;
+    for (const request_tracer *tracer : m_tracers) {
+        int tid = tracer->reactor();
+        appendf(out, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"SubReactor %d\"}}",
+                tid, tid);
+
+        records.clear();
+        tracer->snapshot(records);
+        for (const trace_record &r : records) {
+            if (r.end < cutoff || r.end < r.begin || r.begin < m_base_ticks)
+                continue;
+            double ts = (double)(r.begin - m_base_ticks) / ticks_per_us;
+            double dur = (double)(r.end - r.begin) / ticks_per_us;
+            const char *name = PHASE_NAMES[r.phase];
+            if (is_async_phase(r.phase)) {
+                appendf(out, ",\n{\"name\":\"%s\",\"cat\":\"request\",\"ph\":\"b\",\"id\":\"%d.%u\",\"pid\":1,\"tid\":%d,"
+                        "\"ts\":%.3f,\"args\":{\"fd\":%d}}", name, tid, r.request, tid, ts, r.fd);
+                appendf(out, ",\n{\"name\":\"%s\",\"cat\":\"request\",\"ph\":\"e\",\"id\":\"%d.%u\",\"pid\":1,\"tid\":%d,"
+                        "\"ts\":%.3f}", name, tid, r.request, tid, ts + dur);
+            } else {
+                appendf(out, ",\n{\"name\":\"%s\",\"cat\":\"phase\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,"
+                        "\"dur\":%.3f,\"args\":{\"req\":\"%d.%u\",\"fd\":%d}}", name, tid, ts, dur, tid, r.request, r.fd);
+            }
+        }
+    }
+    out += "\n]}\n";
+    return out;
+}
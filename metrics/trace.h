@@ -0,0 +1,170 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <time.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// 请求阶段追踪：按采样率挑出部分请求，记录各阶段的 TSC 起止时间
+// 每个 SubReactor 一个环形缓冲区，只有所属线程写；管理端口按需导出为 Chrome/Perfetto trace JSON
+
+// 时间戳：x86 上直接读 TSC（不陷入内核、不走 vDSO），其他平台退回单调时钟纳秒
+// 导出时用两次 (TSC, 单调时钟) 采样换算成微秒，要求 CPU 支持恒定频率 TSC（constant_tsc）
+inline uint64_t trace_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+enum TRACE_PHASE {
+    TRACE_REQUEST = 0,      // 读到请求第一个字节到响应写完（异步区间）
+    TRACE_QUEUE,            // 主 Reactor 分发后在 m_pending_connections 中等待（异步区间）
+    TRACE_SQL_WAIT,         // 等待非阻塞数据库查询完成（异步区间）
+    TRACE_READ,             // read_once
+    TRACE_PARSE,            // process：解析并处理请求（包含下面两项）
+    TRACE_DB_ACQUIRE,       // 获取数据库连接（ConnectionGuard）
+    TRACE_DB_QUERY,         // 执行 SQL
+    TRACE_BUILD,            // 异步查询完成后构建响应
+    TRACE_WRITE,            // write
+    TRACE_PHASES
+};
+
+// 一条阶段记录，seq 最后写入：读者看到的 seq 与期望一致即为完整记录
+struct trace_record {
+    uint64_t seq;           // 序号 + 1，0 表示正在写或未使用
+    uint64_t begin;
+    uint64_t end;
+    uint32_t request;       // 本 SubReactor 内的请求编号
+    int32_t fd;
+    uint32_t phase;
+    uint32_t reserved;
+};
+
+class request_tracer {
+public:
+    request_tracer()
+        : m_reactor(0), m_sample_every(0), m_sample_count(0), m_next_request(0), m_active(0), m_active_fd(-1) {}
+
+    // sample_every: 每 N 个请求追踪一个，0 关闭
+    void init(int reactor, int sample_every, size_t capacity);
+    bool enabled() const { return m_sample_every > 0; }
+    int reactor() const { return m_reactor; }
+
+    // 新请求开始时调用：被采样则返回非 0 的请求编号
+    uint32_t begin_request() {
+        if (++m_sample_count < m_sample_every)
+            return 0;
+        m_sample_count = 0;
+        if (++m_next_request == 0)
+            ++m_next_request;
+        return m_next_request;
+    }
+
+    void record(uint32_t request, int fd, TRACE_PHASE phase, uint64_t begin, uint64_t end);
+
+    // 正在执行的阶段所属的请求，嵌套的阶段（数据库）不知道连接，从这里取
+    uint32_t active() const { return m_active; }
+    int active_fd() const { return m_active_fd; }
+    void set_active(uint32_t request, int fd) { m_active = request; m_active_fd = fd; }
+
+    // 抓取线程调用：复制出仍完整的记录
+    void snapshot(std::vector<trace_record> &out) const;
+
+    // 当前线程所属 SubReactor 的追踪器（未开启追踪为 nullptr）
+    static request_tracer *current() { return t_current; }
+    static void set_current(request_tracer *tracer) { t_current = tracer; }
+
+private:
+    int m_reactor;
+    int m_sample_every;
+    int m_sample_count;
+    uint32_t m_next_request;
+    uint32_t m_active;
+    int m_active_fd;
+    std::vector<trace_record> m_records;
+    std::atomic<uint64_t> m_next_seq{0};
+
+    static thread_local request_tracer *t_current;
+};
+
+// RAII 阶段区间：request 为 0 时不记录，构造和析构各读一次 TSC
+// 不指定请求时沿用外层区间的请求（用于数据库等不持有连接的代码）
+class trace_span {
+public:
+    trace_span(uint32_t request, int fd, TRACE_PHASE phase) : m_tracer(nullptr) {
+        if (request)
+            start(request_tracer::current(), request, fd, phase);
+    }
+    explicit trace_span(TRACE_PHASE phase) : m_tracer(nullptr) {
+        request_tracer *tracer = request_tracer::current();
+        if (tracer && tracer->active())
+            start(tracer, tracer->active(), tracer->active_fd(), phase);
+    }
+    ~trace_span() { end(); }
+
+    // 提前结束（区间比所在作用域短时）
+    void end() {
+        if (!m_tracer)
+            return;
+        m_tracer->record(m_request, m_fd, m_phase, m_begin, trace_ticks());
+        m_tracer->set_active(m_outer, m_outer_fd);
+        m_tracer = nullptr;
+    }
+
+private:
+    void start(request_tracer *tracer, uint32_t request, int fd, TRACE_PHASE phase) {
+        if (!tracer)
+            return;
+        m_tracer = tracer;
+        m_request = request;
+        m_fd = fd;
+        m_phase = phase;
+        m_outer = tracer->active();
+        m_outer_fd = tracer->active_fd();
+        tracer->set_active(request, fd);
+        m_begin = trace_ticks();
+    }
+
+    request_tracer *m_tracer;
+    uint32_t m_request;
+    int m_fd;
+    TRACE_PHASE m_phase;
+    uint32_t m_outer;
+    int m_outer_fd;
+    uint64_t m_begin;
+
+    trace_span(const trace_span &) = delete;
+    trace_span &operator=(const trace_span &) = delete;
+};
+
+// 追踪器登记表：SubReactor 创建时登记，/debug/trace 导出
+class trace_registry {
+public:
+    static trace_registry *instance();
+
+    void add_tracer(const request_tracer *tracer);
+    void remove_tracer(const request_tracer *tracer);
+
+    // query 支持 ms=N：只导出最近 N 毫秒内结束的区间
+    std::string render_chrome(const std::string &query);
+
+private:
+    trace_registry();
+
+    std::mutex m_mutex;
+    std::vector<const request_tracer *> m_tracers;
+    uint64_t m_base_ticks;                      // 进程启动时的 (TSC, 单调时钟) 采样，用于换算
+    uint64_t m_base_ns;
+};
+
+#endif
@@ -0,0 +1,201 @@
+#include "async_sql.h"
+
+async_sql_executor::async_sql_executor(local_connection_pool *pool, int epollfd, int max_inflight)
+    : m_pool(pool), m_epollfd(epollfd), m_max_inflight(max_inflight > 0 ? max_inflight : 1),
+      m_timeout_ms(5000) { }
+
+async_sql_executor::~async_sql_executor() {
+    // 执行中的连接状态未知，直接关闭
+    for (auto &kv : m_running) {
+        epoll_ctl(m_epollfd, EPOLL_CTL_DEL, kv.first, 0);
+        m_pool->ReleaseConnection(kv.second.conn, true);
+    }
+    m_running.clear();
+}
+
+bool async_sql_executor::supported() {
+#ifdef ASYNC_SQL
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef ASYNC_SQL
+// MySQL等待状态 -> epoll事件
+static uint32_t wait_to_epoll(int status) {
+    uint32_t ev = 0;
+    if (status & MYSQL_WAIT_READ) ev |= EPOLLIN;
+    if (status & MYSQL_WAIT_WRITE) ev |= EPOLLOUT;
+    if (status & MYSQL_WAIT_EXCEPT) ev |= EPOLLPRI;
+    return ev;
+}
+
+// epoll事件 -> MySQL等待状态
+static int epoll_to_wait(uint32_t events) {
+    int status = 0;
+    if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) status |= MYSQL_WAIT_READ;
+    if (events & EPOLLOUT) status |= MYSQL_WAIT_WRITE;
+    if (events & EPOLLPRI) status |= MYSQL_WAIT_EXCEPT;
+    return status;
+}
+#endif
+
+bool async_sql_executor::submit(int owner_fd, const char *sql) {
+    if (!supported() || m_waiting.size() >= MAX_WAITING)
+        return false;
+
+    m_waiting.push_back({owner_fd, sql, nullptr, std::chrono::steady_clock::now()});
+    start_waiting();
+    return true;
+}
+
+async_sql_executor::START_RESULT async_sql_executor::start_job(Job &job) {
+#ifdef ASYNC_SQL
+    // 不等待、不ping、不建连：拿不到连接就继续排队，由完成的查询归还连接或维护线程补上连接后再发起
+    MYSQL *conn = m_pool->TryGetConnection();
+    if (!conn)
+        return START_NO_CONN;
+
+    job.conn = conn;
+    job.start = std::chrono::steady_clock::now();
+
+    int err = 0;
+    int status = mysql_real_query_start(&err, conn, job.sql.c_str(), job.sql.size());
+    if (status == 0) {
+        finish_job(job, err);
+        return START_DONE;
+    }
+
+    int fd = mysql_get_socket(conn);
+    epoll_event event;
+    event.data.fd = fd;
+    event.events = wait_to_epoll(status);
+    epoll_ctl(m_epollfd, EPOLL_CTL_ADD, fd, &event);
+
+    m_running.emplace(fd, std::move(job));
+    return START_RUNNING;
+#else
+    (void)job;
+    return START_NO_CONN;
+#endif
+}
+
+// 在并发上限内依次发起排队的查询
+void async_sql_executor::start_waiting() {
+    while (!m_waiting.empty() && (int)m_running.size() < m_max_inflight) {
+        Job job = std::move(m_waiting.front());
+        m_waiting.pop_front();
+
+        START_RESULT ret = start_job(job);
+        if (ret != START_NO_CONN)
+            continue;
+
+        // 没有执行中的查询可以归还连接：等维护线程检测/扩容，由定时器重试，超过获取超时才失败
+        if (m_running.empty() &&
+            std::chrono::steady_clock::now() - job.start > std::chrono::milliseconds(m_pool->GetAcquireTimeoutMs())) {
+            LOG_WARN("Async SQL: no database connection available, fd=%d", job.owner_fd);
+            if (job.owner_fd >= 0)
+                m_done.push_back({job.owner_fd, false});
+            continue;
+        }
+
+        m_waiting.push_front(std::move(job));
+        break;
+    }
+}
+
+void async_sql_executor::finish_job(Job &job, int err) {
+    bool broken = false;
+    if (err) {
+        LOG_ERROR("Async SQL error: %s", mysql_error(job.conn));
+        broken = connection_pool::IsConnectionError(job.conn);
+    }
+    m_pool->ReleaseConnection(job.conn, broken);
+    job.conn = nullptr;
+
+    if (job.owner_fd >= 0)
+        m_done.push_back({job.owner_fd, err == 0});
+}
+
+void async_sql_executor::on_event(int db_fd, uint32_t events) {
+#ifdef ASYNC_SQL
+    auto it = m_running.find(db_fd);
+    if (it == m_running.end())
+        return;
+
+    int err = 0;
+    int status = mysql_real_query_cont(&err, it->second.conn, epoll_to_wait(events));
+    if (status != 0) {
+        epoll_event event;
+        event.data.fd = db_fd;
+        event.events = wait_to_epoll(status);
+        epoll_ctl(m_epollfd, EPOLL_CTL_MOD, db_fd, &event);
+        return;
+    }
+
+    epoll_ctl(m_epollfd, EPOLL_CTL_DEL, db_fd, 0);
+    Job job = std::move(it->second);
+    m_running.erase(it);
+    finish_job(job, err);
+
+    // 连接已归还，发起下一个排队的查询
+    start_waiting();
+#else
+    (void)db_fd;
+    (void)events;
+#endif
+}
+
+void async_sql_executor::cancel(int owner_fd) {
+    for (auto it = m_waiting.begin(); it != m_waiting.end(); ++it) {
+        if (it->owner_fd == owner_fd) {
+            m_waiting.erase(it);
+            return;
+        }
+    }
+    // 执行中的语句让它跑完，只是不再通知（fd可能被新连接复用）
+    for (auto &kv : m_running) {
+        if (kv.second.owner_fd == owner_fd) {
+            kv.second.owner_fd = -1;
+            return;
+        }
+    }
+    for (auto &done : m_done) {
+        if (done.first == owner_fd)
+            done.first = -1;
+    }
+}
+
+void async_sql_executor::expire() {
+    if (m_running.empty() && m_waiting.empty())
+        return;
+
+    auto now = std::chrono::steady_clock::now();
+    for (auto it = m_running.begin(); it != m_running.end(); ) {
+        if (now - it->second.start < std::chrono::milliseconds(m_timeout_ms)) {
+            ++it;
+            continue;
+        }
+        LOG_WARN("Async SQL: query timed out after %d ms, fd=%d", m_timeout_ms, it->second.owner_fd);
+        epoll_ctl(m_epollfd, EPOLL_CTL_DEL, it->first, 0);
+        m_pool->ReleaseConnection(it->second.conn, true);
+        if (it->second.owner_fd >= 0)
+            m_done.push_back({it->second.owner_fd, false});
+        it = m_running.erase(it);
+    }
+    start_waiting();
+}
+
+bool async_sql_executor::pop_completion(int *owner_fd, bool *ok) {
+    while (!m_done.empty()) {
+        auto done = m_done.front();
+        m_done.pop_front();
+        if (done.first < 0)
+            continue;
+        *owner_fd = done.first;
+        *ok = done.second;
+        return true;
+    }
+    return false;
+}
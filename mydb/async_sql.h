@@ -0,0 +1,77 @@
+#ifndef _ASYNC_SQL_
+#define _ASYNC_SQL_
+
+#include <mysql/mysql.h>
+#include <sys/epoll.h>
+#include <string>
+#include <deque>
+#include <unordered_map>
+#include <chrono>
+#include "local_connection_pool.h"
+
+// 非阻塞MySQL执行器（需MariaDB Connector/C，编译时定义 ASYNC_SQL）
+// 由所属SubReactor线程独占：MySQL socket 注册到该SubReactor的epoll中，
+// 查询由事件循环推进，发起查询的 http_conn 在完成前挂起，不阻塞I/O线程
+class async_sql_executor {
+public:
+    async_sql_executor(local_connection_pool *pool, int epollfd, int max_inflight);
+    ~async_sql_executor();
+
+    // 当前构建是否支持非阻塞API
+    static bool supported();
+
+    // 提交一条不返回结果集的语句（INSERT/UPDATE），owner_fd 为发起请求的客户端fd
+    bool submit(int owner_fd, const char *sql);
+
+    // 是否为本执行器注册的MySQL socket
+    bool owns_fd(int fd) const { return !m_running.empty() && m_running.count(fd) != 0; }
+
+    // MySQL socket 就绪，继续推进查询
+    void on_event(int db_fd, uint32_t events);
+
+    // 客户端连接关闭：排队中的直接丢弃，执行中的与客户端解绑，结果不再投递
+    void cancel(int owner_fd);
+
+    // 清理执行时间过长的查询，重试等待连接的查询（由定时器周期调用）
+    void expire();
+
+    // 是否有排队或执行中的查询（有则需要定时器周期唤醒检查超时）
+    bool busy() const { return !m_waiting.empty() || !m_running.empty(); }
+
+    // 有排队的查询却没有执行中的查询，在等维护线程补连接，需要尽快重试
+    bool starved() const { return m_running.empty() && !m_waiting.empty(); }
+
+    // 取出一个已完成的查询结果
+    bool pop_completion(int *owner_fd, bool *ok);
+
+private:
+    struct Job {
+        int owner_fd;
+        std::string sql;
+        MYSQL *conn;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    enum START_RESULT {
+        START_RUNNING,      // 已发起，等待socket事件
+        START_DONE,         // 立即完成
+        START_NO_CONN       // 暂无可用连接
+    };
+
+    START_RESULT start_job(Job &job);
+    void start_waiting();
+    void finish_job(Job &job, int err);
+
+    local_connection_pool *m_pool;
+    int m_epollfd;
+    int m_max_inflight;                         // 同时执行的查询数（占用的连接数）上限
+    int m_timeout_ms;                           // 单条查询最长执行时间
+
+    std::deque<Job> m_waiting;                  // 等待连接的查询
+    std::unordered_map<int, Job> m_running;     // 执行中的查询，key为MySQL socket fd
+    std::deque<std::pair<int, bool>> m_done;    // 已完成: (owner_fd, 是否成功)
+
+    static const size_t MAX_WAITING = 4096;
+};
+
+#endif
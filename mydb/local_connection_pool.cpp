@@ -0,0 +1,90 @@
+#include "local_connection_pool.h"
+#include "../utils/probes.h"
+
+thread_local local_connection_pool *local_connection_pool::t_current = nullptr;
+
+local_connection_pool::local_connection_pool(connection_pool *global)
+    : m_global(global), m_slice_size(0) { }
+
+local_connection_pool::~local_connection_pool() {
+    DestoryPool();
+}
+
+void local_connection_pool::init(int slice_size) {
+    m_slice_size = slice_size > 0 ? slice_size : 0;
+    m_free.reserve(m_slice_size);
+
+    // 数据库暂不可用时切片可能不满，之后借用的连接归还时会补进来
+    auto now = std::chrono::steady_clock::now();
+    for (int i = 0; i < m_slice_size; i++) {
+        MYSQL *con = m_global->GetConnection();
+        if (!con)
+            break;
+        m_free.push_back({con, now});
+    }
+}
+
+// 优先从本地切片取连接，本地用完再向全局池借用
+MYSQL *local_connection_pool::GetConnection(int timeout_ms) {
+    while (!m_free.empty()) {
+        LocalConn local = m_free.back();
+        m_free.pop_back();
+
+        // 本地切片不受全局维护线程管理，空闲过久的借出前先ping
+        if (std::chrono::steady_clock::now() - local.last_used >
+                std::chrono::milliseconds(m_global->GetPingIntervalMs()) &&
+            mysql_ping(local.conn) != 0) {
+            LOG_WARN("Local MySQL slice: connection lost (%s), dropping", mysql_error(local.conn));
+            m_global->ReleaseConnection(local.conn, true);
+            continue;
+        }
+
+        bump(m_local_hits);
+        WS_PROBE3(db__acquire, 0LL, 1, 1);
+        return local.conn;
+    }
+
+    bump(m_steals);
+    return m_global->GetConnection(timeout_ms);
+}
+
+MYSQL *local_connection_pool::TryGetConnection() {
+    auto now = std::chrono::steady_clock::now();
+    while (!m_free.empty()) {
+        LocalConn local = m_free.back();
+        m_free.pop_back();
+
+        // 栈顶最近归还，它都过了检测间隔，其余的也一样：全部交给全局维护线程ping
+        if (now - local.last_used > std::chrono::milliseconds(m_global->GetPingIntervalMs())) {
+            m_global->ReleaseUnchecked(local.conn, local.last_used);
+            continue;
+        }
+
+        bump(m_local_hits);
+        WS_PROBE3(db__acquire, 0LL, 1, 1);
+        return local.conn;
+    }
+
+    bump(m_steals);
+    return m_global->TryGetConnection();
+}
+
+// 本地切片未满时留在本地，否则归还全局池
+bool local_connection_pool::ReleaseConnection(MYSQL *conn, bool broken) {
+    if (!conn) return false;
+
+    if (broken || (int)m_free.size() >= m_slice_size) {
+        return m_global->ReleaseConnection(conn, broken);
+    }
+
+    m_free.push_back({conn, std::chrono::steady_clock::now()});
+    WS_PROBE2(db__release, 0, 1);
+    return true;
+}
+
+void local_connection_pool::DestoryPool() {
+    for (auto &local : m_free) {
+        m_global->ReleaseConnection(local.conn);
+    }
+    m_free.clear();
+}
@@ -0,0 +1,60 @@
+#ifndef _LOCAL_CONNECTION_POOL_
+#define _LOCAL_CONNECTION_POOL_
+
+#include <mysql/mysql.h>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include "sql_connection_pool.h"
+
+// SubReactor私有的连接切片
+// 只由所属SubReactor线程访问，获取/归还不加锁；本地切片用完时才向全局池借用
+class local_connection_pool {
+public:
+    explicit local_connection_pool(connection_pool *global);
+    ~local_connection_pool();
+
+    // 从全局池预留 slice_size 个连接（0 表示不使用私有切片，直接走全局池）
+    void init(int slice_size);
+
+    MYSQL *GetConnection(int timeout_ms = -1);
+    // 非阻塞获取（异步SQL在事件循环中调用）：不ping、不建连，较久未用的连接交还全局池检测
+    MYSQL *TryGetConnection();
+    bool ReleaseConnection(MYSQL *conn, bool broken = false);
+
+    // 将私有切片中的连接全部归还全局池
+    void DestoryPool();
+
+    int GetFreeConn() const { return (int)m_free.size(); }
+    int GetAcquireTimeoutMs() const { return m_global->GetAcquireTimeoutMs(); }
+    unsigned long long GetLocalHits() const { return m_local_hits.load(std::memory_order_relaxed); }
+    unsigned long long GetSteals() const { return m_steals.load(std::memory_order_relaxed); }
+
+    // 当前线程所属SubReactor的私有切片（非SubReactor线程为nullptr）
+    static local_connection_pool *current() { return t_current; }
+    static void set_current(local_connection_pool *pool) { t_current = pool; }
+
+private:
+    struct LocalConn {
+        MYSQL *conn;
+        std::chrono::steady_clock::time_point last_used;
+    };
+
+    // 单写者计数，避免 lock 前缀指令
+    static void bump(std::atomic<unsigned long long> &counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    connection_pool *m_global;          // 全局溢出池
+    int m_slice_size;                   // 私有切片容量
+    std::vector<LocalConn> m_free;      // 空闲连接栈，容量固定为 m_slice_size，归还不分配内存
+
+    std::atomic<unsigned long long> m_local_hits{0};  // 命中本地切片次数
+    std::atomic<unsigned long long> m_steals{0};      // 向全局池借用次数
+
+    static thread_local local_connection_pool *t_current;
+};
+
+using LocalConnectionGuard = BasicConnectionGuard<local_connection_pool>;
+
+#endif
@@ -1,24 +1,32 @@
 #include <mysql/mysql.h>
+#include <mysql/errmsg.h>
 #include <stdio.h>
 #include <string>
 #include <string.h>
 #include <stdlib.h>
-#include <list>
 #include <pthread.h>
 #include <iostream>
+#include <algorithm>
 #include "sql_connection_pool.h"
+#include "../utils/probes.h"
 
-connection_pool::connection_pool() 
-    : m_CurConn(0), m_FreeConn(0), m_MaxConn(0) { }
+connection_pool::connection_pool()
+    : m_MinConn(0), m_MaxConn(0), m_TotalConn(0), m_CurConn(0), m_FreeConn(0),
+      m_AcquireTimeoutMs(500), m_PingIntervalMs(10000), m_IdleTimeoutMs(60000),
+      m_stop(false), m_maintain_wanted(false), m_Port(3306), m_close_log(0) {
+    for (int i = 0; i < WAIT_BUCKETS; i++)
+        m_wait_hist[i] = 0;
+}
 
 connection_pool* connection_pool::GetInstance() {
     static connection_pool instance;
     return &instance;
 }
 
-// 构造初始化
+// 构造初始化：预先建立 minConn 个连接，建连失败只记录日志，后续按需再建
 void connection_pool::init(const std::string& url, const std::string& user, const std::string& password,
-                            const std::string& dbName, int port, int maxConn, int close_log){
+                            const std::string& dbName, int port, int minConn, int maxConn,
+                            int acquire_timeout_ms, int close_log){
     m_url = url;
 	m_Port = port;
 	m_User = user;
@@ -26,52 +34,223 @@ void connection_pool::init(const std::string& url, const std::string& user, cons
 	m_DataBaseName = dbName;
 	m_close_log = close_log;
 
-    for (int i = 0;i < maxConn; i++){
-        MYSQL* con = mysql_init(nullptr);
+    if (maxConn < 1) maxConn = 1;
+    if (minConn < 0) minConn = 0;
+    if (minConn > maxConn) minConn = maxConn;
+    m_MinConn = minConn;
+    m_MaxConn = maxConn;
+    m_AcquireTimeoutMs = acquire_timeout_ms;
+
+    for (int i = 0; i < minConn; i++){
+        MYSQL* con = CreateConnection();
+        if (!con)
+            break;  // 数据库暂不可用，交给维护线程补足
+
+        auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(mtx);
+        connList.push_back({con, now, now});
+        ++m_TotalConn;
+        ++m_FreeConn;
+    }
+
+    if (m_FreeConn < minConn) {
+        LOG_ERROR("MySQL pool: only %d/%d connections opened at startup", m_FreeConn, minConn);
+    }
+    LOG_INFO("MySQL pool: min=%d, max=%d, acquire timeout=%d ms", m_MinConn, m_MaxConn, m_AcquireTimeoutMs);
+
+    m_stop = false;
+    m_maintain_thread = std::thread(&connection_pool::MaintainLoop, this);
+}
+
+MYSQL *connection_pool::CreateConnection() {
+    MYSQL* con = mysql_init(nullptr);
+    if (!con){
+        LOG_ERROR("MySQL Init Error");
+        ++m_connect_failures;
+        return nullptr;
+    }
+
+    // 限制建连和读写阻塞时间，数据库抖动时不至于卡死SubReactor
+    unsigned int connect_timeout = 2;
+    unsigned int rw_timeout = 3;
+    mysql_options(con, MYSQL_OPT_CONNECT_TIMEOUT, &connect_timeout);
+    mysql_options(con, MYSQL_OPT_READ_TIMEOUT, &rw_timeout);
+    mysql_options(con, MYSQL_OPT_WRITE_TIMEOUT, &rw_timeout);
+#ifdef ASYNC_SQL
+    // 开启非阻塞API支持，同一连接仍可使用阻塞调用
+    mysql_options(con, MYSQL_OPT_NONBLOCK, 0);
+#endif
+
+    if (!mysql_real_connect(con, m_url.c_str(), m_User.c_str(), m_PassWord.c_str(),
+                            m_DataBaseName.c_str(), m_Port, NULL, 0)){
+        LOG_ERROR("MySQL Connect Error: %s", mysql_error(con));
+        mysql_close(con);
+        ++m_connect_failures;
+        return nullptr;
+    }
+
+    ++m_created;
+    return con;
+}
+
+void connection_pool::CloseConnection(MYSQL *conn) {
+    if (!conn) return;
+    mysql_close(conn);
+    ++m_destroyed;
+}
+
+bool connection_pool::IsConnectionError(MYSQL *conn) {
+    if (!conn) return true;
+    unsigned int err = mysql_errno(conn);
+    return err == CR_SERVER_GONE_ERROR || err == CR_SERVER_LOST ||
+           err == CR_CONNECTION_ERROR || err == CR_CONN_HOST_ERROR;
+}
 
-        if (!con){
-            LOG_ERROR("MySQL Init Error");
-            throw std::runtime_error("MySQL Init Error");
+long long connection_pool::RecordWait(std::chrono::steady_clock::duration waited) {
+    long long us = std::chrono::duration_cast<std::chrono::microseconds>(waited).count();
+    int idx = 0;
+    long long bound = 10;
+    while (idx < WAIT_BUCKETS - 1 && us >= bound) {
+        bound *= 10;
+        idx++;
+    }
+    m_wait_hist[idx].fetch_add(1, std::memory_order_relaxed);
+    return us;
+}
+
+const char *connection_pool::WaitBucketName(int idx) {
+    static const char *names[WAIT_BUCKETS] = {
+        "<10us", "<100us", "<1ms", "<10ms", "<100ms", "<1s", ">=1s"
+    };
+    return (idx >= 0 && idx < WAIT_BUCKETS) ? names[idx] : "?";
+}
+
+// 获取连接：优先复用空闲连接，不足时在上限内扩容，否则等待至超时
+MYSQL *connection_pool::GetConnection(int timeout_ms){
+    if (timeout_ms < 0)
+        timeout_ms = m_AcquireTimeoutMs;
+
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::milliseconds(timeout_ms);
+
+    IdleConn idle{nullptr, start, start};
+    bool need_create = false;
+    {
+        std::unique_lock<std::mutex> lock(mtx);  // 条件变量等待需要 unique_lock
+        bool ready = cv.wait_until(lock, deadline, [this] {
+            return !connList.empty() || m_TotalConn < m_MaxConn || m_stop;
+        });
+        if (!ready || m_stop) {
+            lock.unlock();
+            ++m_timeouts;
+            long long waited_us = RecordWait(std::chrono::steady_clock::now() - start);
+            WS_PROBE3(db__acquire, waited_us, 0, 0);
+            LOG_WARN("MySQL pool: acquire timed out after %d ms (in use=%d, max=%d)",
+                     timeout_ms, m_CurConn, m_MaxConn);
+            return nullptr;
         }
-        con = mysql_real_connect(con, url.c_str(), user.c_str(), password.c_str(), dbName.c_str(), port, NULL, 0);
-        
-        if (!con){
-            LOG_ERROR("MySQL Connect Error");
-            throw std::runtime_error("MySQL Connect Error: " + std::string(mysql_error(con)));
+
+        if (!connList.empty()) {
+            idle = connList.back();
+            connList.pop_back();
+            --m_FreeConn;
+        } else {
+            ++m_TotalConn;  // 先占位，建连在锁外进行
+            need_create = true;
         }
+        ++m_CurConn;
+    }
 
-        // 用 lock_guard 简单保护 connList
+    MYSQL *con = idle.conn;
+    if (need_create) {
+        con = CreateConnection();
+    }
+    // 较久未确认可用的连接先ping一下，失效则重连
+    else if (std::chrono::steady_clock::now() - idle.last_ping > std::chrono::milliseconds(m_PingIntervalMs) &&
+             mysql_ping(con) != 0) {
+        LOG_WARN("MySQL pool: idle connection lost (%s), reconnecting", mysql_error(con));
+        CloseConnection(con);
+        con = CreateConnection();
+        if (con) ++m_reconnects;
+    }
+
+    if (!con) {
+        // 建连失败，释放占位，快速失败而不是阻塞调用方
         {
             std::lock_guard<std::mutex> lock(mtx);
-            connList.push_back(con);
-            ++m_FreeConn;
+            --m_TotalConn;
+            --m_CurConn;
         }
+        cv.notify_one();
+        long long waited_us = RecordWait(std::chrono::steady_clock::now() - start);
+        WS_PROBE3(db__acquire, waited_us, 0, 0);
+        return nullptr;
     }
 
-    m_MaxConn = m_FreeConn;
+    ++m_acquires;
+    long long waited_us = RecordWait(std::chrono::steady_clock::now() - start);
+    WS_PROBE3(db__acquire, waited_us, 1, 0);
+    return con;
 }
 
-// 当有请求时，从数据库连接池中返回一个可用连接，更新使用和空闲连接数
-MYSQL *connection_pool::GetConnection(){
-    std::unique_lock<std::mutex> lock(mtx);  // 条件变量等待需要 unique_lock
-    cv.wait(lock, [this] { return !connList.empty(); });
-
-    MYSQL* con = connList.front();
-    connList.pop_front();
-    
-    --m_FreeConn;
-    ++m_CurConn;
+// 从最近归还的一端找起，跳过较久未确认可用的连接，ping 和建连都留给维护线程
+MYSQL *connection_pool::TryGetConnection() {
+    auto start = std::chrono::steady_clock::now();
+    MYSQL *con = nullptr;
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (m_stop)
+            return nullptr;
+        for (auto it = connList.rbegin(); it != connList.rend(); ++it) {
+            if (start - it->last_ping <= std::chrono::milliseconds(m_PingIntervalMs)) {
+                con = it->conn;
+                connList.erase(std::next(it).base());
+                --m_FreeConn;
+                ++m_CurConn;
+                break;
+            }
+        }
+        // 有待检测的空闲连接或还能扩容时才唤醒，连接全部在用时等查询归还即可
+        if (!con && (!connList.empty() || m_TotalConn < m_MaxConn)) {
+            m_maintain_wanted = true;
+            wake = true;
+        }
+    }
+    if (wake)
+        m_maintain_cv.notify_one();
 
+    if (!con) {
+        WS_PROBE3(db__acquire, 0LL, 0, 0);
+        return nullptr;
+    }
+    ++m_acquires;
+    long long waited_us = RecordWait(std::chrono::steady_clock::now() - start);
+    WS_PROBE3(db__acquire, waited_us, 1, 0);
     return con;
 }
 
 // 释放当前使用的连接
-bool connection_pool::ReleaseConnection(MYSQL *con){
+bool connection_pool::ReleaseConnection(MYSQL *con, bool broken){
     if (!con) return false;
+    WS_PROBE2(db__release, (int)broken, 0);
+
+    if (broken) {
+        CloseConnection(con);
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            --m_TotalConn;
+            --m_CurConn;
+        }
+        cv.notify_one();  // 腾出了名额，等待者可以新建连接
+        LOG_WARN("MySQL pool: dropped broken connection");
+        return true;
+    }
 
     {
+        auto now = std::chrono::steady_clock::now();
         std::lock_guard<std::mutex> lock(mtx);   // 临界区短，轻量用 lock_guard
-        connList.push_back(con);
+        connList.push_back({con, now, now});
         --m_CurConn;
         ++m_FreeConn;
     }
@@ -79,20 +258,183 @@ bool connection_pool::ReleaseConnection(MYSQL *con){
     return true;
 }
 
+void connection_pool::SetIdlePolicy(int ping_interval_ms, int idle_timeout_ms) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (ping_interval_ms > 0) m_PingIntervalMs = ping_interval_ms;
+    if (idle_timeout_ms > 0) m_IdleTimeoutMs = idle_timeout_ms;
+}
+
+// 维护线程回收空闲连接依赖队首是最久未归还的连接，ping 过的连接按原归还时间插回
+void connection_pool::InsertIdle(const IdleConn &idle) {
+    auto pos = std::upper_bound(connList.begin(), connList.end(), idle.last_used,
+                                [](std::chrono::steady_clock::time_point t, const IdleConn &c) {
+                                    return t < c.last_used;
+                                });
+    connList.insert(pos, idle);
+    ++m_FreeConn;
+}
+
+void connection_pool::ReleaseUnchecked(MYSQL *con, std::chrono::steady_clock::time_point last_used) {
+    if (!con) return;
+    WS_PROBE2(db__release, 0, 0);
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        InsertIdle({con, last_used, last_used});
+        --m_CurConn;
+        m_maintain_wanted = true;
+    }
+    m_maintain_cv.notify_one();
+}
+
+// 后台维护线程：周期性地检查空闲连接，非阻塞获取失败时提前运行
+void connection_pool::MaintainLoop() {
+    unsigned long long last_timeouts = 0, last_reconnects = 0;
+
+    while (true) {
+        std::vector<IdleConn> to_check;
+        std::vector<MYSQL*> to_close;
+        int to_create = 0;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            m_maintain_cv.wait_for(lock, std::chrono::milliseconds(m_PingIntervalMs),
+                                   [this] { return m_stop || m_maintain_wanted; });
+            if (m_stop)
+                break;
+            bool wanted = m_maintain_wanted;
+            m_maintain_wanted = false;
+
+            auto now = std::chrono::steady_clock::now();
+            // 队首是最久未使用的连接：超过最小连接数且空闲过久的直接关闭
+            while (!connList.empty() && m_TotalConn > m_MinConn &&
+                   now - connList.front().last_used > std::chrono::milliseconds(m_IdleTimeoutMs)) {
+                to_close.push_back(connList.front().conn);
+                connList.pop_front();
+                --m_FreeConn;
+                --m_TotalConn;
+            }
+            // 其余超过检测间隔未确认可用的连接取出来ping（取出期间不可被借用）
+            for (auto it = connList.begin(); it != connList.end(); ) {
+                if (now - it->last_ping > std::chrono::milliseconds(m_PingIntervalMs)) {
+                    to_check.push_back(*it);
+                    it = connList.erase(it);
+                    --m_FreeConn;
+                } else {
+                    ++it;
+                }
+            }
+            int target = m_MinConn;
+            // SubReactor 借不到连接且没有可检测的空闲连接：在上限内多建一个
+            if (wanted && connList.empty() && to_check.empty() && m_TotalConn < m_MaxConn)
+                target = std::max(target, m_TotalConn + 1);
+            if (m_TotalConn < target) {
+                to_create = target - m_TotalConn;
+                m_TotalConn += to_create;
+            }
+        }
+
+        for (MYSQL *con : to_close)
+            CloseConnection(con);
+
+        // ping 只刷新 last_ping，重连的连接也沿用原归还时间，空闲过久的照样会被回收
+        std::vector<IdleConn> healthy;
+        int lost = 0;
+        for (IdleConn &idle : to_check) {
+            if (mysql_ping(idle.conn) == 0) {
+                idle.last_ping = std::chrono::steady_clock::now();
+                healthy.push_back(idle);
+                continue;
+            }
+            LOG_WARN("MySQL pool: idle connection lost (%s), reconnecting", mysql_error(idle.conn));
+            CloseConnection(idle.conn);
+            idle.conn = CreateConnection();
+            if (idle.conn) {
+                ++m_reconnects;
+                idle.last_ping = std::chrono::steady_clock::now();
+                healthy.push_back(idle);
+            } else {
+                lost++;
+            }
+        }
+
+        int create_failed = 0;
+        for (int i = 0; i < to_create; i++) {
+            MYSQL *con = CreateConnection();
+            if (!con) {
+                create_failed = to_create - i;
+                break;
+            }
+            auto now = std::chrono::steady_clock::now();
+            healthy.push_back({con, now, now});
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            for (const IdleConn &idle : healthy)
+                InsertIdle(idle);
+            m_TotalConn -= lost + create_failed;
+        }
+        if (!to_close.empty())
+            LOG_INFO("MySQL pool: closed %d idle connections, total=%d (min=%d)",
+                     (int)to_close.size(), GetStats().total, m_MinConn);
+        if (!healthy.empty() || lost + create_failed > 0)
+            cv.notify_all();
+
+        unsigned long long timeouts = m_timeouts.load(), reconnects = m_reconnects.load();
+        if (timeouts != last_timeouts || reconnects != last_reconnects) {
+            Stats s = GetStats();
+            LOG_INFO("MySQL pool stats - total: %d, in use: %d, idle: %d, timeouts: %llu, "
+                     "reconnects: %llu, connect failures: %llu",
+                     s.total, s.in_use, s.idle, s.timeouts, s.reconnects, s.connect_failures);
+            last_timeouts = timeouts;
+            last_reconnects = reconnects;
+        }
+    }
+}
+
 // 当前空闲连接数量
 int connection_pool::GetFreeConn() {
     std::lock_guard<std::mutex> lock(mtx);
     return m_FreeConn;
 }
 
+connection_pool::Stats connection_pool::GetStats() {
+    Stats s;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        s.total = m_TotalConn;
+        s.in_use = m_CurConn;
+        s.idle = m_FreeConn;
+        s.min_conn = m_MinConn;
+        s.max_conn = m_MaxConn;
+    }
+    s.acquires = m_acquires.load();
+    s.timeouts = m_timeouts.load();
+    s.connect_failures = m_connect_failures.load();
+    s.reconnects = m_reconnects.load();
+    s.created = m_created.load();
+    s.destroyed = m_destroyed.load();
+    for (int i = 0; i < WAIT_BUCKETS; i++)
+        s.wait_hist[i] = m_wait_hist[i].load();
+    return s;
+}
+
 // 销毁数据库连接池
 void connection_pool::DestoryPool(){
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        m_stop = true;
+    }
+    m_maintain_cv.notify_all();
+    cv.notify_all();
+    if (m_maintain_thread.joinable())
+        m_maintain_thread.join();
+
     std::lock_guard<std::mutex> lock(mtx);
-    for (auto con : connList){
-        if (con) mysql_close(con);
+    for (auto &idle : connList){
+        if (idle.conn) mysql_close(idle.conn);
     }
+    m_TotalConn -= connList.size();
     connList.clear();
-    m_CurConn = 0;
     m_FreeConn = 0;
 }
 
@@ -100,4 +442,3 @@ void connection_pool::DestoryPool(){
 connection_pool::~connection_pool(){
     DestoryPool();
 }
-
@@ -3,19 +3,58 @@
 
 #include <mysql/mysql.h>
 #include <string>
-#include <list>
+#include <deque>
+#include <vector>
 #include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include "../log/log.h"
 
 
 class connection_pool{
 public:
-    MYSQL *GetConnection();              // 获取数据库连接
-    bool ReleaseConnection(MYSQL *conn); // 释放连接
-    int GetFreeConn();                   // 获取连接
+    // 等待时间直方图：<10us, <100us, <1ms, <10ms, <100ms, <1s, >=1s
+    static const int WAIT_BUCKETS = 7;
+
+    // 连接池统计快照
+    struct Stats {
+        int total;                  // 已打开的连接数（含使用中）
+        int in_use;                 // 使用中的连接数
+        int idle;                   // 空闲连接数
+        int min_conn;
+        int max_conn;
+        unsigned long long acquires;          // 成功获取次数
+        unsigned long long timeouts;          // 获取超时次数
+        unsigned long long connect_failures;  // 建立连接失败次数
+        unsigned long long reconnects;        // 断线重连次数
+        unsigned long long created;           // 累计创建连接数
+        unsigned long long destroyed;         // 累计关闭连接数
+        unsigned long long wait_hist[WAIT_BUCKETS];
+    };
+
+    // 获取数据库连接，timeout_ms < 0 使用默认超时；超时或建连失败返回nullptr
+    MYSQL *GetConnection(int timeout_ms = -1);
+    // 非阻塞获取，供SubReactor事件循环使用：只借出检测间隔内确认过可用的空闲连接，
+    // 不等待、不ping、不建连；拿不到时请维护线程检测/扩容，返回nullptr
+    MYSQL *TryGetConnection();
+    // 释放连接，broken为true时直接关闭该连接
+    bool ReleaseConnection(MYSQL *conn, bool broken = false);
+    // 归还一条较久未确认可用的空闲连接，保留原归还时间，由维护线程ping
+    void ReleaseUnchecked(MYSQL *conn, std::chrono::steady_clock::time_point last_used);
+    int GetFreeConn();                   // 获取空闲连接数
+    int GetPingIntervalMs() const { return m_PingIntervalMs; }
+    int GetAcquireTimeoutMs() const { return m_AcquireTimeoutMs; }
+    // 调整空闲检测间隔和空闲回收时间（毫秒，<= 0 保持默认），需在 init 之前调用
+    void SetIdlePolicy(int ping_interval_ms, int idle_timeout_ms);
+    Stats GetStats();                    // 获取统计信息
     void DestoryPool();                  // 销毁所有连接
 
+    // 判断错误是否意味着连接已失效（server gone away / lost connection）
+    static bool IsConnectionError(MYSQL *conn);
+    static const char *WaitBucketName(int idx);
+
     // 单例模式
     static connection_pool *GetInstance();
     void init(const std::string& url,
@@ -23,44 +62,85 @@ public:
         const std::string& password,
         const std::string& dbName,
         int port,
+        int minConn,
         int maxConn,
+        int acquire_timeout_ms,
         int close_log);
 
 private:
     connection_pool();
     ~connection_pool();
 
+    struct IdleConn {
+        MYSQL *conn;
+        std::chrono::steady_clock::time_point last_used;  // 归还时间，决定空闲回收，ping 不刷新
+        std::chrono::steady_clock::time_point last_ping;  // 最近一次确认可用（归还或ping成功）的时间
+    };
+
+    MYSQL *CreateConnection();           // 建立新连接（不持锁调用）
+    void CloseConnection(MYSQL *conn);   // 关闭连接（不持锁调用）
+    long long RecordWait(std::chrono::steady_clock::duration waited);   // 返回等待的微秒数
+    void InsertIdle(const IdleConn &idle);   // 按归还时间插回空闲队列（持锁调用）
+    void MaintainLoop();                 // 后台维护：ping空闲连接、重连、收缩、补足最小连接
+
+    int m_MinConn;                      // 最小连接数
     int m_MaxConn;                      // 最大连接数
+    int m_TotalConn;                    // 已打开连接数（含正在创建的）
     int m_CurConn;                      // 当前使用的连接数
     int m_FreeConn;                     // 当前空闲连接数
-    
-    std::list<MYSQL*> connList;         // 连接池容器
+    int m_AcquireTimeoutMs;             // 默认获取超时（毫秒）
+    int m_PingIntervalMs;               // 空闲连接检测间隔（毫秒）
+    int m_IdleTimeoutMs;                // 空闲超过该时间且超过最小连接数则关闭
+
+    std::deque<IdleConn> connList;      // 空闲连接，按归还时间排序，尾部为最近归还的连接
 
     // ---------- 修改锁和条件变量 ----------
     std::mutex mtx;                      // 保护 connList 和计数
     std::condition_variable cv;          // 等待空闲连接
-    
+
+    // 后台维护线程
+    std::thread m_maintain_thread;
+    std::condition_variable m_maintain_cv;
+    bool m_stop;
+    bool m_maintain_wanted;             // 非阻塞获取失败，请维护线程提前运行
+
+    // 统计
+    std::atomic<unsigned long long> m_acquires{0};
+    std::atomic<unsigned long long> m_timeouts{0};
+    std::atomic<unsigned long long> m_connect_failures{0};
+    std::atomic<unsigned long long> m_reconnects{0};
+    std::atomic<unsigned long long> m_created{0};
+    std::atomic<unsigned long long> m_destroyed{0};
+    std::atomic<unsigned long long> m_wait_hist[WAIT_BUCKETS];
+
 public:
     std::string m_url;           // 主机开关
-    std::string m_Port;          // 数据库端口号
+    int m_Port;                  // 数据库端口号
     std::string m_User;          // 登陆数据库用户名
     std::string m_PassWord;      // 登陆数据库密码
     std::string m_DataBaseName;  //使用数据库名
     int m_close_log;        //日志开关
 };
 
-// RAII 连接管理类
-class ConnectionGuard {
+// RAII 连接管理类，Pool 可以是全局连接池或SubReactor私有切片
+template <typename Pool>
+class BasicConnectionGuard {
     public:
-        explicit ConnectionGuard(connection_pool& pool)
-            : pool_(pool), conn_(pool_.GetConnection()) {}
-        ~ConnectionGuard() { pool_.ReleaseConnection(conn_); }
-    
+        explicit BasicConnectionGuard(Pool& pool, int timeout_ms = -1)
+            : pool_(pool), conn_(pool_.GetConnection(timeout_ms)), broken_(false) {}
+        ~BasicConnectionGuard() { if (conn_) pool_.ReleaseConnection(conn_, broken_); }
+
         MYSQL* get() const { return conn_; }
         MYSQL* operator->() const { return conn_; }
-    
+
+        // 查询失败且连接已失效时调用，归还时直接关闭
+        void mark_broken() { broken_ = true; }
+
     private:
-        connection_pool& pool_;
+        Pool& pool_;
         MYSQL* conn_;
+        bool broken_;
     };
+
+using ConnectionGuard = BasicConnectionGuard<connection_pool>;
 #endif
@@ -2,31 +2,66 @@
 
 // 常量定义（从webserver.h移动过来）
 const int MAX_FD = 65536;           // 最大文件描述符
-const int TIMESLOT = 1;             // 最小超时单位
+const int TIMER_TICK_MS = 1;        // 时间轮 tick（毫秒）
+const int HOUSEKEEPING_MS = 1000;   // 有异步查询在执行时，至少每隔这么久唤醒一次检查超时
+const int SQL_RETRY_MS = 10;        // 异步查询拿不到连接时的重试间隔
+const int TIMER_STATS_MS = 60000;   // 定时器统计输出间隔（随定时器唤醒顺带输出，不单独唤醒）
+const size_t ACCESS_LOG_RECORDS = 1 << 18;   // 每个 SubReactor 访问日志环的记录数（128B 一条，共 32MB）
+const size_t TRACE_RECORDS = 1 << 16;        // 每个 SubReactor 追踪环的阶段记录数（40B 一条，共 2.5MB）
+const size_t FLIGHT_RECORDS = 1 << 16;       // 每个 SubReactor 飞行记录器的事件数（16B 一条，共 1MB）
+
+// 根据 process() 的结果确定连接阶段
+static CONN_PHASE phase_after_process(http_conn::PROCESS_RESULT result, http_conn *conn) {
+    if (result == http_conn::PROCESS_CONTINUE) {
+        return conn->headers_complete() ? CONN_BODY : CONN_HEADER;
+    }
+    return CONN_WRITE;
+}
 
 SubReactor::SubReactor(int sub_reactor_id, const char* root, int conn_trig_mode, int close_log,
                        const std::string& user, const std::string& passWord, const std::string& databaseName,
-                       connection_pool* connPool)
+                       connection_pool* connPool, int sql_slice, bool sql_async, UserStore* user_store,
+                       const conn_deadlines& deadlines, int access_sample, int trace_sample)
     : m_sub_reactor_id(sub_reactor_id), m_conn_trig_mode(conn_trig_mode), m_close_log(close_log),
-      m_connPool(connPool), m_user(user), m_passWord(passWord), m_databaseName(databaseName) {
+      m_connPool(connPool), m_local_pool(connPool), m_sql_slice(sql_slice), m_sql_async(sql_async), m_user_store(user_store),
+      m_user(user), m_passWord(passWord), m_databaseName(databaseName), m_deadlines(deadlines),
+      m_access_sample(access_sample) {
 
     // 复制资源目录路径
     m_root = new char[strlen(root) + 1];
     strcpy(m_root, root);
 
     // 初始化定时器（时间轮）
-    m_timer_wheel.set_timeslot(TIMESLOT);
+    m_timer_wheel.set_timeslot(TIMER_TICK_MS, m_clock.mono_ms());
+
+    m_metrics.reactor = m_sub_reactor_id;
+    metrics_registry::instance()->add_reactor(m_sub_reactor_id, &m_metrics, &m_user_count,
+                                              m_sql_slice > 0 ? &m_local_pool : nullptr);
+
+    m_tracer.init(m_sub_reactor_id, trace_sample, TRACE_RECORDS);
+    if (m_tracer.enabled()) {
+        trace_registry::instance()->add_tracer(&m_tracer);
+    }
+
+    m_flight.init(m_sub_reactor_id, FLIGHT_RECORDS);
+    flight_registry::instance()->add_recorder(&m_flight);
 
     LOG_INFO("SubReactor %d created", m_sub_reactor_id);
 }
 
 SubReactor::~SubReactor() {
     stop();
+    metrics_registry::instance()->remove_reactor(m_sub_reactor_id);
+    if (m_tracer.enabled()) {
+        trace_registry::instance()->remove_tracer(&m_tracer);
+    }
+    flight_registry::instance()->remove_recorder(&m_flight);
     delete[] m_root;
 
     // 清理文件描述符
     if (m_epollfd != -1) close(m_epollfd);
     if (m_timerfd != -1) close(m_timerfd);
+    if (m_wakeup_fd != -1) close(m_wakeup_fd);
 
     LOG_INFO("SubReactor %d destroyed", m_sub_reactor_id);
 }
@@ -38,6 +73,27 @@ void SubReactor::start() {
     }
 
     initEpoll();
+
+    // 预留私有连接切片
+    if (m_sql_slice > 0) {
+        m_local_pool.init(m_sql_slice);
+        LOG_INFO("SubReactor %d: reserved %d/%d private MySQL connections",
+                 m_sub_reactor_id, m_local_pool.GetFreeConn(), m_sql_slice);
+    }
+
+    // 非阻塞查询最多占用与私有切片相同数量的连接
+    if (m_sql_async) {
+        m_async_sql.reset(new async_sql_executor(&m_local_pool, m_epollfd,
+                                                 m_sql_slice > 0 ? m_sql_slice : 1));
+    }
+
+    // 访问日志：每个 SubReactor 一个文件，只有本线程写
+    if (m_access_sample > 0) {
+        char path[64];
+        snprintf(path, sizeof(path), "./logs/access.%d.ring", m_sub_reactor_id);
+        m_access_log.open(path, m_sub_reactor_id, ACCESS_LOG_RECORDS, m_access_sample);
+    }
+
     m_running.store(true);
     m_thread = std::thread(&SubReactor::eventLoop, this);
 
@@ -51,16 +107,20 @@ void SubReactor::stop() {
 
     m_running.store(false);
 
-    // 通知线程退出
-    {
-        std::lock_guard<std::mutex> lock(m_connection_mutex);
-        m_connection_cv.notify_all();
+    // 通知线程退出：epoll_wait 不再带超时，需要显式唤醒
+    uint64_t one = 1;
+    if (write(m_wakeup_fd, &one, sizeof(one)) < 0) {
+        LOG_ERROR("SubReactor %d: wakeup failed, errno=%d", m_sub_reactor_id, errno);
     }
 
     if (m_thread.joinable()) {
         m_thread.join();
     }
 
+    // 线程已退出，执行中的查询和私有切片归还全局池
+    m_async_sql.reset();
+    m_local_pool.DestoryPool();
+
     LOG_INFO("SubReactor %d stopped", m_sub_reactor_id);
 }
 
@@ -73,59 +133,102 @@ void SubReactor::initEpoll() {
     m_timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
     assert(m_timerfd > 0);
 
-    // 设置周期定时器
-    itimerspec new_value{};
-    new_value.it_value.tv_sec = TIMESLOT;
-    new_value.it_interval.tv_sec = TIMESLOT;
-    timerfd_settime(m_timerfd, 0, &new_value, nullptr);
+    // 不再周期触发：一次性定时器，按时间轮中最近的期限设置（见 rearm_timer）
+    m_armed_ms = 0;
+    m_wakeup_ms = 0;
 
     // 将 timerfd 添加到 epoll
     Utils::addfd(m_epollfd, m_timerfd, false, 0);
+
+    // 新连接通知：主 Reactor 入队后写 eventfd，不必再靠 epoll_wait 超时轮询队列
+    m_wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    assert(m_wakeup_fd >= 0);
+    Utils::addfd(m_epollfd, m_wakeup_fd, false, 0, false);
 }
 
 bool SubReactor::add_connection(int connfd, struct sockaddr_in client_address) {
-    // 检查连接数限制
-    if (m_user_count.load() >= MAX_FD) {
+    accepted_connection conn = {connfd, client_address};
+    return add_connections(&conn, 1) == 1;
+}
+
+int SubReactor::add_connections(const accepted_connection* conns, int count) {
+    // 检查连接数限制（队列中尚未注册的连接不计入，上限只是近似）
+    int room = MAX_FD - m_user_count.load();
+    int accepted = count < room ? count : (room > 0 ? room : 0);
+    for (int i = accepted; i < count; i++) {
         LOG_WARN("SubReactor %d: Too many connections", m_sub_reactor_id);
-        Utils::show_error(connfd, "Internal server busy");
-        return false;
+        Utils::show_error(conns[i].fd, "Internal server busy");
+    }
+    if (accepted == 0) {
+        return 0;
+    }
+
+    uint64_t queued_ticks = m_tracer.enabled() ? trace_ticks() : 0;
+    bool was_empty;
+    {
+        std::lock_guard<std::mutex> lock(m_connection_mutex);
+        was_empty = m_pending_connections.empty();
+        for (int i = 0; i < accepted; i++) {
+            m_pending_connections.push_back({conns[i].fd, conns[i].address, queued_ticks});
+        }
+    }
+    // 队列原本非空说明已经通知过、本线程还没取走，不必再写
+    if (was_empty) {
+        uint64_t one = 1;
+        if (write(m_wakeup_fd, &one, sizeof(one)) < 0) {
+            LOG_ERROR("SubReactor %d: wakeup failed, errno=%d", m_sub_reactor_id, errno);
+        }
     }
+    for (int i = 0; i < accepted; i++) {
+        WS_PROBE3(dispatch, conns[i].fd, m_sub_reactor_id, m_user_count.load(std::memory_order_relaxed));
+    }
+
+    LOG_DEBUG("SubReactor %d: %d new connections queued", m_sub_reactor_id, accepted);
+    return accepted;
+}
 
+void SubReactor::take_pending_connections() {
+    // 先清 eventfd 再换出队列：之后入队的连接会看到空队列并重新通知
+    uint64_t count;
+    if (read(m_wakeup_fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+        LOG_ERROR("SubReactor %d: wakeup read failed, errno=%d", m_sub_reactor_id, errno);
+    }
     {
         std::lock_guard<std::mutex> lock(m_connection_mutex);
-        m_pending_connections.push({connfd, client_address});
-        m_connection_cv.notify_one();
+        m_taken_connections.swap(m_pending_connections);
     }
 
-    LOG_DEBUG("SubReactor %d: New connection %d queued", m_sub_reactor_id, connfd);
-    return true;
+    for (const pending_connection& conn_info : m_taken_connections) {
+        // 创建连接和定时器，http_conn::init 会把 fd 注册到本线程的 epoll
+        create_timer(conn_info.fd, conn_info.address);
+        if (conn_info.queued_ticks) {
+            m_users[conn_info.fd]->set_queue_ticks(conn_info.queued_ticks, trace_ticks());
+        }
+        LOG_DEBUG("SubReactor %d: Added connection %d to epoll", m_sub_reactor_id, conn_info.fd);
+    }
+    m_taken_connections.clear();
 }
 
 void SubReactor::eventLoop() {
     LOG_INFO("SubReactor %d: Event loop started", m_sub_reactor_id);
 
+    // 本线程上的同步注册优先使用私有连接切片
+    local_connection_pool::set_current(&m_local_pool);
+#ifdef USE_COROUTINE
+    FramePool::set_current(&m_frame_pool);
+#endif
+    LoopClock::set_current(&m_clock);
+    access_log::set_current(m_access_log.is_open() ? &m_access_log : nullptr);
+    reactor_metrics::set_current(&m_metrics);
+    request_tracer::set_current(m_tracer.enabled() ? &m_tracer : nullptr);
+
     bool timeout = false;
 
     while (m_running.load()) {
-        // 检查是否有新连接需要添加
-        {
-            std::unique_lock<std::mutex> lock(m_connection_mutex);
-            if (!m_pending_connections.empty()) {
-                auto conn_info = m_pending_connections.front();
-                m_pending_connections.pop();
-                lock.unlock();
-
-                // 创建连接和定时器
-                create_timer(conn_info.first, conn_info.second);
-
-                // 将新连接添加到epoll
-                Utils::addfd(m_epollfd, conn_info.first, false, m_conn_trig_mode);
-                LOG_DEBUG("SubReactor %d: Added connection %d to epoll", m_sub_reactor_id, conn_info.first);
-            }
-        }
-
-        // 等待事件，带超时以便定期检查pending连接
-        int number = epoll_wait(m_epollfd, events, SUB_MAX_EVENT_NUMBER, 100);
+        // 等待事件；新连接和停止由 eventfd 唤醒，定时任务由 timerfd 唤醒
+        int number = epoll_wait(m_epollfd, events, SUB_MAX_EVENT_NUMBER, -1);
+        // 每轮只取一次时间，本轮事件处理都用这个值
+        m_clock.refresh();
 
         if (number < 0 && errno != EINTR) {
             LOG_ERROR("SubReactor %d: epoll failure", m_sub_reactor_id);
@@ -141,24 +244,42 @@ void SubReactor::eventLoop() {
                 read(m_timerfd, &exp, sizeof(exp));
                 timeout = true;
             }
-            // 处理连接异常或关闭
-            else if (events[i].events & (EPOLLHUP | EPOLLERR)) {
-                dealwithexception(sockfd);
+            // 主 Reactor 分来的新连接
+            else if (sockfd == m_wakeup_fd) {
+                take_pending_connections();
             }
-            // 处理客户数据读取
-            else if (events[i].events & EPOLLIN) {
-                dealwithread(sockfd);
+            // 非阻塞数据库查询的socket事件
+            else if (m_async_sql && m_async_sql->owns_fd(sockfd)) {
+                m_async_sql->on_event(sockfd, events[i].events);
             }
-            // 处理客户数据发送
-            else if (events[i].events & EPOLLOUT) {
-                dealwithwrite(sockfd);
+            else {
+                flight(FR_EPOLL, sockfd, events[i].events);
+
+                // 处理连接异常或关闭
+                if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                    dealwithexception(sockfd);
+                }
+                // 处理客户数据读取
+                else if (events[i].events & EPOLLIN) {
+                    dealwithread(sockfd);
+                }
+                // 处理客户数据发送
+                else if (events[i].events & EPOLLOUT) {
+                    dealwithwrite(sockfd);
+                }
             }
         }
 
+        if (m_async_sql) {
+            dealwithsql();
+        }
+
         if (timeout) {
             timer_handler();
             timeout = false;
         }
+
+        rearm_timer();
     }
 
     LOG_INFO("SubReactor %d: Event loop ended", m_sub_reactor_id);
@@ -168,48 +289,99 @@ void SubReactor::create_timer(int connfd, struct sockaddr_in client_address) {
     // 创建http连接对象
     auto http_conn_ptr = std::make_unique<http_conn>();
     http_conn_ptr->init(connfd, client_address, m_root, m_conn_trig_mode, m_close_log,
-                       m_user, m_passWord, m_databaseName, m_epollfd);
+                       m_user, m_passWord, m_databaseName, m_epollfd, m_user_store, m_async_sql.get());
 
     // 增加连接计数
     m_user_count++;
+    m_metrics.accepts.add();
+    flight(FR_ACCEPT, connfd, ntohs(client_address.sin_port));
 
     // 创建client_data对象
     auto client_data_ptr = std::make_unique<client_data>();
     client_data_ptr->address = client_address;
     client_data_ptr->sockfd = connfd;
 
-    // 创建定时器
-    util_timer *timer = new util_timer;
+    // 初始化嵌在连接对象里的定时器
+    util_timer *timer = &client_data_ptr->timer;
     timer->user_data = client_data_ptr.get();
+    timer->cb_func = on_timer_expire;
+    timer->cb_arg = this;
 
-    // 使用lambda创建回调函数
-    timer->cb_func = [this, connfd]() {
-        this->close_connection_by_timer(connfd);
-    };
-
-    time_t cur = time(NULL);
-    int random_timeout = m_timer_wheel.get_random_timeout();
-    timer->expire = cur + random_timeout;
-    timer->last_active = cur;
-
-    client_data_ptr->timer = timer;
-    m_timer_wheel.add_timer(timer);
+    // 建立连接即开始计算请求头期限，只连不发的连接按请求头超时回收
+    client_data_ptr->phase = CONN_HEADER;
+    timer->deadline = m_clock.mono_ms() + m_deadlines.header_ms;
+    m_timer_wheel.add_timer(timer, m_clock.mono_ms());
+    schedule_wakeup(timer->deadline);
 
     // 将对象添加到map中
+#ifdef USE_COROUTINE
+    http_conn *conn = http_conn_ptr.get();
+#endif
     m_users[connfd] = std::move(http_conn_ptr);
     m_clients[connfd] = std::move(client_data_ptr);
+
+#ifdef USE_COROUTINE
+    start_coroutine(connfd, conn, timer);
+#endif
+}
+
+// 按连接阶段更新期限，时间取本轮事件循环缓存的时钟
+// 期限推后只是一次写入（时间轮惰性续期）；提前时才重新挂链并可能提前 timerfd
+void SubReactor::adjust_timer(util_timer* timer, CONN_PHASE phase) {
+    client_data *client = timer->user_data;
+
+    // 请求头/请求体期限从进入该阶段起算，同一阶段内零星到达的数据不续期
+    if ((phase == CONN_HEADER || phase == CONN_BODY) && client->phase == phase) {
+        return;
+    }
+    client->phase = phase;
+
+    int timeout_ms = m_deadlines.idle_ms;
+    switch (phase) {
+        case CONN_HEADER: timeout_ms = m_deadlines.header_ms; break;
+        case CONN_BODY:   timeout_ms = m_deadlines.body_ms; break;
+        case CONN_WRITE:  timeout_ms = m_deadlines.write_ms; break;
+        case CONN_IDLE:   timeout_ms = m_deadlines.idle_ms; break;
+    }
+
+    long long deadline = m_clock.mono_ms() + timeout_ms;
+    if (m_timer_wheel.set_deadline(timer, deadline)) {
+        schedule_wakeup(deadline);
+    }
+}
+
+void SubReactor::schedule_wakeup(long long when) {
+    if (m_wakeup_ms == 0 || when < m_wakeup_ms) {
+        m_wakeup_ms = when;
+    }
 }
 
-void SubReactor::adjust_timer(util_timer* timer) {
-    time_t cur = time(NULL);
-    m_timer_wheel.adjust_timer(timer, cur);
+// 每轮事件处理结束调用一次：只有比已设置的唤醒时间更早才调用 timerfd_settime，
+// 更晚的不用管，timerfd 到期后会按时间轮中最近的期限重新设置
+void SubReactor::rearm_timer() {
+    if (m_async_sql && m_async_sql->busy()) {
+        schedule_wakeup(m_clock.mono_ms() + (m_async_sql->starved() ? SQL_RETRY_MS : HOUSEKEEPING_MS));
+    }
+    if (m_wakeup_ms == 0) {
+        return;
+    }
+
+    if (m_armed_ms == 0 || m_wakeup_ms < m_armed_ms) {
+        itimerspec new_value{};
+        new_value.it_value.tv_sec = m_wakeup_ms / 1000;
+        new_value.it_value.tv_nsec = (m_wakeup_ms % 1000) * 1000000;
+        timerfd_settime(m_timerfd, TFD_TIMER_ABSTIME, &new_value, nullptr);
+        m_armed_ms = m_wakeup_ms;
+    }
+    m_wakeup_ms = 0;
 }
 
-void SubReactor::close_connection(util_timer *timer, int sockfd) {
+void SubReactor::close_connection(util_timer *timer, int sockfd, FLIGHT_CLOSE_REASON reason) {
     if (!timer) {
         LOG_WARN("SubReactor %d: Trying to delete null timer: fd=%d", m_sub_reactor_id, sockfd);
         return;
     }
+    flight(FR_CLOSE, sockfd, reason);
 
     // 从epoll中删除文件描述符
     epoll_ctl(m_epollfd, EPOLL_CTL_DEL, sockfd, 0);
@@ -217,6 +389,15 @@ void SubReactor::close_connection(util_timer *timer, int sockfd) {
     // 关闭套接字
     close(sockfd);
 
+    // 挂起中的异步查询与连接解绑
+    if (m_async_sql) {
+        m_async_sql->cancel(sockfd);
+    }
+
+#ifdef USE_COROUTINE
+    release_coroutine(sockfd);
+#endif
+
     // 从时间轮中删除定时器
     m_timer_wheel.del_timer(timer);
 
@@ -237,12 +418,36 @@ void SubReactor::close_connection(util_timer *timer, int sockfd) {
     LOG_DEBUG("SubReactor %d: Closed fd %d", m_sub_reactor_id, sockfd);
 }
 
+// 时间轮到期回调：定时器已从时间轮摘除，关闭连接会释放定时器所在的 client_data
+void SubReactor::on_timer_expire(util_timer *timer, void *arg) {
+    SubReactor *reactor = static_cast<SubReactor *>(arg);
+    reactor->m_metrics.timer_expired.add();
+    reactor->flight(FR_TIMER, timer->user_data->sockfd, timer->user_data->phase);
+    WS_PROBE3(timer__expire, reactor->m_sub_reactor_id, timer->user_data->sockfd, (int)timer->user_data->phase);
+    reactor->close_connection_by_timer(timer->user_data->sockfd);
+}
+
 void SubReactor::close_connection_by_timer(int sockfd) {
+#ifdef USE_COROUTINE
+    // 协程模式：由超时唤醒协程，协程结束后再回到这里关闭
+    co_conn *ctx = find_coroutine(sockfd);
+    if (ctx && !ctx->task.done()) {
+        resume_connection(sockfd, true);
+        return;
+    }
+    release_coroutine(sockfd);
+#endif
+    flight(FR_CLOSE, sockfd, FR_CLOSE_TIMER);
+
     // 从epoll中删除文件描述符
     epoll_ctl(m_epollfd, EPOLL_CTL_DEL, sockfd, 0);
     // 关闭套接字
     close(sockfd);
 
+    if (m_async_sql) {
+        m_async_sql->cancel(sockfd);
+    }
+
     // 从map中移除，自动删除对象
     auto client_it = m_clients.find(sockfd);
     if (client_it != m_clients.end()) {
@@ -261,28 +466,36 @@ void SubReactor::close_connection_by_timer(int sockfd) {
 }
 
 void SubReactor::dealwithread(int sockfd) {
+#ifdef USE_COROUTINE
+    resume_connection(sockfd, false);
+    return;
+#endif
+
     auto client_it = m_clients.find(sockfd);
     auto user_it = m_users.find(sockfd);
 
     if (client_it == m_clients.end() || user_it == m_users.end()) {
         LOG_WARN("SubReactor %d: Connection %d not found in maps", m_sub_reactor_id, sockfd);
+        flight(FR_MISSING, sockfd, 0);
         return;
     }
 
-    util_timer *timer = client_it->second->timer;
+    util_timer *timer = &client_it->second->timer;
 
     LOG_DEBUG("SubReactor %d: Deal with read from client(%s)",
               m_sub_reactor_id, inet_ntoa(user_it->second->get_address()->sin_addr));
 
     int flag = user_it->second->read_once();
+    flight(FR_READ, sockfd, user_it->second->get_read_idx(), flag + 1);
+    WS_PROBE4(read, m_sub_reactor_id, sockfd, flag, user_it->second->get_read_idx());
     if (flag > 0) {
         // 成功读取到数据
-        ConnectionGuard connGuard(*m_connPool);
-        user_it->second->mysql = connGuard.get();
         http_conn::PROCESS_RESULT result = user_it->second->process();
+        flight(FR_PROCESS, sockfd, result);
+        WS_PROBE3(parse__complete, m_sub_reactor_id, sockfd, (int)result);
 
         if (result == http_conn::PROCESS_ERROR) {
-            close_connection(timer, sockfd);
+            close_connection(timer, sockfd, FR_CLOSE_PROCESS_ERROR);
             return;
         }
         else if (result == http_conn::PROCESS_CONTINUE) {
@@ -291,98 +504,304 @@ void SubReactor::dealwithread(int sockfd) {
         else if (result == http_conn::PROCESS_OK) {
             Utils::modfd(m_epollfd, sockfd, EPOLLOUT, m_conn_trig_mode);
         }
+        // PROCESS_PENDING: EPOLLONESHOT 已摘除该fd，等查询完成后再注册写事件
 
         if (timer) {
-            adjust_timer(timer);
+            adjust_timer(timer, phase_after_process(result, user_it->second.get()));
         }
     }
     else if(flag < 0) {
         // 读取错误，关闭连接
-        close_connection(timer, sockfd);
+        close_connection(timer, sockfd, FR_CLOSE_READ_ERROR);
     }
     else {
         // flag == 0，对端关闭了连接
-        ConnectionGuard connGuard(*m_connPool);
-        user_it->second->mysql = connGuard.get();
         http_conn::PROCESS_RESULT result = user_it->second->process();
+        flight(FR_PROCESS, sockfd, result);
+        WS_PROBE3(parse__complete, m_sub_reactor_id, sockfd, (int)result);
 
         if (result == http_conn::PROCESS_ERROR) {
-            close_connection(timer, sockfd);
+            close_connection(timer, sockfd, FR_CLOSE_PROCESS_ERROR);
             return;
         }
         else if (result == http_conn::PROCESS_CONTINUE) {
             LOG_DEBUG("SubReactor %d: Incomplete request but client closed: fd=%d", m_sub_reactor_id, sockfd);
-            close_connection(timer, sockfd);
+            close_connection(timer, sockfd, FR_CLOSE_PEER_INCOMPLETE);
         }
-        else if (result == http_conn::PROCESS_OK) {
+        else if (result == http_conn::PROCESS_OK || result == http_conn::PROCESS_PENDING) {
             LOG_DEBUG("SubReactor %d: Client closed, sending final response: fd=%d", m_sub_reactor_id, sockfd);
             user_it->second->m_peer_closed = true;
-            Utils::modfd(m_epollfd, sockfd, EPOLLOUT, m_conn_trig_mode);
+            if (result == http_conn::PROCESS_OK) {
+                Utils::modfd(m_epollfd, sockfd, EPOLLOUT, m_conn_trig_mode);
+            }
 
             if (timer) {
-                adjust_timer(timer);
+                adjust_timer(timer, CONN_WRITE);
             }
         }
     }
 }
 
 void SubReactor::dealwithwrite(int sockfd) {
+#ifdef USE_COROUTINE
+    resume_connection(sockfd, false);
+    return;
+#endif
+
     auto client_it = m_clients.find(sockfd);
     auto user_it = m_users.find(sockfd);
 
     if (client_it == m_clients.end() || user_it == m_users.end()) {
         LOG_WARN("SubReactor %d: Connection %d not found in maps", m_sub_reactor_id, sockfd);
+        flight(FR_MISSING, sockfd, 0);
         return;
     }
 
-    util_timer *timer = client_it->second->timer;
+    util_timer *timer = &client_it->second->timer;
 
     LOG_DEBUG("SubReactor %d: Send data to client(%s)",
               m_sub_reactor_id, inet_ntoa(user_it->second->get_address()->sin_addr));
 
     int write_result = user_it->second->write();
+    flight(FR_WRITE, sockfd, write_result);
 
     if (write_result == 1) {
         // 写入完成，检查是否需要关闭连接
         bool should_close = false;
+        FLIGHT_CLOSE_REASON reason = FR_CLOSE_SHORT_CONN;
 
         if (user_it->second->m_peer_closed) {
             LOG_DEBUG("SubReactor %d: Peer closed, final response sent: fd=%d", m_sub_reactor_id, sockfd);
             should_close = true;
+            reason = FR_CLOSE_PEER_DONE;
         }
-        else if (!user_it->second->is_keep_alive()) {
+        // 长连接写完后 http_conn 已 init() 回读状态（is_keep_alive 也被重置），只能看状态
+        else if (!user_it->second->is_reset_for_next()) {
             LOG_DEBUG("SubReactor %d: Short connection, response sent: fd=%d", m_sub_reactor_id, sockfd);
             should_close = true;
         }
 
         if (should_close) {
-            close_connection(timer, sockfd);
+            close_connection(timer, sockfd, reason);
         } else {
             if (timer) {
-                adjust_timer(timer);
+                adjust_timer(timer, CONN_IDLE);
             }
         }
     }
     else if (write_result == 0) {
-        // 需要继续写
+        // 需要继续写：每次可写都算一次进展，写停滞期限从此刻重新计算
         if (timer) {
-            adjust_timer(timer);
+            adjust_timer(timer, CONN_WRITE);
         }
     }
     else {
         // 写入失败，关闭连接
-        close_connection(timer, sockfd);
+        close_connection(timer, sockfd, FR_CLOSE_WRITE_ERROR);
     }
 }
 
 void SubReactor::dealwithexception(int sockfd) {
     auto client_it = m_clients.find(sockfd);
     if (client_it != m_clients.end()) {
-        util_timer *timer = client_it->second->timer;
-        close_connection(timer, sockfd);
+        util_timer *timer = &client_it->second->timer;
+        close_connection(timer, sockfd, FR_CLOSE_EXCEPTION);
+    }
+}
+
+void SubReactor::dealwithsql() {
+    int sockfd;
+    bool ok;
+    while (m_async_sql->pop_completion(&sockfd, &ok)) {
+        auto client_it = m_clients.find(sockfd);
+        auto user_it = m_users.find(sockfd);
+        flight(FR_SQL_DONE, sockfd, ok);
+        if (client_it == m_clients.end() || user_it == m_users.end()) {
+            flight(FR_MISSING, sockfd, 0);
+            continue;
+        }
+
+#ifdef USE_COROUTINE
+        co_conn *ctx = find_coroutine(sockfd);
+        if (ctx && ctx->waiting == co_conn::WAIT_SQL) {
+            ctx->sql_ok = ok;
+            resume_connection(sockfd, false);
+        }
+        continue;
+#endif
+
+        util_timer *timer = &client_it->second->timer;
+        http_conn::PROCESS_RESULT result = user_it->second->on_sql_complete(ok);
+        flight(FR_PROCESS, sockfd, result);
+        if (result == http_conn::PROCESS_ERROR) {
+            close_connection(timer, sockfd, FR_CLOSE_SQL_ERROR);
+            continue;
+        }
+
+        Utils::modfd(m_epollfd, sockfd, EPOLLOUT, m_conn_trig_mode);
+        if (timer) {
+            adjust_timer(timer, CONN_WRITE);
+        }
     }
 }
 
 void SubReactor::timer_handler() {
-    m_timer_wheel.tick();
-}
\ No newline at end of file
+    // 一次性定时器已触发
+    m_armed_ms = 0;
+
+    m_clock.refresh_precise();
+    m_timer_wheel.tick(m_clock.mono_ms());
+
+    if (m_async_sql) {
+        m_async_sql->expire();
+    }
+
+    if (m_clock.mono_ms() >= m_stats_report_ms) {
+        report_timer_stats();
+        m_stats_report_ms = m_clock.mono_ms() + TIMER_STATS_MS;
+    }
+
+    long long next = m_timer_wheel.next_expire();
+    if (next > 0) {
+        schedule_wakeup(next);
+    }
+}
+
+// 统计由时间轮在插入/删除/推进时顺带维护，这里只读快照，不扫描定时器
+void SubReactor::report_timer_stats() {
+    timer_wheel_stats stats = m_timer_wheel.get_stats();
+    if (stats.advances == 0)
+        return;
+
+    LOG_INFO("SubReactor %d timer stats - live: %lu, fired: %llu, rescheduled: %llu, cascaded: %llu, "
+             "advances: %llu, avg: %llu us, p99: <=%llu us, max: %llu us, fired/advance p99: <=%llu, max: %llu",
+             m_sub_reactor_id, stats.live_timers, stats.fired, stats.rescheduled, stats.cascaded,
+             stats.advances, stats.total_tick_us / stats.advances,
+             timer_wheel_stats::percentile(stats.tick_us_hist, 0.99), stats.max_tick_us,
+             timer_wheel_stats::percentile(stats.fired_hist, 0.99), stats.max_fired);
+}
+
+#ifdef USE_COROUTINE
+void SubReactor::start_coroutine(int sockfd, http_conn *conn, util_timer *timer) {
+    if ((size_t)sockfd >= m_coros.size()) {
+        m_coros.resize(sockfd + 1);
+    }
+    if (!m_coros[sockfd]) {
+        m_coros[sockfd] = std::make_unique<co_conn>();
+    }
+    co_conn &ctx = *m_coros[sockfd];
+    ctx.waiter = nullptr;
+    ctx.waiting = co_conn::WAIT_NONE;
+    ctx.timed_out = false;
+    ctx.sql_ok = false;
+    // 协程立即运行到第一次 co_await（等待可读）
+    ctx.task = serve_connection(sockfd, &ctx, conn, timer);
+}
+
+// 销毁协程帧，上下文对象留给复用该 fd 的下一个连接
+void SubReactor::release_coroutine(int sockfd) {
+    co_conn *ctx = find_coroutine(sockfd);
+    if (ctx) {
+        ctx->task.reset();
+        ctx->waiter = nullptr;
+        ctx->waiting = co_conn::WAIT_NONE;
+    }
+}
+
+// 事件到达或超时，恢复连接协程；协程结束即关闭连接
+void SubReactor::resume_connection(int sockfd, bool timed_out) {
+    co_conn *found = find_coroutine(sockfd);
+    if (!found || !found->waiter) {
+        LOG_WARN("SubReactor %d: Connection %d not found in maps", m_sub_reactor_id, sockfd);
+        flight(FR_MISSING, sockfd, 0);
+        return;
+    }
+
+    co_conn &ctx = *found;
+    ctx.timed_out = timed_out;
+    std::coroutine_handle<> waiter = ctx.waiter;
+    ctx.waiter = nullptr;
+    waiter.resume();
+
+    if (!ctx.task.done()) {
+        return;
+    }
+
+    if (timed_out) {
+        // 定时器回调中：定时器由时间轮负责删除
+        release_coroutine(sockfd);
+        close_connection_by_timer(sockfd);
+        return;
+    }
+
+    auto client_it = m_clients.find(sockfd);
+    if (client_it != m_clients.end()) {
+        close_connection(&client_it->second->timer, sockfd, FR_CLOSE_COROUTINE);
+    }
+}
+
+// 连接处理协程：与回调模式的 dealwithread/dealwithwrite 状态机等价
+// epoll 兴趣由 http_conn::write 和这里的 modfd 注册，co_await 只负责挂起
+ConnTask SubReactor::serve_connection(int sockfd, co_conn *ctx, http_conn *conn, util_timer *timer) {
+    while (true) {
+        if (!co_await readable(ctx)) {
+            co_return;  // 超时
+        }
+
+        int flag = conn->read_once();
+        flight(FR_READ, sockfd, conn->get_read_idx(), flag + 1);
+        WS_PROBE4(read, m_sub_reactor_id, sockfd, flag, conn->get_read_idx());
+        if (flag < 0) {
+            co_return;
+        }
+
+        http_conn::PROCESS_RESULT result = conn->process();
+        flight(FR_PROCESS, sockfd, result);
+        WS_PROBE3(parse__complete, m_sub_reactor_id, sockfd, (int)result);
+        if (result == http_conn::PROCESS_ERROR) {
+            co_return;
+        }
+
+        if (result == http_conn::PROCESS_CONTINUE) {
+            // 对端已关闭且请求不完整
+            if (flag == 0) {
+                co_return;
+            }
+            Utils::modfd(m_epollfd, sockfd, EPOLLIN, m_conn_trig_mode);
+            adjust_timer(timer, phase_after_process(result, conn));
+            continue;
+        }
+
+        if (flag == 0) {
+            conn->m_peer_closed = true;
+        }
+
+        if (result == http_conn::PROCESS_PENDING) {
+            adjust_timer(timer, CONN_WRITE);
+            if (!co_await sql_done(ctx)) {
+                co_return;
+            }
+            if (conn->on_sql_complete(ctx->sql_ok) == http_conn::PROCESS_ERROR) {
+                co_return;
+            }
+        }
+
+        // 先直接写，写不完 http_conn 会注册 EPOLLOUT，再挂起等待可写
+        int write_result;
+        while ((write_result = conn->write()) == 0) {
+            flight(FR_WRITE, sockfd, write_result);
+            adjust_timer(timer, CONN_WRITE);
+            if (!co_await writable(ctx)) {
+                co_return;
+            }
+        }
+        flight(FR_WRITE, sockfd, write_result);
+        if (write_result < 0 || !conn->is_reset_for_next()) {
+            co_return;  // 写错误、短连接或对端已关闭
+        }
+
+        // 长连接：http_conn 已注册 EPOLLIN，等待下一个请求
+        adjust_timer(timer, CONN_IDLE);
+    }
+}
+#endif
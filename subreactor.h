@@ -3,6 +3,7 @@
 
 #include <sys/socket.h>
 #include <sys/timerfd.h>
+#include <sys/eventfd.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <stdio.h>
@@ -12,7 +13,7 @@
 #include <stdlib.h>
 #include <cassert>
 #include <sys/epoll.h>
-#include <queue>
+#include <vector>
 #include <unordered_map>
 #include <memory>
 #include <string>
@@ -21,15 +22,29 @@
 
 #include "./http/http_conn.h"
 #include "./timer/lst_timer.h"
+#include "./utils/clock.h"
 #include "./utils/utils.h"
+#include "./utils/probes.h"
+#include "./userstore/user_store.h"
+#include "./coroutine/co_task.h"
+#include "./metrics/metrics.h"
+#include "./metrics/trace.h"
+#include "./log/flight_recorder.h"
 
 const int SUB_MAX_EVENT_NUMBER = 10000; // SubReactor最大事件数
 
+// 主 Reactor accept4 得到的连接（fd 已是非阻塞）
+struct accepted_connection {
+    int fd;
+    sockaddr_in address;
+};
+
 class SubReactor {
 public:
     SubReactor(int sub_reactor_id, const char* root, int conn_trig_mode, int close_log,
                const std::string& user, const std::string& passWord, const std::string& databaseName,
-               connection_pool* connPool);
+               connection_pool* connPool, int sql_slice, bool sql_async, UserStore* user_store,
+               const conn_deadlines& deadlines, int access_sample, int trace_sample);
     ~SubReactor();
 
     // 启动SubReactor线程
@@ -38,15 +53,22 @@ public:
     // 停止SubReactor线程
     void stop();
 
-    // 添加新连接（由主Reactor调用）
+    // 添加新连接（由主Reactor调用），fd 必须已是非阻塞
     bool add_connection(int connfd, struct sockaddr_in client_address);
 
+    // 一批连接只加一次锁，队列由空变非空时才写 eventfd 唤醒本线程；超出连接上限的直接拒绝并关闭
+    // 返回接收的连接数
+    int add_connections(const accepted_connection* conns, int count);
+
     // 获取当前连接数
     int get_connection_count() const { return m_user_count.load(); }
 
     // 获取SubReactor ID
     int get_sub_reactor_id() const { return m_sub_reactor_id; }
 
+    // 时间轮统计快照（O(1)），只能在本 SubReactor 线程内调用
+    timer_wheel_stats get_timer_stats() const { return m_timer_wheel.get_stats(); }
+
 private:
     // SubReactor主事件循环
     void eventLoop();
@@ -60,22 +82,55 @@ private:
     // 处理异常连接
     void dealwithexception(int sockfd);
 
+    // 处理异步数据库查询完成的连接
+    void dealwithsql();
+
     // 初始化epoll
     void initEpoll();
 
+    // 取出待处理队列中的全部新连接并注册到本线程（由 eventfd 唤醒）
+    void take_pending_connections();
+
     // 创建定时器
     void create_timer(int connfd, struct sockaddr_in client_address);
 
-    // 调整定时器
-    void adjust_timer(util_timer* timer);
+    // 按连接阶段调整定时器期限
+    void adjust_timer(util_timer* timer, CONN_PHASE phase);
+
+    // 记录需要的最早唤醒时间，每轮事件处理结束由 rearm_timer 统一设置 timerfd
+    void schedule_wakeup(long long when);
+    void rearm_timer();
 
     // 关闭连接
-    void close_connection(util_timer *timer, int sockfd);
+    void close_connection(util_timer *timer, int sockfd, FLIGHT_CLOSE_REASON reason);
     void close_connection_by_timer(int sockfd);
+    static void on_timer_expire(util_timer *timer, void *arg);
 
     // 定时器处理
     void timer_handler();
 
+    // 输出时间轮统计
+    void report_timer_stats();
+
+    // 记一条飞行记录事件，时间取本轮事件循环缓存的时钟
+    void flight(FLIGHT_EVENT type, int fd, int arg, int extra = 0) {
+        m_flight.record(m_clock.mono_ms(), type, fd, arg, extra);
+    }
+
+#ifdef USE_COROUTINE
+    // 协程模式：连接处理协程及其恢复入口
+    void start_coroutine(int sockfd, http_conn *conn, util_timer *timer);
+    ConnTask serve_connection(int sockfd, co_conn *ctx, http_conn *conn, util_timer *timer);
+    void resume_connection(int sockfd, bool timed_out);
+    // 该 fd 上运行中的协程上下文，没有返回 nullptr
+    co_conn *find_coroutine(int sockfd) {
+        if (sockfd < 0 || (size_t)sockfd >= m_coros.size() || !m_coros[sockfd] || !m_coros[sockfd]->task.valid())
+            return nullptr;
+        return m_coros[sockfd].get();
+    }
+    void release_coroutine(int sockfd);
+#endif
+
 private:
     int m_sub_reactor_id;                              // SubReactor ID
     char* m_root;                                      // 资源目录路径
@@ -84,6 +139,11 @@ private:
 
     // 数据库相关
     connection_pool* m_connPool;                       // 数据库连接池
+    local_connection_pool m_local_pool;                // 私有连接切片（无锁）
+    int m_sql_slice;                                   // 私有切片大小，0表示直接使用全局池
+    bool m_sql_async;                                  // 是否使用非阻塞数据库查询
+    std::unique_ptr<async_sql_executor> m_async_sql;   // 非阻塞查询执行器
+    UserStore* m_user_store;                           // 用户存储
     std::string m_user;                                // 数据库用户名
     std::string m_passWord;                            // 数据库密码
     std::string m_databaseName;                        // 数据库名
@@ -95,6 +155,24 @@ private:
     // 定时器相关
     int m_timerfd;                                     // 定时器文件描述符
     TimingWheel m_timer_wheel;                         // 时间轮
+    LoopClock m_clock;                                 // 每轮 epoll_wait 后刷新的缓存时钟
+    conn_deadlines m_deadlines;                        // 各阶段期限
+    long long m_armed_ms;                              // timerfd 当前设置的唤醒时间，0表示未设置
+    long long m_wakeup_ms;                             // 本轮需要的最早唤醒时间，0表示无
+    long long m_stats_report_ms = 0;                   // 下次输出定时器统计的时间
+
+    // 指标（只有本线程写，管理端口抓取时只读）
+    reactor_metrics m_metrics;
+
+    // 请求阶段追踪（采样，环形缓冲区，/debug/trace 导出）
+    request_tracer m_tracer;
+
+    // 连接事件飞行记录器（始终开启，SIGUSR2 转储）
+    flight_recorder m_flight;
+
+    // 访问日志
+    access_log m_access_log;                           // 本 SubReactor 的映射环文件
+    int m_access_sample;                               // 采样间隔，0 表示关闭
 
     // 客户端连接管理
     std::atomic<int> m_user_count{0};                  // 当前连接数
@@ -105,10 +183,22 @@ private:
     std::thread m_thread;                              // SubReactor线程
     std::atomic<bool> m_running{false};                // 运行状态
 
-    // 连接添加队列（线程安全）
-    std::queue<std::pair<int, sockaddr_in>> m_pending_connections;
+    // 连接添加队列（线程安全），本线程整批换出，两个 vector 交替使用不再分配
+    struct pending_connection {
+        int fd;
+        sockaddr_in address;
+        uint64_t queued_ticks;                         // 入队时的 TSC，未开启追踪为 0
+    };
+    std::vector<pending_connection> m_pending_connections;
+    std::vector<pending_connection> m_taken_connections;
     std::mutex m_connection_mutex;                     // 连接队列锁
-    std::condition_variable m_connection_cv;           // 连接条件变量
+    int m_wakeup_fd = -1;                              // 新连接入队或停止时唤醒 epoll_wait 的 eventfd
+
+#ifdef USE_COROUTINE
+    FramePool m_frame_pool;                            // 协程帧分配器
+    // 每个连接的协程上下文，按 fd 下标，关闭后留给复用该 fd 的连接：恢复协程不做哈希查找，建连不分配
+    std::vector<std::unique_ptr<co_conn>> m_coros;
+#endif
 };
 
 #endif // SUBREACTOR_H
\ No newline at end of file
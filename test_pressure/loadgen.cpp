@@ -0,0 +1,1052 @@
+// loadgen：多线程 epoll HTTP/1.1 压测工具，替代 fork 一个进程一个客户端、只支持 HTTP/1.0 的 webbench
+// 用法：./test_pressure/loadgen [选项]
+//   -a host      服务器地址，默认 127.0.0.1
+//   -p port      端口，默认 9006
+//   -t threads   工作线程数，默认 4
+//   -c conns     连接总数，平均分到各线程，默认 100
+//   -d seconds   压测时长，默认 10
+//   -k 0|1       1 长连接（Connection: keep-alive），0 每个请求新建连接，默认 1
+//   -V 1.0|1.1   HTTP 版本，1.0 时不带 Connection 头、每个请求新建连接（与 webbench 相同），默认 1.1
+//   -P depth     每个连接同时在途的请求数（流水线深度），默认 1，短连接时固定为 1
+//   -R rate      开环恒定速率（请求/秒，所有线程合计），0 为闭环（收到响应才发下一个），默认 0
+//   -s file      场景文件，按权重混合多种请求，默认只请求 -u 指定的 URL
+//   -u url       未指定场景文件时请求的路径，默认 /
+//   -T ms        在途请求无进展超过该时长记为超时并重连，默认 2000
+//   -W N|body    请求分多次写：N 为每次写的字节数，body 为请求头和请求体分两次写；默认一次写完
+//   -G us        分次写之间的间隔（微秒），默认 0；例如 -W 8 -G 200 为分片请求，-W 1 -G 1000 为慢速客户端
+//   -H bytes     请求附带一个该长度的 X-Padding 头，用于超长请求头（服务器应直接关闭连接）
+//   -j file      额外输出 JSON 结果（- 表示标准输出）
+//
+// 场景文件每行：权重 方法 路径 [请求体]，# 开头为注释，例如
+//   8 GET /
+//   1 GET /judge.html
+//   1 POST /2CGISQL.cgi user=test&password=test
+//
+// 延迟统计：
+//   闭环：从请求进入发送缓冲到收完整个响应
+//   开环：从按速率排定的发送时刻算起，发送端因连接都忙而推迟的时间也计入延迟，
+//         避免 coordinated omission（服务器变慢时压测端跟着少发，慢请求被少计）
+// 分位数用 HDR 式对数分桶直方图，每个 2 的幂区间分 128 格，相对误差 < 1%
+//
+// 服务器在响应前关闭连接（如超长请求头）记为 closed 错误并立即重连，closed/s 即拒绝速率
+//
+// 连接周转（-k 0 或 -V 1.0）：另给出每秒建立的连接数，以及从 connect()（发出 SYN）到收到响应第一个字节的
+// 延迟，包含握手、服务器 accept 与分发、首个请求的处理，例如
+//   ./test_pressure/loadgen -V 1.0 -c 200 -d 10
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <signal.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// ========== 延迟直方图 ==========
+
+// 单位微秒；值 v 落在 [2^e, 2^(e+1)) 时再按次高 7 位细分
+class hdr_histogram {
+public:
+    static const int SUB_BITS = 7;
+    static const int SUB_COUNT = 1 << SUB_BITS;
+    static const int MAX_EXP = 40;
+    static const int BUCKETS = SUB_COUNT + (MAX_EXP - SUB_BITS + 1) * SUB_COUNT;
+
+    hdr_histogram() : m_counts(BUCKETS, 0), m_total(0), m_sum(0), m_min(UINT64_MAX), m_max(0) {}
+
+    static int index(uint64_t v) {
+        if (v < (uint64_t)SUB_COUNT)
+            return (int)v;
+        int e = 63 - __builtin_clzll(v);
+        if (e > MAX_EXP)
+            return BUCKETS - 1;
+        int sub = (int)((v >> (e - SUB_BITS)) & (SUB_COUNT - 1));
+        return SUB_COUNT + (e - SUB_BITS) * SUB_COUNT + sub;
+    }
+
+    static uint64_t lower(int idx) {
+        if (idx < SUB_COUNT)
+            return idx;
+        int e = (idx - SUB_COUNT) / SUB_COUNT + SUB_BITS;
+        int sub = (idx - SUB_COUNT) % SUB_COUNT;
+        return ((uint64_t)1 << e) + ((uint64_t)sub << (e - SUB_BITS));
+    }
+
+    void record(uint64_t v) {
+        m_counts[index(v)]++;
+        m_total++;
+        m_sum += v;
+        if (v < m_min) m_min = v;
+        if (v > m_max) m_max = v;
+    }
+
+    void merge(const hdr_histogram &other) {
+        for (int i = 0; i < BUCKETS; i++)
+            m_counts[i] += other.m_counts[i];
+        m_total += other.m_total;
+        m_sum += other.m_sum;
+        if (other.m_min < m_min) m_min = other.m_min;
+        if (other.m_max > m_max) m_max = other.m_max;
+    }
+
+    // 取桶中点，且不超过实测最大值
+    uint64_t percentile(double q) const {
+        if (m_total == 0)
+            return 0;
+        uint64_t rank = (uint64_t)(q / 100.0 * m_total + 0.5);
+        if (rank < 1) rank = 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; i++) {
+            seen += m_counts[i];
+            if (seen >= rank) {
+                uint64_t lo = lower(i);
+                uint64_t hi = i + 1 < BUCKETS ? lower(i + 1) : lo + 1;
+                uint64_t mid = lo + (hi - lo) / 2;
+                if (mid < m_min) mid = m_min;
+                return mid < m_max ? mid : m_max;
+            }
+        }
+        return m_max;
+    }
+
+    uint64_t total() const { return m_total; }
+    uint64_t min() const { return m_total ? m_min : 0; }
+    uint64_t max() const { return m_max; }
+    double mean() const { return m_total ? (double)m_sum / m_total : 0.0; }
+
+private:
+    std::vector<uint64_t> m_counts;
+    uint64_t m_total;
+    uint64_t m_sum;
+    uint64_t m_min;
+    uint64_t m_max;
+};
+
+static const double PERCENTILES[] = {50, 75, 90, 99, 99.9, 99.99};
+static const char *const PERCENTILE_NAMES[] = {"p50", "p75", "p90", "p99", "p99.9", "p99.99"};
+static const int PERCENTILE_COUNT = sizeof(PERCENTILES) / sizeof(PERCENTILES[0]);
+
+// ========== 配置与场景 ==========
+
+struct request_template {
+    int weight;
+    std::string name;       // "GET /judge.html"，用于分项统计
+    std::string raw;        // 预先拼好的完整请求
+};
+
+struct options {
+    std::string host = "127.0.0.1";
+    int port = 9006;
+    int threads = 4;
+    int connections = 100;
+    int duration = 10;
+    bool keep_alive = true;
+    bool http10 = false;
+    int depth = 1;
+    double rate = 0;
+    std::string scenario;
+    std::string url = "/";
+    int timeout_ms = 2000;
+    int write_size = 0;         // 每次写的字节数，0 为一次写完
+    bool split_body = false;    // 请求头和请求体分两次写
+    int write_gap_us = 0;
+    int padding = 0;
+    std::string json;
+
+    bool paced() const { return write_size > 0 || split_body; }
+};
+
+static std::string build_request(const options &opt, const std::string &method, const std::string &path,
+                                 const std::string &body) {
+    std::string raw = method + " " + path + (opt.http10 ? " HTTP/1.0" : " HTTP/1.1") + "\r\nHost: " + opt.host + ":" +
+                      std::to_string(opt.port) + "\r\n";
+    if (!opt.http10)
+        raw += opt.keep_alive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+    if (opt.padding > 0)
+        raw += "X-Padding: " + std::string(opt.padding, 'a') + "\r\n";
+    if (!body.empty() || method == "POST") {
+        raw += "Content-Type: application/x-www-form-urlencoded\r\n";
+        raw += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+    }
+    raw += "\r\n";
+    raw += body;
+    return raw;
+}
+
+static bool load_scenario(const options &opt, std::vector<request_template> *out) {
+    FILE *fp = fopen(opt.scenario.c_str(), "r");
+    if (!fp) {
+        perror(opt.scenario.c_str());
+        return false;
+    }
+    char line[4096];
+    int lineno = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        lineno++;
+        line[strcspn(line, "\r\n")] = '\0';
+        char *p = line + strspn(line, " \t");
+        if (*p == '\0' || *p == '#')
+            continue;
+
+        char method[16], path[2048];
+        int weight, consumed = 0;
+        if (sscanf(p, "%d %15s %2047s %n", &weight, method, path, &consumed) < 3 || weight <= 0) {
+            fprintf(stderr, "%s:%d: expected \"weight METHOD path [body]\"\n", opt.scenario.c_str(), lineno);
+            fclose(fp);
+            return false;
+        }
+        std::string body = consumed > 0 ? p + consumed : "";
+        request_template tmpl;
+        tmpl.weight = weight;
+        tmpl.name = std::string(method) + " " + path;
+        tmpl.raw = build_request(opt, method, path, body);
+        out->push_back(tmpl);
+    }
+    fclose(fp);
+    if (out->empty()) {
+        fprintf(stderr, "%s: no requests\n", opt.scenario.c_str());
+        return false;
+    }
+    return true;
+}
+
+// ========== 统计 ==========
+
+struct stats {
+    uint64_t sent = 0;
+    uint64_t completed = 0;
+    uint64_t bytes = 0;
+    uint64_t status[6] = {0};       // 下标为状态码首位，0 为无法识别
+    uint64_t connects = 0;
+    uint64_t err_connect = 0;
+    uint64_t err_read = 0;          // recv 出错或响应格式错误
+    uint64_t err_write = 0;
+    uint64_t err_closed = 0;        // 对端关闭时仍有在途请求
+    uint64_t err_timeout = 0;
+    uint64_t scheduled = 0;         // 开环：按速率排定的请求数
+    uint64_t backlog = 0;           // 开环：结束时仍未发出的请求数
+    hdr_histogram latency;
+    hdr_histogram first_byte;       // connect() 到响应第一个字节
+    std::vector<hdr_histogram> per_request;
+    std::vector<uint64_t> per_request_count;
+
+    void merge(const stats &o) {
+        sent += o.sent;
+        completed += o.completed;
+        bytes += o.bytes;
+        for (int i = 0; i < 6; i++)
+            status[i] += o.status[i];
+        connects += o.connects;
+        err_connect += o.err_connect;
+        err_read += o.err_read;
+        err_write += o.err_write;
+        err_closed += o.err_closed;
+        err_timeout += o.err_timeout;
+        scheduled += o.scheduled;
+        backlog += o.backlog;
+        latency.merge(o.latency);
+        first_byte.merge(o.first_byte);
+        for (size_t i = 0; i < per_request.size(); i++) {
+            per_request[i].merge(o.per_request[i]);
+            per_request_count[i] += o.per_request_count[i];
+        }
+    }
+};
+
+// ========== 工作线程 ==========
+
+struct inflight {
+    uint64_t start_ns;
+    int tmpl;
+};
+
+struct conn {
+    int fd = -1;
+    uint32_t generation = 0;        // 重连后递增，丢弃旧 fd 残留的 epoll 事件
+    bool connected = false;
+    bool want_out = false;
+    bool in_ready = false;          // 开环：是否在可发送栈中
+    uint64_t retry_at = 0;          // 连接失败后的重试时刻
+    uint64_t connect_ns = 0;        // 调用 connect() 的时刻
+    bool first_byte = false;        // 本连接是否已收到过数据
+    uint64_t last_progress = 0;
+    uint64_t next_write = 0;        // 分次写：下一次可写的时刻，0 为不等待
+    std::deque<inflight> pending;
+    std::string out;
+    size_t out_off = 0;
+
+    // 响应解析状态
+    std::vector<char> in;
+    size_t in_len = 0;
+    bool in_body = false;
+    uint64_t body_left = 0;
+    int status = 0;
+    bool close_after = false;
+};
+
+class worker {
+public:
+    worker(const options &opt, const std::vector<request_template> &reqs, const sockaddr_in &addr, int id,
+           int connections, uint64_t start, uint64_t end)
+        : m_opt(opt), m_reqs(reqs), m_addr(addr), m_id(id), m_conns(connections), m_start(start), m_end(end),
+          m_epollfd(-1), m_rng(0x9e3779b97f4a7c15ULL * (id + 1)), m_next_due(0), m_interval(0) {
+        m_stats.per_request.resize(reqs.size());
+        m_stats.per_request_count.resize(reqs.size(), 0);
+        m_total_weight = 0;
+        for (const request_template &r : reqs)
+            m_total_weight += r.weight;
+    }
+
+    void run();
+    const stats &result() const { return m_stats; }
+
+private:
+    static const size_t IN_BUFFER = 64 * 1024;
+    static const uint64_t RETRY_NS = 100 * 1000000ULL;
+    static const uint64_t SWEEP_NS = 50 * 1000000ULL;
+
+    bool open_loop() const { return m_opt.rate > 0; }
+    int depth() const { return m_opt.keep_alive ? m_opt.depth : 1; }
+
+    int pick();
+    void open_conn(conn &c, uint64_t now);
+    void close_conn(conn &c, uint64_t now, bool reopen);
+    void fail_conn(conn &c, uint64_t now, uint64_t *counter);
+    void peer_closed(conn &c, uint64_t now);
+    void update_events(conn &c);
+    void finish_connect(conn &c, uint64_t now);
+    void enqueue(conn &c, int tmpl, uint64_t start);
+    void fill(conn &c, uint64_t now);
+    void mark_ready(conn &c);
+    void flush(conn &c, uint64_t now);
+    void on_readable(conn &c, uint64_t now);
+    bool parse(conn &c, uint64_t now);
+    void on_response(conn &c, uint64_t now);
+    void schedule(uint64_t now);
+    void dispatch();
+    void sweep(uint64_t now);
+    size_t write_limit(const conn &c) const;
+    void resume_writes(uint64_t now);
+    uint64_t next_write_due() const;
+
+    const options &m_opt;
+    const std::vector<request_template> &m_reqs;
+    sockaddr_in m_addr;
+    int m_id;
+    std::vector<conn> m_conns;
+    uint64_t m_start;
+    uint64_t m_end;
+    int m_epollfd;
+    uint64_t m_rng;
+    int m_total_weight;
+
+    // 开环调度
+    uint64_t m_next_due;
+    uint64_t m_interval;
+    std::deque<uint64_t> m_backlog;
+    std::vector<conn *> m_ready;
+
+    stats m_stats;
+};
+
+int worker::pick() {
+    if (m_reqs.size() == 1)
+        return 0;
+    m_rng ^= m_rng << 13;
+    m_rng ^= m_rng >> 7;
+    m_rng ^= m_rng << 17;
+    int r = (int)(m_rng % (uint64_t)m_total_weight);
+    for (size_t i = 0; i < m_reqs.size(); i++) {
+        r -= m_reqs[i].weight;
+        if (r < 0)
+            return (int)i;
+    }
+    return 0;
+}
+
+void worker::update_events(conn &c) {
+    epoll_event ev;
+    ev.events = EPOLLIN | (c.want_out || !c.connected ? EPOLLOUT : 0);
+    ev.data.u64 = ((uint64_t)c.generation << 32) | (uint64_t)(&c - &m_conns[0]);
+    epoll_ctl(m_epollfd, EPOLL_CTL_MOD, c.fd, &ev);
+}
+
+void worker::open_conn(conn &c, uint64_t now) {
+    c.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (c.fd < 0) {
+        m_stats.err_connect++;
+        c.retry_at = now + RETRY_NS;
+        return;
+    }
+    int one = 1;
+    setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    c.generation++;
+    c.connected = false;
+    c.want_out = false;
+    c.in_body = false;
+    c.in_len = 0;
+    c.out.clear();
+    c.out_off = 0;
+    c.next_write = 0;
+    c.last_progress = now;
+    if (c.in.empty())
+        c.in.resize(IN_BUFFER);
+
+    c.connect_ns = now_ns();
+    c.first_byte = false;
+    if (connect(c.fd, (const sockaddr *)&m_addr, sizeof(m_addr)) < 0 && errno != EINPROGRESS) {
+        m_stats.err_connect++;
+        close(c.fd);
+        c.fd = -1;
+        c.retry_at = now + RETRY_NS;
+        return;
+    }
+    epoll_event ev;
+    ev.events = EPOLLIN | EPOLLOUT;
+    ev.data.u64 = ((uint64_t)c.generation << 32) | (uint64_t)(&c - &m_conns[0]);
+    epoll_ctl(m_epollfd, EPOLL_CTL_ADD, c.fd, &ev);
+
+    // 连接建立期间的请求先进发送缓冲，短连接的延迟因此包含建连时间
+    if (open_loop())
+        mark_ready(c);
+    else
+        fill(c, now);
+}
+
+// 在途请求已由调用者计入错误
+void worker::close_conn(conn &c, uint64_t now, bool reopen) {
+    if (c.fd >= 0) {
+        epoll_ctl(m_epollfd, EPOLL_CTL_DEL, c.fd, nullptr);
+        close(c.fd);
+        c.fd = -1;
+    }
+    c.connected = false;
+    c.pending.clear();
+    if (reopen && now < m_end)
+        open_conn(c, now);
+}
+
+void worker::fail_conn(conn &c, uint64_t now, uint64_t *counter) {
+    *counter += c.pending.empty() ? 1 : c.pending.size();
+    close_conn(c, now, false);
+    c.retry_at = now + RETRY_NS;
+}
+
+// 服务器没回完就关闭（如拒绝超长请求头，未读完的数据使关闭变成 RST）：连接本身是好的，立即重连
+void worker::peer_closed(conn &c, uint64_t now) {
+    m_stats.err_closed += c.pending.empty() ? 1 : c.pending.size();
+    close_conn(c, now, true);
+}
+
+void worker::finish_connect(conn &c, uint64_t now) {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0) {
+        m_stats.err_connect++;
+        c.pending.clear();
+        close_conn(c, now, false);
+        c.retry_at = now + RETRY_NS;
+        return;
+    }
+    c.connected = true;
+    c.last_progress = now;
+    m_stats.connects++;
+    flush(c, now);
+    if (c.fd >= 0)
+        update_events(c);
+}
+
+void worker::enqueue(conn &c, int tmpl, uint64_t start) {
+    c.out.append(m_reqs[tmpl].raw);
+    c.pending.push_back({start, tmpl});
+    m_stats.sent++;
+}
+
+// 闭环：把连接补满到流水线深度
+void worker::fill(conn &c, uint64_t now) {
+    if ((int)c.pending.size() >= depth())
+        return;
+    if (c.pending.empty())
+        c.last_progress = now;
+    while ((int)c.pending.size() < depth())
+        enqueue(c, pick(), now);
+    if (c.connected)
+        flush(c, now);
+}
+
+void worker::mark_ready(conn &c) {
+    if (!c.in_ready && c.fd >= 0 && (int)c.pending.size() < depth()) {
+        c.in_ready = true;
+        m_ready.push_back(&c);
+    }
+}
+
+// 分次写时本次最多写到的位置：下一个 N 字节边界，或下一个请求头结尾
+size_t worker::write_limit(const conn &c) const {
+    size_t end = c.out.size();
+    if (m_opt.split_body) {
+        const char *head = (const char *)memmem(c.out.data() + c.out_off, end - c.out_off, "\r\n\r\n", 4);
+        if (head)
+            end = head + 4 - c.out.data();
+    }
+    if (m_opt.write_size > 0 && end - c.out_off > (size_t)m_opt.write_size)
+        end = c.out_off + m_opt.write_size;
+    return end;
+}
+
+void worker::flush(conn &c, uint64_t now) {
+    if (c.next_write > now)
+        return;
+    c.next_write = 0;
+    while (c.out_off < c.out.size()) {
+        size_t end = m_opt.paced() ? write_limit(c) : c.out.size();
+        ssize_t n = send(c.fd, c.out.data() + c.out_off, end - c.out_off, MSG_NOSIGNAL);
+        if (n > 0) {
+            c.out_off += n;
+            c.last_progress = now;
+            // 分次写：每片单独一次 send，有间隔时等到期后由 resume_writes 继续
+            if (m_opt.write_gap_us > 0 && m_opt.paced() && c.out_off < c.out.size()) {
+                c.next_write = now + (uint64_t)m_opt.write_gap_us * 1000;
+                return;
+            }
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!c.want_out) {
+                c.want_out = true;
+                update_events(c);
+            }
+            return;
+        }
+        if (errno == EPIPE || errno == ECONNRESET) {
+            peer_closed(c, now);
+            return;
+        }
+        fail_conn(c, now, &m_stats.err_write);
+        return;
+    }
+    c.out.clear();
+    c.out_off = 0;
+    if (c.want_out) {
+        c.want_out = false;
+        update_events(c);
+    }
+}
+
+void worker::on_readable(conn &c, uint64_t now) {
+    uint32_t generation = c.generation;
+    while (c.fd >= 0 && c.generation == generation) {
+        if (c.in_len == c.in.size()) {
+            // 头部超过缓冲区
+            fail_conn(c, now, &m_stats.err_read);
+            return;
+        }
+        ssize_t n = recv(c.fd, c.in.data() + c.in_len, c.in.size() - c.in_len, 0);
+        if (n > 0) {
+            // 同一轮里可能读到刚补发请求的响应，时间要取新的
+            now = now_ns();
+            if (!c.first_byte) {
+                c.first_byte = true;
+                m_stats.first_byte.record((now - c.connect_ns) / 1000);
+            }
+            c.in_len += n;
+            c.last_progress = now;
+            m_stats.bytes += n;
+            if (!parse(c, now))
+                return;
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+        if (n == 0 && c.pending.empty()) {
+            // 空闲长连接被服务器关闭（如超时），直接重连
+            close_conn(c, now, true);
+            return;
+        }
+        if (n == 0 || errno == ECONNRESET) {
+            peer_closed(c, now);
+            return;
+        }
+        fail_conn(c, now, &m_stats.err_read);
+        return;
+    }
+}
+
+// 解析缓冲区中所有完整响应；连接被关闭或已重连时返回 false
+bool worker::parse(conn &c, uint64_t now) {
+    uint32_t generation = c.generation;
+    size_t off = 0;
+    while (true) {
+        if (c.in_body) {
+            uint64_t take = c.in_len - off < c.body_left ? c.in_len - off : c.body_left;
+            off += take;
+            c.body_left -= take;
+            if (c.body_left > 0)
+                break;
+            c.in_body = false;
+            on_response(c, now);
+            if (c.fd < 0 || c.generation != generation)
+                return false;
+            continue;
+        }
+
+        const char *begin = c.in.data() + off;
+        size_t avail = c.in_len - off;
+        const char *end = (const char *)memmem(begin, avail, "\r\n\r\n", 4);
+        if (!end)
+            break;
+        if (c.pending.empty() || avail < 12 || strncmp(begin, "HTTP/1.", 7) != 0) {
+            fail_conn(c, now, &m_stats.err_read);
+            return false;
+        }
+        c.status = atoi(begin + 9);
+        c.body_left = 0;
+        c.close_after = !m_opt.keep_alive;
+        // 逐行查找 Content-Length 与 Connection
+        const char *line = (const char *)memchr(begin, '\n', end - begin) + 1;
+        while (line < end) {
+            const char *eol = (const char *)memchr(line, '\n', end + 2 - line);
+            if (!eol)
+                break;
+            if (strncasecmp(line, "Content-Length:", 15) == 0)
+                c.body_left = strtoull(line + 15, nullptr, 10);
+            else if (strncasecmp(line, "Connection:", 11) == 0) {
+                const char *v = line + 11;
+                while (*v == ' ')
+                    v++;
+                if (strncasecmp(v, "close", 5) == 0)
+                    c.close_after = true;
+            }
+            line = eol + 1;
+        }
+        off = end + 4 - c.in.data();
+        c.in_body = true;
+    }
+    // 未解析部分移到缓冲区开头
+    if (off > 0) {
+        memmove(c.in.data(), c.in.data() + off, c.in_len - off);
+        c.in_len -= off;
+    }
+    return true;
+}
+
+void worker::on_response(conn &c, uint64_t now) {
+    inflight req = c.pending.front();
+    c.pending.pop_front();
+    uint64_t us = now > req.start_ns ? (now - req.start_ns) / 1000 : 0;
+    m_stats.completed++;
+    m_stats.latency.record(us);
+    m_stats.per_request[req.tmpl].record(us);
+    m_stats.per_request_count[req.tmpl]++;
+    int cls = c.status / 100;
+    m_stats.status[cls >= 1 && cls <= 5 ? cls : 0]++;
+
+    if (c.close_after) {
+        // 服务器会关闭连接，其后排队的请求不会有响应
+        m_stats.err_closed += c.pending.size();
+        close_conn(c, now, true);
+        return;
+    }
+    if (open_loop())
+        mark_ready(c);
+    else
+        fill(c, now);
+}
+
+// 开环：把到期的发送时刻放入积压队列
+void worker::schedule(uint64_t now) {
+    while (m_next_due <= now && m_next_due < m_end) {
+        m_backlog.push_back(m_next_due);
+        m_next_due += m_interval;
+        m_stats.scheduled++;
+    }
+}
+
+void worker::dispatch() {
+    uint64_t now = now_ns();
+    while (!m_backlog.empty() && !m_ready.empty()) {
+        conn &c = *m_ready.back();
+        if (c.fd < 0 || (int)c.pending.size() >= depth()) {
+            c.in_ready = false;
+            m_ready.pop_back();
+            continue;
+        }
+        if (c.pending.empty())
+            c.last_progress = now;
+        enqueue(c, pick(), m_backlog.front());
+        m_backlog.pop_front();
+        if ((int)c.pending.size() >= depth()) {
+            c.in_ready = false;
+            m_ready.pop_back();
+        }
+        if (c.connected)
+            flush(c, now);
+    }
+}
+
+// 分次写：间隔已到的连接继续写
+void worker::resume_writes(uint64_t now) {
+    for (conn &c : m_conns) {
+        if (c.fd >= 0 && c.connected && c.next_write && c.next_write <= now)
+            flush(c, now);
+    }
+}
+
+uint64_t worker::next_write_due() const {
+    uint64_t due = 0;
+    for (const conn &c : m_conns) {
+        if (c.fd >= 0 && c.next_write && (!due || c.next_write < due))
+            due = c.next_write;
+    }
+    return due;
+}
+
+// 超时检查与失败连接重试
+void worker::sweep(uint64_t now) {
+    uint64_t timeout = (uint64_t)m_opt.timeout_ms * 1000000ULL;
+    for (conn &c : m_conns) {
+        if (c.fd < 0) {
+            if (c.retry_at <= now)
+                open_conn(c, now);
+            continue;
+        }
+        // 处理事件时 last_progress 取的是更新的时间，可能晚于 now，不能直接做无符号减法
+        bool stalled = !c.connected || !c.pending.empty();
+        if (stalled && now > c.last_progress && now - c.last_progress > timeout) {
+            m_stats.err_timeout += c.pending.size();
+            if (!c.connected)
+                m_stats.err_connect++;
+            c.pending.clear();
+            close_conn(c, now, true);
+        }
+    }
+}
+
+void worker::run() {
+    m_epollfd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epollfd < 0) {
+        perror("epoll_create1");
+        return;
+    }
+    if (open_loop()) {
+        // 每个线程分担 rate / threads，并把起点错开半个到一个间隔，避免各线程同时发
+        m_interval = (uint64_t)(1e9 * m_opt.threads / m_opt.rate);
+        if (m_interval == 0)
+            m_interval = 1;
+        m_next_due = m_start + m_interval * m_id / m_opt.threads;
+    }
+
+    uint64_t now = now_ns();
+    for (conn &c : m_conns)
+        open_conn(c, now);
+
+    epoll_event events[256];
+    uint64_t next_sweep = now + SWEEP_NS;
+    while (true) {
+        now = now_ns();
+        if (now >= m_end)
+            break;
+        if (open_loop()) {
+            schedule(now);
+            dispatch();
+        }
+
+        // 开环时等到下一个发送时刻；不足 1 毫秒就不睡，直接轮询
+        uint64_t wake = next_sweep < m_end ? next_sweep : m_end;
+        if (open_loop() && m_backlog.empty() && m_next_due < wake)
+            wake = m_next_due;
+        uint64_t write_due = m_opt.write_gap_us > 0 ? next_write_due() : 0;
+        if (write_due && write_due < wake)
+            wake = write_due;
+        int timeout = wake > now ? (int)((wake - now) / 1000000ULL) : 0;
+
+        int n = epoll_wait(m_epollfd, events, 256, timeout);
+        if (n < 0 && errno != EINTR) {
+            perror("epoll_wait");
+            break;
+        }
+        now = now_ns();
+        if (m_opt.write_gap_us > 0)
+            resume_writes(now);
+        for (int i = 0; i < n; i++) {
+            conn &c = m_conns[(uint32_t)events[i].data.u64];
+            if (c.fd < 0 || c.generation != (uint32_t)(events[i].data.u64 >> 32))
+                continue;
+            uint32_t mask = events[i].events;
+            uint32_t generation = c.generation;
+            if (!c.connected) {
+                if (mask & (EPOLLOUT | EPOLLERR | EPOLLHUP))
+                    finish_connect(c, now);
+                continue;
+            }
+            if (mask & (EPOLLIN | EPOLLERR | EPOLLHUP))
+                on_readable(c, now);
+            // 读的过程中可能已经关闭或重连
+            if (c.fd >= 0 && c.generation == generation && (mask & EPOLLOUT))
+                flush(c, now);
+        }
+        if (now >= next_sweep) {
+            now = now_ns();
+            sweep(now);
+            next_sweep = now + SWEEP_NS;
+        }
+    }
+
+    m_stats.backlog = m_backlog.size();
+    for (conn &c : m_conns) {
+        if (c.fd >= 0)
+            close(c.fd);
+    }
+    close(m_epollfd);
+}
+
+// ========== 输出 ==========
+
+static void print_text(const options &opt, const std::vector<request_template> &reqs, const stats &s, double secs) {
+    printf("%s:%d, %d threads, %d connections, HTTP/%s, %s, pipeline %d, ", opt.host.c_str(), opt.port, opt.threads,
+           opt.connections, opt.http10 ? "1.0" : "1.1", opt.keep_alive ? "keep-alive" : "short connections",
+           opt.keep_alive ? opt.depth : 1);
+    if (opt.rate > 0)
+        printf("open loop %.0f req/s, ", opt.rate);
+    else
+        printf("closed loop, ");
+    printf("%.2fs\n", secs);
+
+    printf("  requests    %llu completed, %.1f req/s, %.2f MB read\n", (unsigned long long)s.completed,
+           s.completed / secs, s.bytes / 1048576.0);
+    if (opt.rate > 0)
+        printf("  scheduled   %llu, %llu never sent (generator or server fell behind)\n",
+               (unsigned long long)s.scheduled, (unsigned long long)s.backlog);
+    printf("  status      2xx %llu, 3xx %llu, 4xx %llu, 5xx %llu, other %llu\n", (unsigned long long)s.status[2],
+           (unsigned long long)s.status[3], (unsigned long long)s.status[4], (unsigned long long)s.status[5],
+           (unsigned long long)(s.status[0] + s.status[1]));
+    printf("  errors      connect %llu, read %llu, write %llu, closed %llu, timeout %llu\n",
+           (unsigned long long)s.err_connect, (unsigned long long)s.err_read, (unsigned long long)s.err_write,
+           (unsigned long long)s.err_closed, (unsigned long long)s.err_timeout);
+    if (!opt.keep_alive) {
+        printf("  connections %llu established, %.1f conn/s\n", (unsigned long long)s.connects, s.connects / secs);
+        printf("  first byte  min %lluus, mean %.0fus, max %lluus (connect() to first response byte)\n",
+               (unsigned long long)s.first_byte.min(), s.first_byte.mean(), (unsigned long long)s.first_byte.max());
+        printf("             ");
+        for (int i = 0; i < PERCENTILE_COUNT; i++)
+            printf(" %s %lluus", PERCENTILE_NAMES[i], (unsigned long long)s.first_byte.percentile(PERCENTILES[i]));
+        printf("\n");
+    }
+    printf("  latency     min %lluus, mean %.0fus, max %lluus\n", (unsigned long long)s.latency.min(),
+           s.latency.mean(), (unsigned long long)s.latency.max());
+    printf("             ");
+    for (int i = 0; i < PERCENTILE_COUNT; i++)
+        printf(" %s %lluus", PERCENTILE_NAMES[i], (unsigned long long)s.latency.percentile(PERCENTILES[i]));
+    printf("\n");
+
+    if (reqs.size() > 1) {
+        for (size_t i = 0; i < reqs.size(); i++) {
+            const hdr_histogram &h = s.per_request[i];
+            printf("  %-30s %8llu  p50 %lluus  p99 %lluus  max %lluus\n", reqs[i].name.c_str(),
+                   (unsigned long long)s.per_request_count[i], (unsigned long long)h.percentile(50),
+                   (unsigned long long)h.percentile(99), (unsigned long long)h.max());
+        }
+    }
+}
+
+static void json_string(FILE *fp, const std::string &s) {
+    fputc('"', fp);
+    for (char ch : s) {
+        if (ch == '"' || ch == '\\')
+            fputc('\\', fp);
+        fputc(ch, fp);
+    }
+    fputc('"', fp);
+}
+
+static void json_latency(FILE *fp, const hdr_histogram &h) {
+    fprintf(fp, "{\"min\": %llu, \"mean\": %.1f, \"max\": %llu", (unsigned long long)h.min(), h.mean(),
+            (unsigned long long)h.max());
+    for (int i = 0; i < PERCENTILE_COUNT; i++)
+        fprintf(fp, ", \"%s\": %llu", PERCENTILE_NAMES[i], (unsigned long long)h.percentile(PERCENTILES[i]));
+    fprintf(fp, "}");
+}
+
+static bool write_json(const options &opt, const std::vector<request_template> &reqs, const stats &s, double secs) {
+    FILE *fp = opt.json == "-" ? stdout : fopen(opt.json.c_str(), "w");
+    if (!fp) {
+        perror(opt.json.c_str());
+        return false;
+    }
+    fprintf(fp, "{\n  \"config\": {\"host\": ");
+    json_string(fp, opt.host);
+    fprintf(fp, ", \"port\": %d, \"threads\": %d, \"connections\": %d, \"http\": \"%s\", \"keep_alive\": %s, "
+                "\"pipeline\": %d, \"rate\": %.0f, \"duration_s\": %d, \"timeout_ms\": %d},\n",
+            opt.port, opt.threads, opt.connections, opt.http10 ? "1.0" : "1.1", opt.keep_alive ? "true" : "false",
+            opt.keep_alive ? opt.depth : 1, opt.rate, opt.duration, opt.timeout_ms);
+    fprintf(fp, "  \"elapsed_s\": %.3f,\n  \"requests\": %llu,\n  \"rps\": %.1f,\n  \"bytes\": %llu,\n", secs,
+            (unsigned long long)s.completed, s.completed / secs, (unsigned long long)s.bytes);
+    fprintf(fp, "  \"sent\": %llu,\n  \"scheduled\": %llu,\n  \"backlog\": %llu,\n  \"connects\": %llu,\n",
+            (unsigned long long)s.sent, (unsigned long long)s.scheduled, (unsigned long long)s.backlog,
+            (unsigned long long)s.connects);
+    fprintf(fp, "  \"connects_per_sec\": %.1f,\n  \"first_byte_us\": ", s.connects / secs);
+    json_latency(fp, s.first_byte);
+    fprintf(fp, ",\n");
+    fprintf(fp, "  \"status\": {\"2xx\": %llu, \"3xx\": %llu, \"4xx\": %llu, \"5xx\": %llu, \"other\": %llu},\n",
+            (unsigned long long)s.status[2], (unsigned long long)s.status[3], (unsigned long long)s.status[4],
+            (unsigned long long)s.status[5], (unsigned long long)(s.status[0] + s.status[1]));
+    fprintf(fp, "  \"errors\": {\"connect\": %llu, \"read\": %llu, \"write\": %llu, \"closed\": %llu, "
+                "\"timeout\": %llu},\n",
+            (unsigned long long)s.err_connect, (unsigned long long)s.err_read, (unsigned long long)s.err_write,
+            (unsigned long long)s.err_closed, (unsigned long long)s.err_timeout);
+    fprintf(fp, "  \"latency_us\": ");
+    json_latency(fp, s.latency);
+    fprintf(fp, ",\n  \"scenario\": [");
+    for (size_t i = 0; i < reqs.size(); i++) {
+        fprintf(fp, "%s\n    {\"name\": ", i ? "," : "");
+        json_string(fp, reqs[i].name);
+        fprintf(fp, ", \"weight\": %d, \"requests\": %llu, \"latency_us\": ", reqs[i].weight,
+                (unsigned long long)s.per_request_count[i]);
+        json_latency(fp, s.per_request[i]);
+        fprintf(fp, "}");
+    }
+    fprintf(fp, "\n  ]\n}\n");
+    if (fp != stdout)
+        fclose(fp);
+    return true;
+}
+
+// ========== main ==========
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [-a host] [-p port] [-t threads] [-c connections] [-d seconds] [-k 0|1] [-V 1.0|1.1] [-P depth]\n"
+            "          [-R rate] [-s scenario] [-u url] [-T timeout_ms] [-W bytes|body] [-G gap_us] [-H padding]\n"
+            "          [-j json_file|-]\n",
+            prog);
+}
+
+int main(int argc, char *argv[]) {
+    options opt;
+    int ch;
+    while ((ch = getopt(argc, argv, "a:p:t:c:d:k:V:P:R:s:u:T:W:G:H:j:")) != -1) {
+        switch (ch) {
+            case 'a': opt.host = optarg; break;
+            case 'p': opt.port = atoi(optarg); break;
+            case 't': opt.threads = atoi(optarg); break;
+            case 'c': opt.connections = atoi(optarg); break;
+            case 'd': opt.duration = atoi(optarg); break;
+            case 'k': opt.keep_alive = atoi(optarg) != 0; break;
+            case 'V':
+                if (strcmp(optarg, "1.0") != 0 && strcmp(optarg, "1.1") != 0) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                opt.http10 = strcmp(optarg, "1.0") == 0;
+                break;
+            case 'P': opt.depth = atoi(optarg); break;
+            case 'R': opt.rate = atof(optarg); break;
+            case 's': opt.scenario = optarg; break;
+            case 'u': opt.url = optarg; break;
+            case 'T': opt.timeout_ms = atoi(optarg); break;
+            case 'W':
+                if (strcmp(optarg, "body") == 0)
+                    opt.split_body = true;
+                else
+                    opt.write_size = atoi(optarg);
+                break;
+            case 'G': opt.write_gap_us = atoi(optarg); break;
+            case 'H': opt.padding = atoi(optarg); break;
+            case 'j': opt.json = optarg; break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (opt.threads <= 0 || opt.connections <= 0 || opt.duration <= 0 || opt.depth <= 0 || opt.rate < 0 ||
+        opt.timeout_ms <= 0 || opt.write_size < 0 || opt.write_gap_us < 0 || opt.padding < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (opt.connections < opt.threads)
+        opt.threads = opt.connections;
+    // HTTP/1.0 不带 keep-alive，服务器每个响应后关闭连接
+    if (opt.http10)
+        opt.keep_alive = false;
+
+    std::vector<request_template> reqs;
+    if (!opt.scenario.empty()) {
+        if (!load_scenario(opt, &reqs))
+            return 1;
+    } else {
+        request_template tmpl;
+        tmpl.weight = 1;
+        tmpl.name = "GET " + opt.url;
+        tmpl.raw = build_request(opt, "GET", opt.url, "");
+        reqs.push_back(tmpl);
+    }
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(opt.port);
+    if (inet_pton(AF_INET, opt.host.c_str(), &addr.sin_addr) != 1) {
+        struct addrinfo hints, *res = nullptr;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        if (getaddrinfo(opt.host.c_str(), nullptr, &hints, &res) != 0 || !res) {
+            fprintf(stderr, "cannot resolve %s\n", opt.host.c_str());
+            return 1;
+        }
+        addr.sin_addr = ((sockaddr_in *)res->ai_addr)->sin_addr;
+        freeaddrinfo(res);
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    uint64_t start = now_ns();
+    uint64_t end = start + (uint64_t)opt.duration * 1000000000ULL;
+    std::vector<worker *> workers;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < opt.threads; i++) {
+        int conns = opt.connections / opt.threads + (i < opt.connections % opt.threads ? 1 : 0);
+        workers.push_back(new worker(opt, reqs, addr, i, conns, start, end));
+    }
+    for (worker *w : workers)
+        threads.emplace_back([w] { w->run(); });
+    for (std::thread &t : threads)
+        t.join();
+    double secs = (now_ns() - start) / 1e9;
+
+    stats total;
+    total.per_request.resize(reqs.size());
+    total.per_request_count.resize(reqs.size(), 0);
+    for (worker *w : workers) {
+        total.merge(w->result());
+        delete w;
+    }
+
+    if (opt.json != "-")
+        print_text(opt, reqs, total, secs);
+    if (!opt.json.empty() && !write_json(opt, reqs, total, secs))
+        return 1;
+    return 0;
+}
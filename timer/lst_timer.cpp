@@ -1,255 +1,370 @@
 #include "lst_timer.h"
-#include "../http/http_conn.h"
 
 #include <chrono>
 
 // ============ TimingWheel 实现 ============
-TimingWheel::Level1::Level1() : current_slot(0){
-    for (int i = 0; i < SLOTS; i++)
-        slots[i].head = nullptr;
+
+TimingWheel::TimingWheel() 
+    : m_current_tick(0),
+      m_timer_count(0),
+      m_expired(nullptr),
+      m_stats(),
+      m_start_time(0),
+      m_TIMESLOT(1) {
+    // 默认5层×64槽：tick 为1ms时分别覆盖 64ms、4秒、4分钟、4.6小时、12天
+    set_levels({64, 64, 64, 64, 64});
 }
 
-TimingWheel::Level2::Level2() : current_slot(0) {
-    for (int i = 0; i < SLOTS; i++)
-        slots[i].head = nullptr;
+TimingWheel::~TimingWheel() {
 }
 
-TimingWheel::TimingWheel() 
-    : enable_level2(false), 
-      m_TIMESLOT(5),
-      m_min_timeout(15),  // 默认15秒
-      m_max_timeout(25),  // 默认25秒
-      m_rng(std::random_device{}()),
-      m_timeout_dist(m_min_timeout, m_max_timeout) {
+void TimingWheel::set_timeslot(int timeslot_ms, long long now) {
+    if (timeslot_ms > 0) {
+        // 只应在添加定时器之前调用，tick 与时间的换算随之改变
+        m_TIMESLOT = timeslot_ms;
+        m_start_time = now;
+        m_current_tick = 0;
+    }
 }
 
-TimingWheel::~TimingWheel() {
-    // 清理 Level1
-    for (int i = 0; i < Level1::SLOTS; i++) {
-        util_timer* timer = level1.slots[i].head;
-        while (timer) {
-            util_timer* next = timer->next;
-            delete timer;
-            timer = next;
+bool TimingWheel::set_levels(const std::vector<int>& slots_per_level) {
+    if (slots_per_level.empty()) {
+        LOG_WARN("TimingWheel: empty level config ignored");
+        return false;
+    }
+    for (int slots : slots_per_level) {
+        if (slots < 2) {
+            LOG_WARN("TimingWheel: level with %d slots ignored, need at least 2", slots);
+            return false;
         }
     }
 
-    // 清理 Level2
-    if (enable_level2) {
-        for (int i = 0; i < Level2::SLOTS; i++) {
-            util_timer* timer = level2.slots[i].head;
-            while (timer) {
-                util_timer* next = timer->next;
-                delete timer;
-                timer = next;
-            }
+    // 取出已有定时器，按新结构重新放置
+    std::vector<util_timer*> existing;
+    for (auto& level : m_levels) {
+        for (util_timer*& head : level.slots) {
+            for (util_timer* t = head; t; t = t->next)
+                existing.push_back(t);
+            head = nullptr;
         }
     }
+
+    m_levels.clear();
+    m_timer_count = 0;
+    unsigned long long granularity = 1;
+    for (int slots : slots_per_level) {
+        Level level;
+        level.granularity = granularity;
+        level.span = granularity * slots;
+        level.count = 0;
+        level.slots.assign(slots, nullptr);
+        m_levels.push_back(std::move(level));
+        granularity *= slots;
+    }
+
+    for (util_timer* t : existing) {
+        t->prev = t->next = nullptr;
+        place(t, m_current_tick + 1);
+    }
+
+    LOG_INFO("TimingWheel: %lu levels, tick %d ms, capacity %lld ms",
+             m_levels.size(), m_TIMESLOT, get_capacity());
+    return true;
 }
 
-void TimingWheel::set_timeslot(int timeslot) {
-    m_TIMESLOT = timeslot;
+long long TimingWheel::get_capacity() const {
+    return m_levels.empty() ? 0 : (long long)m_levels.back().span * m_TIMESLOT;
 }
 
-void TimingWheel::set_enable_level2(bool enable) {
-    enable_level2 = enable;
-    if (enable) {
-        LOG_INFO("TimingWheel: Level2 enabled (supports up to %d seconds timeout)",
-                 Level1::SLOTS * Level2::SLOTS);
-    } else {
-        LOG_INFO("TimingWheel: Single level mode (supports up to %d seconds timeout)",
-                 Level1::SLOTS);
+void TimingWheel::add_timer(util_timer* timer, long long now) {
+    if (!timer) return;
+    // 空闲很久后的第一个定时器：按过时的当前 tick 放置会落进高层甚至溢出槽，之后还要逐层降级
+    skip_idle(now > m_start_time ? (unsigned long long)(now - m_start_time) / m_TIMESLOT : 0);
+    timer->expire = timer->deadline;
+    place(timer, m_current_tick + 1);
+    m_stats.added++;
+}
+
+bool TimingWheel::set_deadline(util_timer* timer, long long deadline) {
+    if (!timer) return false;
+
+    if (timer->wheel_level >= 0 && deadline >= timer->expire) {
+        timer->deadline = deadline;
+        return false;
     }
+
+    remove_from_slot(timer);
+    timer->deadline = deadline;
+    timer->expire = deadline;
+    place(timer, m_current_tick + 1);
+    m_stats.added++;
+    return true;
 }
 
-void TimingWheel::set_timeout_range(int min_timeout, int max_timeout) {
-    if (min_timeout > 0 && max_timeout > min_timeout) {
-        m_min_timeout = min_timeout;
-        m_max_timeout = max_timeout;
-        m_timeout_dist = std::uniform_int_distribution<int>(min_timeout, max_timeout);
-        LOG_INFO("TimingWheel: timeout range set to [%d, %d] seconds", 
-                 min_timeout, max_timeout);
-    } else {
-        LOG_WARN("Invalid timeout range: min=%d, max=%d", min_timeout, max_timeout);
+void TimingWheel::del_timer(util_timer* timer) {
+    if (!timer || timer->wheel_level == NOT_LINKED) return;
+    remove_from_slot(timer);
+    m_stats.removed++;
+}
+
+// timerfd 可能合并多次到期或被阻塞延后，按实际时间补齐所有 tick
+void TimingWheel::tick(long long now) {
+    auto start = std::chrono::steady_clock::now();
+
+    unsigned long long target = now > m_start_time ? (unsigned long long)(now - m_start_time) / m_TIMESLOT : 0;
+    unsigned long long steps = 0;
+    unsigned long long fired = 0;
+    while (m_current_tick < target) {
+        // 1ms 一个 tick，空闲几小时后逐个走会有上千万个空 tick：直接跳到下一个非空槽的前一个 tick
+        unsigned long long next = next_event_tick();
+        if (next == 0 || next > target) {
+            m_current_tick = target;
+            break;
+        }
+        if (next - 1 > m_current_tick) {
+            m_current_tick = next - 1;
+        }
+        fired += step();
+        steps++;
     }
+
+    auto us = (unsigned long long)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    // 只累加计数，不遍历定时器；汇总输出由调用方决定频率
+    m_stats.advances++;
+    m_stats.steps += steps;
+    m_stats.total_tick_us += us;
+    if (us > m_stats.max_tick_us) m_stats.max_tick_us = us;
+    if (fired > m_stats.max_fired) m_stats.max_fired = fired;
+    m_stats.tick_us_hist[timer_wheel_stats::bucket(us)]++;
+    m_stats.fired_hist[timer_wheel_stats::bucket(fired)]++;
+
+    LOG_DEBUG("TimingWheel tick - steps=%llu, took=%llu us, fired=%llu", steps, us, fired);
 }
 
-int TimingWheel::get_random_timeout() {
-    return m_timeout_dist(m_rng);
+timer_wheel_stats TimingWheel::get_stats() const {
+    timer_wheel_stats stats = m_stats;
+    stats.live_timers = m_timer_count;
+    return stats;
 }
 
-void TimingWheel::add_timer(util_timer* timer) {
-    if (!timer) return;
+void TimingWheel::reset_stats() {
+    m_stats = timer_wheel_stats();
+}
 
-    time_t cur = time(nullptr);
-    int timeout = timer->expire - cur;
+long long TimingWheel::next_expire() const {
+    unsigned long long best = next_event_tick();
+    return best ? m_start_time + (long long)best * m_TIMESLOT : -1;
+}
 
-    if (timeout <= 0) {
-        timeout = 1;  // 至少1秒
+void TimingWheel::skip_idle(unsigned long long target) {
+    if (m_timer_count == 0 && !m_expired && target > m_current_tick) {
+        m_current_tick = target;
     }
+}
 
-    if (timeout < Level1::SLOTS * Level1::GRANULARITY) {
-        // 放入 Level1（当前主要逻辑）
-        add_to_level1(timer, timeout);
+// 每层只看下一个会被处理的非空槽：第0层是槽对应的 tick，高层是该槽降级的 tick
+unsigned long long TimingWheel::next_event_tick() const {
+    if (m_timer_count == 0)
+        return 0;
+
+    unsigned long long best = 0;
+    for (size_t i = 0; i < m_levels.size(); i++) {
+        const Level& lv = m_levels[i];
+        if (lv.count == 0)
+            continue;
+
+        unsigned long long base = m_current_tick / lv.granularity;
+        size_t n = lv.slots.size();
+        for (size_t j = 1; j <= n; j++) {
+            unsigned long long when = (base + j) * lv.granularity;
+            if (best && when >= best)
+                break;
+            if (lv.slots[(base + j) % n]) {
+                best = when;
+                break;
+            }
+        }
     }
-    else if (enable_level2 && timeout < (Level1::SLOTS * Level1::GRANULARITY) + (Level2::SLOTS * Level2::GRANULARITY)){
-        // 【预留】未来启用 Level2 时的逻辑
-        add_to_level2(timer, timeout);
+    return best;
+}
+
+// 到期 tick 向上取整，保证不会早于 expire 触发
+unsigned long long TimingWheel::expire_tick(const util_timer* timer) const {
+    if (timer->expire <= m_start_time)
+        return 0;
+    return ((unsigned long long)(timer->expire - m_start_time) + m_TIMESLOT - 1) / m_TIMESLOT;
+}
+
+// earliest：最早可放入的 tick。外部插入时当前 tick 已处理完，只能放到下一个 tick；
+// 降级发生在处理第0层当前槽之前，到期 tick 恰为当前 tick 的可以放进当前槽
+void TimingWheel::place(util_timer* timer, unsigned long long earliest) {
+    unsigned long long when = expire_tick(timer);
+    if (when < earliest) {
+        when = earliest;  // 已过期的尽快触发
     }
-    else {
-        int slot_idx = (level1.current_slot + Level1::SLOTS - 1) % Level1::SLOTS;
-        insert_to_slot_l1(slot_idx, timer);
-        LOG_WARN("Timer timeout=%d exceeds capacity, placed in last slot", timeout);
+
+    unsigned long long delta = when - m_current_tick;
+    size_t top = m_levels.size() - 1;
+    size_t level = 0;
+    while (level < top && delta >= m_levels[level].span) {
+        level++;
     }
-}
 
-void TimingWheel::adjust_timer(util_timer* timer, time_t new_last_active) {
-    if (!timer) return;
+    if (delta >= m_levels[top].span) {
+        // 超出总跨度：先放在最高层最远的槽，降级时再按真实到期时间放置
+        when = m_current_tick + m_levels[top].span - 1;
+    }
 
-    // 从旧位置移除
-    remove_from_slot(timer);
-    
-    // 更新时间：使用随机超时
-    time_t cur = time(nullptr);
-    int random_timeout = get_random_timeout();
-    timer->expire = cur + random_timeout;
-    timer->last_active = new_last_active;  // 记录活跃时间（用于日志）
-
-    add_timer(timer);
+    const Level& lv = m_levels[level];
+    insert_to_slot((int)level, (int)((when / lv.granularity) % lv.slots.size()), timer);
 }
 
-void TimingWheel::del_timer(util_timer* timer) {
-    if (!timer) return;
-    remove_from_slot(timer);
-    delete timer;
-}
+void TimingWheel::cascade(size_t level) {
+    Level& lv = m_levels[level];
+    int slot_idx = (int)((m_current_tick / lv.granularity) % lv.slots.size());
+    util_timer* timer = lv.slots[slot_idx];
+    lv.slots[slot_idx] = nullptr;
 
-void TimingWheel::tick() {
-    if (enable_level2) {
-        // 【预留】多级时间轮的 tick 逻辑
-        tick_multilevel();
-    } else {
-        // 当前只处理 Level1
-        tick_single_level();
+    while (timer) {
+        util_timer* next = timer->next;
+        timer->prev = timer->next = nullptr;
+        m_timer_count--;
+        lv.count--;
+        m_stats.cascaded++;
+        // 顺带按最新期限续期，省去在低层的无效停留
+        if (timer->deadline > timer->expire) {
+            timer->expire = timer->deadline;
+        }
+        place(timer, m_current_tick);
+        timer = next;
     }
 }
 
-// ============ Level1 实现 ============
+int TimingWheel::step() {
+    m_current_tick++;
 
-void TimingWheel::add_to_level1(util_timer* timer, int timeout) {
-    // Level1 槽位计算：考虑粒度
-    int slots_ahead = timeout / Level1::GRANULARITY;  // timeout / 1
-    int slot_idx = (level1.current_slot + slots_ahead) % Level1::SLOTS;
-    insert_to_slot_l1(slot_idx, timer);
-}
+    // 当前 tick 对齐到第 i 层粒度时降级该层的槽；从高层往低层做，
+    // 高层降下来的定时器可能正好落进本 tick 要降级的低层槽
+    size_t aligned = 0;
+    while (aligned + 1 < m_levels.size() && m_current_tick % m_levels[aligned + 1].granularity == 0) {
+        aligned++;
+    }
+    for (size_t level = aligned; level >= 1; level--) {
+        if (m_levels[level].count)
+            cascade(level);
+    }
 
-void TimingWheel::tick_single_level() {
-    auto start = std::chrono::steady_clock::now();
-    
-    int slot_idx = level1.current_slot;
-    util_timer* timer = level1.slots[slot_idx].head;
-    
-    time_t cur = time(nullptr);
-    std::vector<util_timer*> to_delete;
-    
-    // 遍历当前槽的所有定时器
+    // 第0层当前槽整体摘下：期限已被推后的按新期限重新放置（至少在下一个 tick，不会回到本槽），
+    // 真正到期的挂到到期链表，整批回调
+    Level& lv0 = m_levels[0];
+    util_timer*& head = lv0.slots[m_current_tick % lv0.slots.size()];
+    util_timer* timer = head;
+    head = nullptr;
+    long long now = current_time();
     while (timer) {
         util_timer* next = timer->next;
-        
-        // 去掉懒更新逻辑，直接删除过期的
-        if (timer->expire <= cur) {
-            to_delete.push_back(timer);
+        m_timer_count--;
+        lv0.count--;
+        timer->prev = timer->next = nullptr;
+        timer->wheel_level = NOT_LINKED;
+        if (timer->deadline > now) {
+            timer->expire = timer->deadline;
+            place(timer, m_current_tick + 1);
+            m_stats.rescheduled++;
         } else {
-            // 理论上不应该有未过期的，记录警告
-            LOG_WARN("Unexpired timer in current slot: fd=%d, expire=%ld, cur=%ld",
-                     timer->user_data ? timer->user_data->sockfd : -1, 
-                     timer->expire, cur);
+            timer->next = m_expired;
+            if (m_expired) m_expired->prev = timer;
+            m_expired = timer;
+            timer->wheel_level = EXPIRED_LIST;
         }
-        
         timer = next;
     }
-    
-    // 清空当前槽
-    level1.slots[slot_idx].head = nullptr;
-    
-    // 触发回调并删除
-    for (auto* t : to_delete) {
-        if (t->cb_func) {
-            t->cb_func();  // 调用lambda回调
-        }
-        delete t;
-    }
-    
-    // 推进到下一个槽
-    level1.current_slot = (level1.current_slot + 1) % Level1::SLOTS;
-    
-    //========下面全是日志测试信息
-    auto end = std::chrono::steady_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
-    
-    LOG_DEBUG("tick_single_level - slot=%d, took=%ld us, deleted=%lu",
-              slot_idx, duration.count(), to_delete.size());
-    
-    // 每隔一段时间输出统计
-    static int tick_count = 0;
-    static long total_us = 0;
-    static long max_us = 0;
-    
-    tick_count++;
-    total_us += duration.count();
-    if (duration.count() > max_us) max_us = duration.count();
-    
-    if (tick_count % 10 == 0) {  // 每10次tick输出一次
-        // 统计所有槽的定时器数量
-        int total_timers = 0;
-        for (int i = 0; i < Level1::SLOTS; i++) {
-            util_timer* t = level1.slots[i].head;
-            while (t) {
-                total_timers++;
-                t = t->next;
-            }
+
+    // 逐个摘下再回调：回调可能释放定时器所在的连接，之后不能再访问该节点；
+    // 回调里删除了同批次的其他定时器也能正确摘链
+    int fired = 0;
+    while (m_expired) {
+        util_timer* expired = m_expired;
+        remove_from_slot(expired);
+        fired++;
+        if (expired->cb_func) {
+            expired->cb_func(expired, expired->cb_arg);
         }
-        
-        LOG_INFO("TimingWheel stats - Tick: %d, Avg: %ld us, Max: %ld us, "
-                 "Total timers: %d, Deleted: %lu",
-                 tick_count, total_us / tick_count, max_us,
-                 total_timers, to_delete.size());
     }
+    m_stats.fired += fired;
+    return fired;
 }
 
-void TimingWheel::insert_to_slot_l1(int slot_idx, util_timer* timer) {
-    timer->next = level1.slots[slot_idx].head;
+void TimingWheel::insert_to_slot(int level, int slot_idx, util_timer* timer) {
+    util_timer*& head = m_levels[level].slots[slot_idx];
+    timer->next = head;
     timer->prev = nullptr;
 
-    if (level1.slots[slot_idx].head){
-        level1.slots[slot_idx].head->prev = timer;
+    if (head) {
+        head->prev = timer;
     }
 
-    level1.slots[slot_idx].head = timer;
-    timer->wheel_level = 1;
+    head = timer;
+    m_timer_count++;
+    m_levels[level].count++;
+    timer->wheel_level = level;
     timer->slot_index = slot_idx;
 }
 
 // ============ 时间轮辅助函数 ============
 
+int timer_wheel_stats::bucket(unsigned long long v) {
+    int b = 0;
+    while (v && b < HIST_BUCKETS - 1) {
+        v >>= 1;
+        b++;
+    }
+    return b;
+}
+
+unsigned long long timer_wheel_stats::percentile(const unsigned long long* hist, double q) {
+    unsigned long long total = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) total += hist[i];
+    if (total == 0) return 0;
+
+    unsigned long long rank = (unsigned long long)(q * total);
+    if (rank >= total) rank = total - 1;
+    unsigned long long seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += hist[i];
+        if (seen > rank)
+            return i == 0 ? 0 : (1ULL << i) - 1;
+    }
+    return (1ULL << (HIST_BUCKETS - 1)) - 1;
+}
+
 void TimingWheel::remove_from_slot(util_timer* timer) {
+    if (timer->wheel_level == NOT_LINKED) {
+        return;
+    }
+
     if (timer->prev){
         timer->prev->next = timer->next;
+    } else if (timer->wheel_level == EXPIRED_LIST) {
+        m_expired = timer->next;
     } else {
         // timer 是链表头，需要更新槽的 head
-        if (timer->wheel_level == 1) {
-            level1.slots[timer->slot_index].head = timer->next;
-        } else if (timer->wheel_level == 2) {
-            level2.slots[timer->slot_index].head = timer->next;
-        }
+        m_levels[timer->wheel_level].slots[timer->slot_index] = timer->next;
     }
 
     if (timer->next) {
         timer->next->prev = timer->prev;
     }
 
+    if (timer->wheel_level != EXPIRED_LIST) {
+        m_timer_count--;
+        m_levels[timer->wheel_level].count--;
+    }
     timer->prev = nullptr;
     timer->next = nullptr;
+    timer->wheel_level = NOT_LINKED;
 }
 
 // Utils类已移至utils/utils.h和utils/utils.cpp 
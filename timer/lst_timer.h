@@ -21,113 +21,145 @@
 #include <sys/wait.h>
 #include <sys/uio.h>
 #include <ctime>
-#include <random>
 #include <vector>
 #include <set>
-#include <functional>
 #include "../log/log.h"
 
+struct client_data;
 class util_timer;
 
-struct client_data{
-    sockaddr_in address;
-    int sockfd;         // 为什么还要保存fd，是因为这个对象也许不是通过fd下标访问的，可能是定时器的指针访问到的
-    util_timer *timer;  // 指向定时器是为了通过fd管理到这个客户端的定时器
-};
+// 到期回调：普通函数指针 + 参数，触发时不经过 std::function，回调里可以释放定时器所在的对象
+typedef void (*timer_callback)(util_timer *timer, void *arg);
 
+// 侵入式定时器节点，嵌在连接对象中，由连接管理生命周期，时间轮只负责链入/摘除
+// 时间单位为毫秒，与传给 TimingWheel::tick 的时钟同一基准（SubReactor 用单调时钟）
 class util_timer{
 public:
-    util_timer() : expire(0), last_active(0), cb_func(nullptr), user_data(nullptr),
-                    prev(nullptr), next(nullptr), wheel_level(0), slot_index(0) {}
+    util_timer() : expire(0), deadline(0), cb_func(nullptr), cb_arg(nullptr), user_data(nullptr),
+                    prev(nullptr), next(nullptr), wheel_level(-1), slot_index(0) {}
+    util_timer(const util_timer&) = delete;
+    util_timer& operator=(const util_timer&) = delete;
 
 public:
-    time_t expire;
-    time_t last_active; // 最近活跃时间
+    long long expire;   // 在时间轮中挂的位置
+    long long deadline; // 实际到期时间；晚于 expire 时，时间轮走到该定时器再按它重新放置（惰性续期）
 
-    // 使用std::function支持完整的回调逻辑
-    std::function<void()> cb_func;
+    timer_callback cb_func;
+    void *cb_arg;
     client_data *user_data;    // 以便定时器需要销毁的时候顺便清理该连接
 
     // 时间轮专用字段
     util_timer* prev;      // 链表前驱
     util_timer* next;      // 链表后继
-    int wheel_level;       // 所在层级（1或2）
+    int wheel_level;       // 所在层级（从0开始，-1 表示不在时间轮中）
     int slot_index;        // 所在槽索引
 
 };
 
-// 多级时间轮
+// 连接所处阶段，决定使用哪个期限
+enum CONN_PHASE {
+    CONN_HEADER = 0,    // 读取请求头：从进入阶段起的绝对期限，零星到达的数据不续期（防 slowloris）
+    CONN_BODY,          // 读取请求体：同上
+    CONN_WRITE,         // 生成/发送响应：每次写出进展续期，对端不读时按停滞回收
+    CONN_IDLE           // 长连接等待下一个请求
+};
+
+// 各阶段期限（毫秒）
+struct conn_deadlines {
+    int header_ms;
+    int body_ms;
+    int write_ms;
+    int idle_ms;
+};
+
+struct client_data{
+    sockaddr_in address;
+    int sockfd;         // 为什么还要保存fd，是因为这个对象也许不是通过fd下标访问的，可能是定时器的指针访问到的
+    CONN_PHASE phase;   // 当前阶段
+    util_timer timer;   // 定时器节点嵌在连接对象里，建立连接和超时关闭都不为定时器分配内存
+};
+
+// 时间轮统计，由所属线程在插入/删除/推进时顺带维护，读取不扫描槽
+// “一次推进”指一次 tick(now) 调用（通常对应一次 timerfd 唤醒），可能包含多个 tick
+struct timer_wheel_stats {
+    static const int HIST_BUCKETS = 16;   // 按 2 的幂分桶：桶 0 为 0，桶 i 为 [2^(i-1), 2^i)，最后一桶不封顶
+
+    size_t live_timers;                   // 当前在时间轮中的定时器数
+    unsigned long long added;             // 插入次数（含期限提前导致的重新挂链）
+    unsigned long long removed;           // 主动删除次数
+    unsigned long long fired;             // 到期回调次数
+    unsigned long long rescheduled;       // 走到槽时发现期限已推后、惰性重新放置的次数
+    unsigned long long cascaded;          // 高层降级搬动的定时器数
+    unsigned long long advances;          // 推进次数
+    unsigned long long steps;             // 处理的 tick 数（没有定时器的 tick 直接跳过，不计入）
+    unsigned long long total_tick_us;     // 推进总耗时
+    unsigned long long max_tick_us;       // 单次推进最长耗时
+    unsigned long long max_fired;         // 单次推进最多到期数
+    unsigned long long tick_us_hist[HIST_BUCKETS];   // 单次推进耗时分布（微秒）
+    unsigned long long fired_hist[HIST_BUCKETS];     // 单次推进到期数分布
+
+    static int bucket(unsigned long long v);
+    // 分布的近似分位数（返回所在桶的上界）
+    static unsigned long long percentile(const unsigned long long* hist, double q);
+};
+
+// 分层时间轮（不持有定时器，析构时也不释放）
+// 第0层每槽一个 tick，第 i 层每槽跨度为下面各层槽数之积；到期时间按 tick 绝对值记录，
+// 高层槽在对齐时整体降级（cascade）到低层，插入/删除都是 O(1)
+// 超出最高层范围的定时器先放在最高层最远的槽，降级时按真实到期时间重新放置
 class TimingWheel {
 public:
     TimingWheel();
     ~TimingWheel();
     
     // 基本操作
-    void add_timer(util_timer* timer);
-    void adjust_timer(util_timer* timer, time_t new_last_active);
-    void del_timer(util_timer* timer);
-    void tick();
+    // 按 timer->deadline 放入；now 为当前时间，时间轮为空时当前 tick 直接拨到 now，不补走空闲期间的 tick
+    void add_timer(util_timer* timer, long long now);
+    // 修改期限：不早于当前挂的位置时只记录（一次写入，不动链表），更早时重新挂链
+    // 返回 true 表示已重新挂链，调用方可能需要提前唤醒
+    bool set_deadline(util_timer* timer, long long deadline);
+    void del_timer(util_timer* timer);     // 只摘除，不释放（节点属于连接对象）
+    void tick(long long now);              // 推进到 now，只处理期间有定时器的槽，空的 tick 直接跳过
+    // 下一次需要推进的时间（最近的非空槽），时间轮为空返回 -1；用于把 timerfd 设到下一个期限
+    long long next_expire() const;
     
     // 配置
-    void set_timeslot(int timeslot);
-    void set_enable_level2(bool enable);  // 启用/禁用第二层（未来扩展）
-
-    // 随机超时时间配置
-    void set_timeout_range(int min_timeout, int max_timeout);
-    int get_random_timeout();  // 获取随机超时时间（min~max 范围）
+    void set_timeslot(int timeslot_ms, long long now);   // now 为 tick 0 对应的时间
+    // 每层槽数（自底向上），每层至少2个槽；已有定时器会按新结构重新放置
+    bool set_levels(const std::vector<int>& slots_per_level);
+    int get_level_count() const { return (int)m_levels.size(); }
+    long long get_capacity() const;     // 不经过溢出重排能直接覆盖的毫秒数
+    size_t get_timer_count() const { return m_timer_count; }
+    timer_wheel_stats get_stats() const;   // O(1) 快照，不扫描槽
+    void reset_stats();                    // 清零累计值
+    long long current_time() const { return m_start_time + (long long)m_current_tick * m_TIMESLOT; }
 
 private:
-    // ============ 第一层：实际使用（秒级粒度）============
-    struct Level1 {
-        static constexpr int SLOTS = 32;      // 32个槽
-        static constexpr int GRANULARITY = 1; // 1秒粒度
-        
-        struct Slot {
-            util_timer* head;  // 链表头
-            Slot() : head(nullptr) {}
-        };
-        
-        Slot slots[SLOTS];
-        int current_slot;
-        
-        Level1();
-    } level1;
-    
-    // ============ 第二层：预留扩展（32秒粒度）============
-    struct Level2 {
-        static constexpr int SLOTS = 8;        // 8个槽
-        static constexpr int GRANULARITY = 32; // 32秒粒度
-        
-        struct Slot {
-            util_timer* head;
-            Slot() : head(nullptr) {}
-        };
-        
-        Slot slots[SLOTS];
-        int current_slot;
-        
-        Level2();
-    } level2;
-    
-    bool enable_level2;  // 是否启用第二层
-    int m_TIMESLOT;      // tick 间隔（秒）
-    int m_min_timeout;      // 最小超时时间（秒）
-    int m_max_timeout;      // 最大超时时间（秒）
-
-    // 随机数生成器
-    std::mt19937 m_rng;
-    std::uniform_int_distribution<int> m_timeout_dist;
+    static constexpr int NOT_LINKED = -1;     // wheel_level：不在时间轮中
+    static constexpr int EXPIRED_LIST = -2;   // wheel_level：在本 tick 的到期链表中
+
+    struct Level {
+        unsigned long long granularity;   // 每槽跨度（tick）
+        unsigned long long span;          // 整层跨度（tick）
+        size_t count;                     // 本层定时器数，找下一个期限时跳过空层
+        std::vector<util_timer*> slots;   // 每槽一条双向链表
+    };
+
+    std::vector<Level> m_levels;
+    unsigned long long m_current_tick;  // 已处理到的 tick
+    size_t m_timer_count;               // 时间轮中的定时器数，避免统计时扫描所有槽
+    util_timer* m_expired;              // 本 tick 待回调的到期链表（侵入式，不分配内存）
+    timer_wheel_stats m_stats;          // 累计统计，只由所属线程读写
+    long long m_start_time;             // tick 0 对应的时间
+    int m_TIMESLOT;                     // tick 间隔（毫秒）
     
-    // Level1 实际实现
-    void add_to_level1(util_timer* timer, int timeout);
-    void tick_single_level();
-    void insert_to_slot_l1(int slot_idx, util_timer* timer);
-
-    // Level2 预留接口（暂不实现）
-    void add_to_level2(util_timer* timer, int timeout) {}
-    void tick_multilevel() {}
-    void demote_from_level2() {}
-    void insert_to_slot_l2(int slot_idx, util_timer* timer) {}
+    unsigned long long expire_tick(const util_timer* timer) const;
+    unsigned long long next_event_tick() const;  // 下一个要处理的非空槽（第0层到期或高层降级）的 tick，空时为 0
+    void skip_idle(unsigned long long target);    // 时间轮为空时把当前 tick 直接移到 target
+    void place(util_timer* timer, unsigned long long earliest);  // 按 expire 放入合适的层和槽
+    void cascade(size_t level);             // 当前 tick 对应的高层槽降级
+    int step();                             // 推进一个 tick，返回触发的定时器数
+    void insert_to_slot(int level, int slot_idx, util_timer* timer);
 
     // 辅助函数
     void remove_from_slot(util_timer* timer);
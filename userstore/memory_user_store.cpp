@@ -0,0 +1,19 @@
+#include "memory_user_store.h"
+
+#include <mutex>
+
+bool MemoryUserStore::verify(const char *name, const char *password) {
+    std::shared_lock<std::shared_timed_mutex> lock(m_rwlock);
+    auto it = m_users.find(name);
+    return it != m_users.end() && it->second == password;
+}
+
+bool MemoryUserStore::exists(const char *name) {
+    std::shared_lock<std::shared_timed_mutex> lock(m_rwlock);
+    return m_users.count(name) != 0;
+}
+
+bool MemoryUserStore::add_user(const char *name, const char *password) {
+    std::unique_lock<std::shared_timed_mutex> lock(m_rwlock);
+    return m_users.emplace(name, password).second;
+}
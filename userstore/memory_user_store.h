@@ -0,0 +1,27 @@
+#ifndef MEMORY_USER_STORE_H
+#define MEMORY_USER_STORE_H
+
+#include <string>
+#include <unordered_map>
+#include <shared_mutex>
+#include "user_store.h"
+
+// 纯内存后端：不落盘、不依赖数据库，供基准测试和连接测试台使用
+// 读多写少，校验走共享锁
+class MemoryUserStore : public UserStore {
+public:
+    MemoryUserStore() {}
+
+    bool init() override { return true; }
+    bool verify(const char *name, const char *password) override;
+    bool exists(const char *name) override;
+    bool add_user(const char *name, const char *password) override;
+
+    const char *backend_name() const override { return "memory"; }
+
+private:
+    std::unordered_map<std::string, std::string> m_users;
+    std::shared_timed_mutex m_rwlock;
+};
+
+#endif
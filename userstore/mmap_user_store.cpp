@@ -0,0 +1,479 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <chrono>
+#include "mmap_user_store.h"
+#include "../log/log.h"
+
+MmapUserStore::MmapUserStore(const std::string &path, bool sync_wal)
+    : m_path(path), m_wal_path(path + ".wal"), m_old_wal_path(path + ".wal.old"), m_sync_wal(sync_wal),
+      m_fd(-1), m_wal_fd(-1), m_base(nullptr), m_map_size(0),
+      m_header(nullptr), m_slots(nullptr), m_wal_records(0), m_wal_committing(false),
+      m_old_wal_pending(false), m_checkpoint_stop(false) { }
+
+MmapUserStore::~MmapUserStore() {
+    if (m_checkpoint_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_checkpoint_mutex);
+            m_checkpoint_stop = true;
+        }
+        m_checkpoint_cond.notify_one();
+        m_checkpoint_thread.join();
+    }
+    if (m_base) {
+        checkpoint();
+    }
+    unmap_table();
+    if (m_wal_fd != -1) close(m_wal_fd);
+}
+
+// FNV-1a
+uint32_t MmapUserStore::hash_name(const char *name) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h ? h : 1;
+}
+
+uint32_t MmapUserStore::checksum(const WalRecord &rec) {
+    uint32_t h = 2166136261u;
+    const unsigned char *p = (const unsigned char *)rec.name;
+    for (size_t i = 0; i < NAME_LEN + PASSWD_LEN; i++) {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+bool MmapUserStore::create_table(const std::string &path, uint64_t capacity, int *fd, char **base) {
+    *fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (*fd < 0) {
+        LOG_ERROR("User store: create %s failed: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    size_t size = table_size(capacity);
+    if (ftruncate(*fd, size) < 0) {
+        LOG_ERROR("User store: ftruncate %s failed: %s", path.c_str(), strerror(errno));
+        close(*fd);
+        return false;
+    }
+    *base = (char *)mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
+    if (*base == MAP_FAILED) {
+        LOG_ERROR("User store: mmap %s failed: %s", path.c_str(), strerror(errno));
+        close(*fd);
+        return false;
+    }
+
+    // ftruncate 出来的文件全零，只需写表头
+    Header *header = (Header *)*base;
+    header->magic = TABLE_MAGIC;
+    header->version = VERSION;
+    header->capacity = capacity;
+    header->count = 0;
+    return true;
+}
+
+void MmapUserStore::unmap_table() {
+    if (m_base) {
+        munmap(m_base, m_map_size);
+        m_base = nullptr;
+    }
+    if (m_fd != -1) {
+        close(m_fd);
+        m_fd = -1;
+    }
+    m_header = nullptr;
+    m_slots = nullptr;
+}
+
+bool MmapUserStore::open_table() {
+    struct stat st;
+    if (stat(m_path.c_str(), &st) < 0) {
+        if (!create_table(m_path, INITIAL_CAPACITY, &m_fd, &m_base))
+            return false;
+        m_map_size = table_size(INITIAL_CAPACITY);
+    } else {
+        m_fd = open(m_path.c_str(), O_RDWR | O_CLOEXEC);
+        if (m_fd < 0 || (size_t)st.st_size < sizeof(Header)) {
+            LOG_ERROR("User store: cannot open %s", m_path.c_str());
+            return false;
+        }
+        m_base = (char *)mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+        if (m_base == MAP_FAILED) {
+            LOG_ERROR("User store: mmap %s failed: %s", m_path.c_str(), strerror(errno));
+            m_base = nullptr;
+            return false;
+        }
+        m_map_size = st.st_size;
+
+        // 表文件损坏时拒绝启动，不覆盖用户数据
+        Header *header = (Header *)m_base;
+        if (header->magic != TABLE_MAGIC || header->version != VERSION ||
+            header->capacity == 0 || (header->capacity & (header->capacity - 1)) != 0 ||
+            table_size(header->capacity) != m_map_size) {
+            LOG_ERROR("User store: %s is not a valid user table", m_path.c_str());
+            unmap_table();
+            return false;
+        }
+    }
+
+    m_header = (Header *)m_base;
+    m_slots = (Slot *)(m_base + sizeof(Header));
+    return true;
+}
+
+bool MmapUserStore::init() {
+    std::unique_lock<std::shared_timed_mutex> lock(m_rwlock);
+
+    if (!open_table())
+        return false;
+
+    m_wal_fd = open(m_wal_path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (m_wal_fd < 0) {
+        LOG_ERROR("User store: open %s failed: %s", m_wal_path.c_str(), strerror(errno));
+        return false;
+    }
+
+    // 上次运行轮转出去但没来得及 checkpoint 的WAL先重放，它的记录都早于当前WAL
+    int old_fd = open(m_old_wal_path.c_str(), O_RDWR | O_CLOEXEC);
+    if (old_fd >= 0) {
+        int old_records;
+        bool ok = replay_wal(old_fd, &old_records);
+        close(old_fd);
+        if (!ok)
+            return false;
+    }
+
+    if (!replay_wal(m_wal_fd, &m_wal_records))
+        return false;
+
+    if (old_fd >= 0 && sync_table()) {
+        unlink(m_old_wal_path.c_str());
+    }
+
+    m_checkpoint_thread = std::thread(&MmapUserStore::checkpoint_loop, this);
+
+    LOG_INFO("User store: %s loaded, %lu users, capacity %lu",
+             m_path.c_str(), (unsigned long)m_header->count, (unsigned long)m_header->capacity);
+    return true;
+}
+
+// 重放WAL：插入幂等，已落表的记录重放无副作用；遇到不完整或校验失败的尾部即截断
+bool MmapUserStore::replay_wal(int fd, int *records) {
+    WalRecord rec;
+    off_t valid = 0;
+    int replayed = 0;
+
+    while (pread(fd, &rec, sizeof(rec), valid) == (ssize_t)sizeof(rec)) {
+        if (rec.magic != WAL_MAGIC || rec.checksum != checksum(rec)) {
+            break;
+        }
+        rec.name[NAME_LEN - 1] = '\0';
+        rec.passwd[PASSWD_LEN - 1] = '\0';
+        if (!find_slot(m_slots, m_header->capacity, rec.name, hash_name(rec.name))->used) {
+            if (!insert_slot(rec.name, rec.passwd))
+                return false;
+            replayed++;
+        }
+        valid += sizeof(rec);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size != valid) {
+        LOG_WARN("User store: truncating torn WAL tail (%ld -> %ld bytes)", (long)st.st_size, (long)valid);
+        if (ftruncate(fd, valid) < 0)
+            return false;
+    }
+
+    if (replayed > 0) {
+        LOG_INFO("User store: recovered %d users from WAL", replayed);
+    }
+    *records = valid / sizeof(rec);
+    return true;
+}
+
+MmapUserStore::Slot *MmapUserStore::find_slot(Slot *slots, uint64_t capacity, const char *name, uint32_t hash) {
+    uint64_t mask = capacity - 1;
+    uint64_t idx = hash & mask;
+    while (slots[idx].used) {
+        if (slots[idx].hash == hash && strncmp(slots[idx].name, name, NAME_LEN) == 0) {
+            return &slots[idx];
+        }
+        idx = (idx + 1) & mask;
+    }
+    return &slots[idx];
+}
+
+// 调用方持写锁
+bool MmapUserStore::insert_slot(const char *name, const char *password) {
+    // 负载因子超过0.7时扩容
+    if ((m_header->count + 1) * 10 > m_header->capacity * 7 && !grow()) {
+        return false;
+    }
+
+    uint32_t hash = hash_name(name);
+    Slot *slot = find_slot(m_slots, m_header->capacity, name, hash);
+    if (slot->used) {
+        return false;
+    }
+
+    strncpy(slot->name, name, NAME_LEN - 1);
+    strncpy(slot->passwd, password, PASSWD_LEN - 1);
+    slot->hash = hash;
+    slot->used = 1;     // 最后置位，内容写完才可见
+    m_header->count++;
+    return true;
+}
+
+// 容量翻倍：写到临时文件，刷盘后 rename 原子替换
+bool MmapUserStore::grow() {
+    uint64_t new_capacity = m_header->capacity * 2;
+    std::string tmp_path = m_path + ".tmp";
+
+    int new_fd;
+    char *new_base;
+    if (!create_table(tmp_path, new_capacity, &new_fd, &new_base)) {
+        return false;
+    }
+
+    Header *new_header = (Header *)new_base;
+    Slot *new_slots = (Slot *)(new_base + sizeof(Header));
+    for (uint64_t i = 0; i < m_header->capacity; i++) {
+        if (!m_slots[i].used)
+            continue;
+        Slot *slot = find_slot(new_slots, new_capacity, m_slots[i].name, m_slots[i].hash);
+        *slot = m_slots[i];
+        new_header->count++;
+    }
+
+    size_t new_size = table_size(new_capacity);
+    if (msync(new_base, new_size, MS_SYNC) < 0 || rename(tmp_path.c_str(), m_path.c_str()) < 0) {
+        LOG_ERROR("User store: grow to %lu failed: %s", (unsigned long)new_capacity, strerror(errno));
+        munmap(new_base, new_size);
+        close(new_fd);
+        unlink(tmp_path.c_str());
+        return false;
+    }
+
+    // 后台 checkpoint 可能正在 msync 旧映射
+    std::lock_guard<std::mutex> lock(m_map_mutex);
+    unmap_table();
+    m_fd = new_fd;
+    m_base = new_base;
+    m_map_size = new_size;
+    m_header = new_header;
+    m_slots = new_slots;
+
+    LOG_INFO("User store: table grown to capacity %lu", (unsigned long)new_capacity);
+    return true;
+}
+
+// 一批记录拼成一次 write、一次 fdatasync；只由提交者调用，不持表锁
+bool MmapUserStore::append_wal(const std::vector<wal_request *> &batch) {
+    m_wal_buf.clear();
+    for (const wal_request *req : batch)
+        m_wal_buf.push_back(req->rec);
+
+    size_t len = m_wal_buf.size() * sizeof(WalRecord);
+    if (::write(m_wal_fd, m_wal_buf.data(), len) != (ssize_t)len) {
+        LOG_ERROR("User store: WAL append failed: %s", strerror(errno));
+        // 写了一半的批次截掉，否则重放停在这里，后面成功的记录也找不回来
+        if (ftruncate(m_wal_fd, (off_t)m_wal_records * sizeof(WalRecord)) < 0) {
+            LOG_ERROR("User store: WAL truncate failed: %s", strerror(errno));
+        }
+        return false;
+    }
+    if (m_sync_wal && fdatasync(m_wal_fd) < 0) {
+        LOG_ERROR("User store: WAL fdatasync failed: %s", strerror(errno));
+        return false;
+    }
+    m_wal_records += batch.size();
+    return true;
+}
+
+// 提交 m_wal_batch：WAL 落盘后再短暂持写锁写表，WAL 满了就轮转
+void MmapUserStore::commit_batch() {
+    bool durable = append_wal(m_wal_batch);
+    {
+        std::unique_lock<std::shared_timed_mutex> lock(m_rwlock);
+        for (wal_request *req : m_wal_batch)
+            req->ok = durable && insert_slot(req->rec.name, req->rec.passwd);
+    }
+
+    if (m_wal_records >= CHECKPOINT_RECORDS) {
+        rotate_wal();
+    }
+}
+
+// 调用方持 m_wal_mutex
+bool MmapUserStore::is_queued(const char *name) const {
+    for (const wal_request *req : m_wal_queue) {
+        if (strncmp(req->rec.name, name, NAME_LEN) == 0)
+            return true;
+    }
+    for (const wal_request *req : m_wal_batch) {
+        if (strncmp(req->rec.name, name, NAME_LEN) == 0)
+            return true;
+    }
+    return false;
+}
+
+// 当前WAL改名为 .old 交给后台线程，后续记录写新WAL；.old 里的记录此时都已写进表
+void MmapUserStore::rotate_wal() {
+    {
+        std::lock_guard<std::mutex> lock(m_checkpoint_mutex);
+        if (m_old_wal_pending)
+            return;     // 上一个 .old 还没 checkpoint 完，继续写当前WAL
+    }
+
+    if (rename(m_wal_path.c_str(), m_old_wal_path.c_str()) < 0) {
+        LOG_ERROR("User store: rotate WAL failed: %s", strerror(errno));
+        return;
+    }
+    int fd = open(m_wal_path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        LOG_ERROR("User store: open %s failed: %s", m_wal_path.c_str(), strerror(errno));
+        rename(m_old_wal_path.c_str(), m_wal_path.c_str());
+        return;
+    }
+
+    // 改名和新文件的目录项要先落盘，否则崩溃后新WAL里已确认的注册可能找不回来
+    if (m_sync_wal) {
+        size_t slash = m_path.rfind('/');
+        std::string dir = slash == std::string::npos ? "." : m_path.substr(0, slash + 1);
+        int dir_fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dir_fd < 0 || fsync(dir_fd) < 0) {
+            LOG_ERROR("User store: fsync %s failed: %s", dir.c_str(), strerror(errno));
+        }
+        if (dir_fd >= 0)
+            close(dir_fd);
+    }
+
+    close(m_wal_fd);
+    m_wal_fd = fd;
+    m_wal_records = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(m_checkpoint_mutex);
+        m_old_wal_pending = true;
+    }
+    m_checkpoint_cond.notify_one();
+}
+
+bool MmapUserStore::sync_table() {
+    std::lock_guard<std::mutex> lock(m_map_mutex);
+    if (!m_base)
+        return false;
+    if (msync(m_base, m_map_size, MS_SYNC) < 0) {
+        LOG_ERROR("User store: msync failed: %s", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+// 后台 checkpoint：表刷盘后删除 .old；不持表锁，刷盘期间注册和查询照常进行
+void MmapUserStore::checkpoint_loop() {
+    std::unique_lock<std::mutex> lock(m_checkpoint_mutex);
+    while (true) {
+        m_checkpoint_cond.wait(lock, [this] { return m_checkpoint_stop || m_old_wal_pending; });
+        if (m_checkpoint_stop)
+            break;
+
+        lock.unlock();
+        bool synced = sync_table();
+        if (synced) {
+            // 若在此之前崩溃，重启时重放 .old 也只是重复插入
+            unlink(m_old_wal_path.c_str());
+        }
+        lock.lock();
+
+        if (synced) {
+            m_old_wal_pending = false;
+        } else {
+            // 刷盘失败，稍后重试
+            m_checkpoint_cond.wait_for(lock, std::chrono::seconds(1), [this] { return m_checkpoint_stop; });
+        }
+    }
+}
+
+void MmapUserStore::checkpoint() {
+    if (!m_base || m_wal_fd < 0)
+        return;
+    if (!sync_table())
+        return;
+    // 表已落盘，WAL可以清空；若在此之前崩溃，重启时重放也只是重复插入
+    unlink(m_old_wal_path.c_str());
+    if (ftruncate(m_wal_fd, 0) == 0) {
+        m_wal_records = 0;
+    }
+}
+
+bool MmapUserStore::verify(const char *name, const char *password) {
+    std::shared_lock<std::shared_timed_mutex> lock(m_rwlock);
+    if (!m_slots)
+        return false;
+    Slot *slot = find_slot(m_slots, m_header->capacity, name, hash_name(name));
+    return slot->used && strncmp(slot->passwd, password, PASSWD_LEN) == 0;
+}
+
+bool MmapUserStore::exists(const char *name) {
+    std::shared_lock<std::shared_timed_mutex> lock(m_rwlock);
+    if (!m_slots)
+        return false;
+    return find_slot(m_slots, m_header->capacity, name, hash_name(name))->used != 0;
+}
+
+bool MmapUserStore::add_user(const char *name, const char *password) {
+    if (!name[0] || strlen(name) >= (size_t)NAME_LEN || strlen(password) >= (size_t)PASSWD_LEN) {
+        return false;
+    }
+
+    wal_request req;
+    memset(&req.rec, 0, sizeof(req.rec));
+    req.rec.magic = WAL_MAGIC;
+    strncpy(req.rec.name, name, NAME_LEN - 1);
+    strncpy(req.rec.passwd, password, PASSWD_LEN - 1);
+    req.rec.checksum = checksum(req.rec);
+    req.ok = false;
+    req.done = false;
+
+    std::unique_lock<std::mutex> lock(m_wal_mutex);
+    {
+        // 查重包括已在表里的和排队/提交中的同名注册，保证WAL里不会出现重复用户
+        std::shared_lock<std::shared_timed_mutex> table_lock(m_rwlock);
+        if (!m_slots || find_slot(m_slots, m_header->capacity, name, hash_name(name))->used) {
+            return false;
+        }
+    }
+    if (is_queued(name)) {
+        return false;
+    }
+    m_wal_queue.push_back(&req);
+
+    // 组提交：没人在提交时本线程带走整个队列，否则等当前提交结束再看自己是否已完成
+    while (!req.done) {
+        if (m_wal_committing) {
+            m_wal_cond.wait(lock);
+            continue;
+        }
+        m_wal_committing = true;
+        m_wal_batch.swap(m_wal_queue);
+        lock.unlock();
+
+        commit_batch();
+
+        lock.lock();
+        for (wal_request *committed : m_wal_batch)
+            committed->done = true;
+        m_wal_batch.clear();
+        m_wal_committing = false;
+        m_wal_cond.notify_all();
+    }
+    return req.ok;
+}
@@ -0,0 +1,125 @@
+#ifndef MMAP_USER_STORE_H
+#define MMAP_USER_STORE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <condition_variable>
+#include "user_store.h"
+
+// 嵌入式后端：mmap 的磁盘哈希表 + 追加写 WAL，不依赖数据库服务
+//
+// 表文件：Header + Slot[capacity]，开放寻址（线性探测），只增不删
+// 注册时先追加 WAL 再写表；并发注册组提交：一个线程带着队列里的所有记录写一次 WAL、刷一次盘，
+// 磁盘 IO 不持表锁，写表时才短暂持写锁
+// WAL 累积到一定条数后轮转为 .old，由后台线程 msync 表后删除，注册和查询都不等 checkpoint
+// 重启时依次重放 .old 和 WAL（插入是幂等的），尾部不完整的记录直接截断
+class MmapUserStore : public UserStore {
+public:
+    explicit MmapUserStore(const std::string &path, bool sync_wal = true);
+    ~MmapUserStore();
+
+    bool init() override;
+    bool verify(const char *name, const char *password) override;
+    bool exists(const char *name) override;
+    bool add_user(const char *name, const char *password) override;
+
+    const char *backend_name() const override { return "mmap"; }
+
+    // 表刷盘后清空WAL（同步执行，没有并发注册时调用，如析构）
+    void checkpoint();
+
+    static const int NAME_LEN = 56;
+    static const int PASSWD_LEN = 64;
+
+private:
+    static const uint32_t TABLE_MAGIC = 0x53554d4d;   // "MMUS"
+    static const uint32_t WAL_MAGIC = 0x4c41574d;     // "MWAL"
+    static const uint32_t VERSION = 1;
+    static const uint64_t INITIAL_CAPACITY = 1024;    // 必须是2的幂
+    static const int CHECKPOINT_RECORDS = 1024;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t capacity;
+        uint64_t count;
+        char reserved[40];
+    };
+
+    struct Slot {
+        uint32_t hash;
+        uint32_t used;
+        char name[NAME_LEN];
+        char passwd[PASSWD_LEN];
+    };
+
+    struct WalRecord {
+        uint32_t magic;
+        uint32_t checksum;
+        char name[NAME_LEN];
+        char passwd[PASSWD_LEN];
+    };
+
+    // 排队等待组提交的注册，栈上分配，由提交者填 ok 后置 done
+    struct wal_request {
+        WalRecord rec;
+        bool ok;
+        bool done;
+    };
+
+    bool open_table();
+    bool create_table(const std::string &path, uint64_t capacity, int *fd, char **base);
+    void unmap_table();
+    bool grow();
+    bool replay_wal(int fd, int *records);
+    bool append_wal(const std::vector<wal_request *> &batch);
+    void commit_batch();
+    bool is_queued(const char *name) const;
+    void rotate_wal();
+    bool sync_table();
+    void checkpoint_loop();
+
+    Slot *find_slot(Slot *slots, uint64_t capacity, const char *name, uint32_t hash);
+    bool insert_slot(const char *name, const char *password);
+
+    static size_t table_size(uint64_t capacity) { return sizeof(Header) + capacity * sizeof(Slot); }
+    static uint32_t hash_name(const char *name);
+    static uint32_t checksum(const WalRecord &rec);
+
+    std::string m_path;
+    std::string m_wal_path;
+    std::string m_old_wal_path;  // 轮转出去、等待后台 checkpoint 的WAL
+    bool m_sync_wal;             // 每条WAL是否 fdatasync
+
+    int m_fd;
+    int m_wal_fd;
+    char *m_base;
+    size_t m_map_size;
+    Header *m_header;
+    Slot *m_slots;
+    int m_wal_records;           // 当前WAL的条数，只由提交者和 init/析构访问
+
+    std::shared_timed_mutex m_rwlock;    // 保护表内容
+
+    // ========== 组提交 ==========
+    std::mutex m_wal_mutex;
+    std::condition_variable m_wal_cond;
+    std::vector<wal_request *> m_wal_queue;   // 等待下一次提交
+    std::vector<wal_request *> m_wal_batch;   // 正在提交（写WAL/写表）
+    std::vector<WalRecord> m_wal_buf;         // 一批记录拼成一次 write
+    bool m_wal_committing;                    // 是否已有线程在提交
+
+    // ========== 后台 checkpoint ==========
+    std::mutex m_map_mutex;                   // msync 与扩容换映射互斥
+    std::mutex m_checkpoint_mutex;
+    std::condition_variable m_checkpoint_cond;
+    std::thread m_checkpoint_thread;
+    bool m_old_wal_pending;                   // .old 已生成，表还没刷盘
+    bool m_checkpoint_stop;
+};
+
+#endif
@@ -0,0 +1,136 @@
+#include <mysql/mysql.h>
+#include <stdio.h>
+#include <ctype.h>
+#include "mysql_user_store.h"
+#include "../metrics/trace.h"
+
+MysqlUserStore::MysqlUserStore(connection_pool *connPool) : m_connPool(connPool) { }
+
+// 从数据库加载用户信息
+bool MysqlUserStore::init() {
+    // 从连接池获取一个连接
+    ConnectionGuard connGuard(*m_connPool);
+    MYSQL* mysql = connGuard.get();
+    if (!mysql) {
+        LOG_ERROR("Load users failed: no database connection available");
+        return false;
+    }
+
+    // 查询用户表
+    if (mysql_query(mysql, "SELECT username, passwd FROM user")) {
+        LOG_ERROR("SELECT error: %s\n", mysql_error(mysql));
+        return false;
+    }
+
+    // 获取结果集
+    MYSQL_RES *result = mysql_store_result(mysql);
+    if (!result) {
+        LOG_ERROR("Store result error: %s", mysql_error(mysql));
+        return false;
+    }
+
+    // 将用户名和密码存入map
+    std::unique_lock<std::shared_timed_mutex> lock(m_rwlock);
+    while (MYSQL_ROW row = mysql_fetch_row(result)) {
+        m_users[row[0]] = row[1];
+    }
+    mysql_free_result(result);
+
+    LOG_INFO("MySQL user store: loaded %lu users", m_users.size());
+    return true;
+}
+
+bool MysqlUserStore::verify(const char *name, const char *password) {
+    std::shared_lock<std::shared_timed_mutex> lock(m_rwlock);
+    auto it = m_users.find(name);
+    return it != m_users.end() && it->second == password;
+}
+
+bool MysqlUserStore::exists(const char *name) {
+    std::shared_lock<std::shared_timed_mutex> lock(m_rwlock);
+    return m_users.count(name) != 0;
+}
+
+// 拼进SQL的字段只放行安全字符：用户名为字母、数字和 _-.@，密码为除引号、反斜杠外的可见ASCII
+// 异步路径在拿到连接之前拼SQL，没有连接句柄可以调用 mysql_real_escape_string
+static bool sql_safe(const char *s, bool is_name) {
+    if (!*s)
+        return false;
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (isalnum(c) || c == '_' || c == '-' || c == '.' || c == '@')
+            continue;
+        if (is_name || c < 0x21 || c > 0x7e || c == '\'' || c == '"' || c == '\\')
+            return false;
+    }
+    return true;
+}
+
+bool MysqlUserStore::build_insert_sql(const char *name, const char *password, char *buf, size_t len) {
+    if (!sql_safe(name, true) || !sql_safe(password, false)) {
+        LOG_WARN("Register rejected: username or password contains unsupported characters");
+        return false;
+    }
+    int n = snprintf(buf, len, "INSERT INTO user(username, passwd) VALUES('%s', '%s')",
+                     name, password);
+    return n > 0 && (size_t)n < len;
+}
+
+void MysqlUserStore::commit_cached(const char *name, const char *password) {
+    std::unique_lock<std::shared_timed_mutex> lock(m_rwlock);
+    m_users[name] = password;
+}
+
+template <typename Pool>
+bool MysqlUserStore::insert_user(Pool &pool, const char *name, const char *password) {
+    char sql_insert[256];
+    if (!build_insert_sql(name, password, sql_insert, sizeof(sql_insert))) {
+        return false;
+    }
+
+    // 按需从连接池获取连接，超时则注册失败，不长时间阻塞SubReactor
+    trace_span acquire(TRACE_DB_ACQUIRE);
+    BasicConnectionGuard<Pool> connGuard(pool);
+    acquire.end();
+    MYSQL *mysql = connGuard.get();
+    if (!mysql) {
+        LOG_WARN("Register failed: no database connection available");
+        return false;
+    }
+
+    int res = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_insert_mutex);
+        if (exists(name)) {
+            return false;
+        }
+        trace_span query(TRACE_DB_QUERY);
+        res = mysql_query(mysql, sql_insert);
+        query.end();
+        if (res == 0) {
+            commit_cached(name, password);
+        }
+    }
+
+    if (res != 0) {
+        LOG_ERROR("INSERT error: %s", mysql_error(mysql));
+        if (connection_pool::IsConnectionError(mysql))
+            connGuard.mark_broken();
+    }
+
+    return res == 0;
+}
+
+// 处理用户注册
+bool MysqlUserStore::add_user(const char *name, const char *password) {
+    // 用户已存在
+    if (exists(name)) {
+        return false;
+    }
+
+    local_connection_pool *local = local_connection_pool::current();
+    if (local) {
+        return insert_user(*local, name, password);
+    }
+    return insert_user(*m_connPool, name, password);
+}
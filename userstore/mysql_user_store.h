@@ -0,0 +1,38 @@
+#ifndef MYSQL_USER_STORE_H
+#define MYSQL_USER_STORE_H
+
+#include <string>
+#include <unordered_map>
+#include <shared_mutex>
+#include "user_store.h"
+#include "../mydb/sql_connection_pool.h"
+#include "../mydb/local_connection_pool.h"
+
+// MySQL后端：启动时把 user 表加载到内存，登录只查内存，注册写库后更新缓存
+// 注册优先使用当前SubReactor的私有连接切片，其他线程使用全局池
+class MysqlUserStore : public UserStore {
+public:
+    explicit MysqlUserStore(connection_pool *connPool);
+
+    bool init() override;
+    bool verify(const char *name, const char *password) override;
+    bool exists(const char *name) override;
+    bool add_user(const char *name, const char *password) override;
+
+    bool supports_async() const override { return true; }
+    bool build_insert_sql(const char *name, const char *password, char *buf, size_t len) override;
+    void commit_cached(const char *name, const char *password) override;
+
+    const char *backend_name() const override { return "mysql"; }
+
+private:
+    template <typename Pool>
+    bool insert_user(Pool &pool, const char *name, const char *password);
+
+    connection_pool *m_connPool;
+    std::unordered_map<std::string, std::string> m_users;  // 用户名 -> 密码
+    std::shared_timed_mutex m_rwlock;                      // 登录读、注册写
+    std::mutex m_insert_mutex;                             // 串行化注册，避免同名并发插入
+};
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef USER_STORE_H
+#define USER_STORE_H
+
+#include <stddef.h>
+
+// 用户存储抽象：登录校验与注册
+// 所有实现都需线程安全，多个SubReactor会并发调用
+class UserStore {
+public:
+    virtual ~UserStore() {}
+
+    // 启动时加载/恢复数据
+    virtual bool init() = 0;
+
+    // 校验用户名和密码
+    virtual bool verify(const char *name, const char *password) = 0;
+
+    // 用户是否已存在
+    virtual bool exists(const char *name) = 0;
+
+    // 同步注册，用户已存在或写入失败返回false
+    virtual bool add_user(const char *name, const char *password) = 0;
+
+    // ========== 异步注册支持（目前只有MySQL后端） ==========
+    // 是否可以由 async_sql_executor 执行注册语句
+    virtual bool supports_async() const { return false; }
+    // 生成注册语句，用户名或密码含不能安全拼进SQL的字符时返回 false
+    virtual bool build_insert_sql(const char *name, const char *password, char *buf, size_t len) {
+        return false;
+    }
+    // 异步语句执行成功后写入缓存
+    virtual void commit_cached(const char *name, const char *password) {}
+
+    virtual const char *backend_name() const = 0;
+};
+
+#endif
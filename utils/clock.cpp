@@ -0,0 +1,41 @@
+#include <stdio.h>
+#include "clock.h"
+
+thread_local LoopClock *LoopClock::t_current = nullptr;
+
+const char *WallClock::log_time(time_t sec, int *mday) {
+    static thread_local time_t t_sec = -1;
+    static thread_local int t_mday = 0;
+    static thread_local char t_buf[64];
+
+    if (sec != t_sec) {
+        struct tm tm;
+        localtime_r(&sec, &tm);
+        snprintf(t_buf, sizeof(t_buf), "%d-%02d-%02d %02d:%02d:%02d",
+                 tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+                 tm.tm_hour, tm.tm_min, tm.tm_sec);
+        t_mday = tm.tm_mday;
+        t_sec = sec;
+    }
+    if (mday) *mday = t_mday;
+    return t_buf;
+}
+
+const char *WallClock::http_date(time_t sec) {
+    static thread_local time_t t_sec = -1;
+    static thread_local char t_buf[64];
+
+    if (sec != t_sec) {
+        // 不用 strftime，避免受 locale 影响
+        static const char *const days[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+        static const char *const months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                             "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+        struct tm tm;
+        gmtime_r(&sec, &tm);
+        snprintf(t_buf, sizeof(t_buf), "%s, %02d %s %d %02d:%02d:%02d GMT",
+                 days[tm.tm_wday], tm.tm_mday, months[tm.tm_mon], tm.tm_year + 1900,
+                 tm.tm_hour, tm.tm_min, tm.tm_sec);
+        t_sec = sec;
+    }
+    return t_buf;
+}
@@ -0,0 +1,57 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+#include <time.h>
+
+// 精确单调时间（纳秒），走 vDSO；请求耗时、追踪时间基准等需要亚毫秒精度时使用
+inline uint64_t mono_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// 事件循环缓存时钟：每个 SubReactor 一个，epoll_wait 返回后刷新一次
+// 热路径（定时器、Date 头）只读成员，不再调用 time()/gettimeofday()
+// 读 *_COARSE 时钟走 vDSO，不陷入内核，精度为一个时钟节拍（通常 1~4ms），对秒级超时足够
+class LoopClock {
+public:
+    LoopClock() { refresh(); }
+
+    void refresh() {
+        clock_gettime(CLOCK_MONOTONIC_COARSE, &m_mono);
+        clock_gettime(CLOCK_REALTIME_COARSE, &m_wall);
+    }
+
+    // 定时器到期时取精确时间，避免粗粒度时钟落后于 timerfd 期限而空转
+    void refresh_precise() {
+        clock_gettime(CLOCK_MONOTONIC, &m_mono);
+    }
+
+    // 单调时间，定时器到期时间以它为基准，不受系统改时影响
+    time_t mono_sec() const { return m_mono.tv_sec; }
+    long long mono_ms() const { return (long long)m_mono.tv_sec * 1000 + m_mono.tv_nsec / 1000000; }
+    // 墙上时间，用于 Date 头
+    time_t wall_sec() const { return m_wall.tv_sec; }
+
+    // 当前线程所属事件循环的时钟（非 SubReactor 线程为nullptr）
+    static LoopClock *current() { return t_current; }
+    static void set_current(LoopClock *clock) { t_current = clock; }
+
+private:
+    struct timespec m_mono;
+    struct timespec m_wall;
+
+    static thread_local LoopClock *t_current;
+};
+
+// 按秒缓存的墙上时间字符串，每个线程各自缓存，同一秒内不再调用 localtime_r/gmtime_r
+class WallClock {
+public:
+    // 本地时间 "YYYY-MM-DD HH:MM:SS"，mday 可选返回当天日期
+    static const char *log_time(time_t sec, int *mday = nullptr);
+    // RFC 7231 IMF-fixdate，如 "Sun, 06 Nov 1994 08:49:37 GMT"
+    static const char *http_date(time_t sec);
+};
+
+#endif
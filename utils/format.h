@@ -0,0 +1,32 @@
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string>
+
+// printf 风格追加到 string 末尾，供 /metrics、/debug/trace 等文本输出拼接
+// 短行走栈上缓冲区，超长时直接格式化进 out，不截断
+__attribute__((format(printf, 2, 3)))
+inline void appendf(std::string &out, const char *format, ...) {
+    char buf[512];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (n <= 0)
+        return;
+    if (n < (int)sizeof(buf)) {
+        out.append(buf, n);
+        return;
+    }
+
+    size_t old = out.size();
+    out.resize(old + n + 1);
+    va_start(args, format);
+    vsnprintf(&out[old], n + 1, format, args);
+    va_end(args);
+    out.resize(old + n);
+}
+
+#endif
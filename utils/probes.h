@@ -0,0 +1,41 @@
+#ifndef PROBES_H
+#define PROBES_H
+
+// USDT 静态探针（provider 为 webserver），用 perf / bpftrace 在线挂载：
+//   bpftrace -e 'usdt:./server:webserver:write__complete { @us = hist(arg4); }'
+//   perf probe -x ./server sdt_webserver:read && perf record -e sdt_webserver:read -p <pid>
+// 未挂载时每个探针只是一条 nop，参数都是已在寄存器或栈上的标量，不额外计算
+// 系统有 <sys/sdt.h>（systemtap-sdt-dev）时自动启用，make USDT=0 或缺少头文件时探针为空
+//
+// 探针及参数：
+//   accept(fd, client_port)                          主 Reactor accept 之后
+//   dispatch(fd, reactor, connections)               分发到 SubReactor 队列
+//   read(reactor, fd, ret, buffered_bytes)           read_once 之后
+//   parse__complete(reactor, fd, result)             process 之后（PROCESS_RESULT）
+//   response__start(reactor, fd, status, bytes)      响应已构建，开始写
+//   write__complete(reactor, fd, status, bytes, latency_us)  响应写完
+//   timer__expire(reactor, fd, phase)                期限到期关闭连接前
+//   db__acquire(wait_us, ok, local)                  取数据库连接，local 为 1 表示来自私有切片
+//   db__release(broken, local)                       归还数据库连接
+
+#if !defined(WEBSERVER_NO_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define WEBSERVER_HAS_USDT 1
+#endif
+#endif
+
+#ifdef WEBSERVER_HAS_USDT
+#define WS_PROBE2(name, a1, a2)                 DTRACE_PROBE2(webserver, name, a1, a2)
+#define WS_PROBE3(name, a1, a2, a3)             DTRACE_PROBE3(webserver, name, a1, a2, a3)
+#define WS_PROBE4(name, a1, a2, a3, a4)         DTRACE_PROBE4(webserver, name, a1, a2, a3, a4)
+#define WS_PROBE5(name, a1, a2, a3, a4, a5)     DTRACE_PROBE5(webserver, name, a1, a2, a3, a4, a5)
+#else
+// 不求值，只让参数在未启用时也参与编译检查、不产生未使用变量告警
+#define WS_PROBE2(name, a1, a2)                 do { (void)sizeof(a1); (void)sizeof(a2); } while (0)
+#define WS_PROBE3(name, a1, a2, a3)             do { WS_PROBE2(name, a1, a2); (void)sizeof(a3); } while (0)
+#define WS_PROBE4(name, a1, a2, a3, a4)         do { WS_PROBE3(name, a1, a2, a3); (void)sizeof(a4); } while (0)
+#define WS_PROBE5(name, a1, a2, a3, a4, a5)     do { WS_PROBE4(name, a1, a2, a3, a4); (void)sizeof(a5); } while (0)
+#endif
+
+#endif
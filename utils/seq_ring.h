@@ -0,0 +1,30 @@
+#ifndef SEQ_RING_H
+#define SEQ_RING_H
+
+#include <stdint.h>
+#include <atomic>
+
+// 单写者覆盖环的槽序号协议（访问日志、请求阶段追踪共用）
+// 每个槽带一个 uint64_t seq，存"序号 + 1"，0 表示正在写或未使用
+//   写者：seq_slot_open 清零 → 写其余字段 → seq_slot_publish 写入新序号
+//   读者：seq_slot_ready 确认序号 → 复制字段 → seq_slot_unchanged 再确认，不一致说明复制期间被覆盖
+
+inline void seq_slot_open(uint64_t *seq) {
+    __atomic_store_n(seq, 0, __ATOMIC_RELAXED);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+inline void seq_slot_publish(uint64_t *seq, uint64_t value) {
+    __atomic_store_n(seq, value, __ATOMIC_RELEASE);
+}
+
+inline bool seq_slot_ready(const uint64_t *seq, uint64_t expect) {
+    return __atomic_load_n(seq, __ATOMIC_ACQUIRE) == expect;
+}
+
+inline bool seq_slot_unchanged(const uint64_t *seq, uint64_t expect) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return __atomic_load_n(seq, __ATOMIC_RELAXED) == expect;
+}
+
+#endif
@@ -8,7 +8,7 @@ int Utils::setnonblocking(int fd) {
     return old_option;
 }
 
-void Utils::addfd(int epollfd, int fd, bool one_shot, int trigger_mode) {
+void Utils::addfd(int epollfd, int fd, bool one_shot, int trigger_mode, bool set_nonblock) {
     epoll_event event;
     event.data.fd = fd;
 
@@ -20,7 +20,8 @@ void Utils::addfd(int epollfd, int fd, bool one_shot, int trigger_mode) {
     if (one_shot)
         event.events |= EPOLLONESHOT;
     epoll_ctl(epollfd, EPOLL_CTL_ADD, fd, &event);
-    setnonblocking(fd);
+    if (set_nonblock)
+        setnonblocking(fd);
 }
 
 void Utils::modfd(int epollfd, int fd, int ev, int trigger_mode) {
@@ -16,7 +16,8 @@ public:
 
     // 将内核事件表注册读事件，ET模式，选择开启EPOLLONESHOT
     // trigger_mode: 0=LT模式, 1=ET模式
-    static void addfd(int epollfd, int fd, bool one_shot, int trigger_mode);
+    // set_nonblock: fd 创建时已带 O_NONBLOCK（accept4、eventfd 等）时传 false，省掉两次 fcntl
+    static void addfd(int epollfd, int fd, bool one_shot, int trigger_mode, bool set_nonblock = true);
 
     // 修改文件描述符在epoll中的事件
     // trigger_mode: 0=LT模式, 1=ET模式
@@ -1,4 +1,6 @@
 #include "webserver.h"
+#include "./userstore/mysql_user_store.h"
+#include "./userstore/mmap_user_store.h"
 
 WebServer::WebServer(){
     // root文件夹路径，资源目录
@@ -11,14 +13,20 @@ WebServer::WebServer(){
 }
 
 WebServer::~WebServer(){
+    m_admin.stop();
     stop_sub_reactors();
     close(m_epollfd);
     close(m_listenfd);
 }
 
 void WebServer::init(int port , std::string user, std::string passWord, std::string databaseName,
-              int log_write , int opt_linger, int trigmode, int sql_num, int thread_num,
-              int close_log){
+              int log_write , int opt_linger, int trigmode, int sql_num, int sql_min_num,
+              int sql_timeout, int sql_slice, int sql_async, int user_store,
+              std::string user_db_path, int header_timeout, int body_timeout,
+              int write_timeout, int idle_timeout, int log_max_mb, int log_keep,
+              int log_overflow, int access_sample, int admin_port, std::string admin_addr,
+              int trace_sample, int defer_accept,
+              int thread_num, int close_log){
 
     m_port = port;
     m_user = user;
@@ -28,6 +36,24 @@ void WebServer::init(int port , std::string user, std::string passWord, std::str
     m_OPT_LINGER = opt_linger;
     m_TRIGMode = trigmode;
     m_sql_num = sql_num;
+    m_sql_min_num = sql_min_num;
+    m_sql_timeout = sql_timeout;
+    m_sql_slice = sql_slice;
+    m_sql_async = sql_async;
+    m_user_store_type = user_store;
+    m_user_db_path = user_db_path;
+    m_deadlines.header_ms = header_timeout;
+    m_deadlines.body_ms = body_timeout;
+    m_deadlines.write_ms = write_timeout;
+    m_deadlines.idle_ms = idle_timeout;
+    m_log_max_mb = log_max_mb;
+    m_log_keep = log_keep;
+    m_log_overflow = log_overflow;
+    m_access_sample = access_sample;
+    m_admin_port = admin_port;
+    m_admin_addr = admin_addr;
+    m_trace_sample = trace_sample;
+    m_defer_accept = defer_accept;
     m_thread_num = thread_num;
     m_close_log = close_log;
 }
@@ -60,10 +86,18 @@ void WebServer::trig_mode(){
 void WebServer::log_write(){
     // 不关闭日志则运行
     if (0 == m_close_log){
-        // 异步日志，创建日志队列 + 独立日志线程
-        // 五个参数，最后一个代表是否使用异步日志
+        // 按行数、大小、日期轮转，轮转后的文件由后台线程压缩并按数量清理
+        Log::get_instance()->set_rotation((long long)m_log_max_mb * 1024 * 1024, m_log_keep, true);
+        // 磁盘变慢时不让业务线程阻塞在日志上，丢弃数会写进日志
+        Log::get_instance()->set_overflow_policy(m_log_overflow);
+        // 异步日志，各线程写入自己的环 + 独立日志线程
+        // 2: 写线程格式化（调用点只记录参数），3: 写二进制日志，用 log_decode 转成文本
         if (1 == m_log_write)
             Log::get_instance()->init("./logs/ServerLog", m_close_log, 2000, 800000, 1);
+        else if (2 == m_log_write)
+            Log::get_instance()->init("./logs/ServerLog", m_close_log, 2000, 800000, 1, Log::DEFER_TEXT);
+        else if (3 == m_log_write)
+            Log::get_instance()->init("./logs/ServerLog", m_close_log, 2000, 800000, 1, Log::DEFER_BINARY);
         // 同步日志，每次调用 write_log() 直接写文件
         else
             Log::get_instance()->init("./logs/ServerLog", m_close_log, 2000, 800000, 0);
@@ -71,12 +105,43 @@ void WebServer::log_write(){
 }
 
 void WebServer::sql_pool(){
+    // 嵌入式存储不需要MySQL
+    if (1 == m_user_store_type) {
+        m_connPool = connection_pool::GetInstance();
+        m_sql_slice = 0;
+        m_sql_async = 0;
+        return;
+    }
+
+    // 私有切片长期占用连接，全局池上限至少要容纳所有切片再留出溢出余量
+    if (m_sql_slice > 0 && m_sql_num < m_sql_slice * m_thread_num + 1) {
+        LOG_WARN("sql_num %d too small for %d x %d private connections, raised to %d",
+                 m_sql_num, m_thread_num, m_sql_slice, m_sql_slice * m_thread_num + 1);
+        m_sql_num = m_sql_slice * m_thread_num + 1;
+    }
+
+    if (m_sql_async && !async_sql_executor::supported()) {
+        LOG_WARN("Non-blocking SQL requested but not compiled in (build with ASYNC_SQL=1), disabled");
+        m_sql_async = 0;
+    }
+
     // 初始化数据库连接池
     m_connPool = connection_pool::GetInstance();
-    m_connPool->init("localhost", m_user, m_passWord, m_databaseName, 3306, m_sql_num, m_close_log);
+    m_connPool->init("localhost", m_user, m_passWord, m_databaseName, 3306,
+                     m_sql_min_num, m_sql_num, m_sql_timeout, m_close_log);
+    metrics_registry::instance()->set_pool(m_connPool);
+}
+
+void WebServer::user_store(){
+    if (1 == m_user_store_type) {
+        m_user_store.reset(new MmapUserStore(m_user_db_path));
+    } else {
+        m_user_store.reset(new MysqlUserStore(m_connPool));
+    }
 
-    // 使用静态方法初始化数据库用户数据
-    http_conn::init_database_users(m_connPool);
+    if (!m_user_store->init()) {
+        LOG_ERROR("User store (%s) init failed", m_user_store->backend_name());
+    }
 }
 
 void WebServer::create_sub_reactors(){
@@ -85,12 +150,18 @@ void WebServer::create_sub_reactors(){
     for (int i = 0; i < m_thread_num; i++) {
         auto sub_reactor = std::make_unique<SubReactor>(
             i, m_root, m_CONNTrigmode, m_close_log,
-            m_user, m_passWord, m_databaseName, m_connPool
+            m_user, m_passWord, m_databaseName, m_connPool, m_sql_slice, m_sql_async != 0, m_user_store.get(),
+            m_deadlines, m_access_sample, m_trace_sample
         );
         m_sub_reactors.push_back(std::move(sub_reactor));
 
         LOG_INFO("Created SubReactor %d", i);
     }
+
+    m_dispatch_batches.resize(m_sub_reactors.size());
+    for (std::vector<accepted_connection>& batch : m_dispatch_batches) {
+        batch.reserve(ACCEPT_BATCH);
+    }
 }
 
 void WebServer::start_sub_reactors(){
@@ -139,6 +210,12 @@ void WebServer::eventListen(){
     // SO_REUSEADDR：重启服务器时，可以快速绑定同一个端口
     int flag = 1;
     setsockopt(m_listenfd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+
+    // TCP_DEFER_ACCEPT：握手完成后等到客户端数据到达才放进 accept 队列，
+    // 新连接交给 SubReactor 时第一个请求通常已经可读；只连不发的连接超过期限后照常交付，由请求头期限回收
+    if (m_defer_accept > 0) {
+        setsockopt(m_listenfd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &m_defer_accept, sizeof(m_defer_accept));
+    }
     
     // 将socket绑定到指定地址和端口 
     // 开始监听连接请求，队列长度为65535
@@ -156,64 +233,105 @@ void WebServer::eventListen(){
 
     // 忽略SIGPIPE信号，防止在写入已关闭的socket时服务器崩溃
     Utils::addsig(SIGPIPE, SIG_IGN);
+
+    // kill -USR1 <pid> 在 DEBUG 和启动时的日志级别之间切换
+    Utils::addsig(SIGUSR1, Log::toggle_debug);
+
+    // kill -USR2 <pid> 转储各 SubReactor 的飞行记录器，信号处理函数只通知 eventfd
+    m_flight_fd = flight_registry::instance()->install_signal();
+    if (m_flight_fd >= 0) {
+        Utils::addfd(m_epollfd, m_flight_fd, false, 0);
+    }
+}
+
+// 管理端口：抓取时只读各 SubReactor 的原子计数和追踪环，在管理线程上格式化
+void WebServer::admin_listen(){
+    if (m_admin_port <= 0) {
+        return;
+    }
+    m_admin.add_route("/metrics", "text/plain; version=0.0.4; charset=utf-8",
+                      [](const std::string &) { return metrics_registry::instance()->render(); });
+    // 请求阶段追踪（-z 开启）：Chrome/Perfetto trace JSON，?ms=N 只取最近 N 毫秒
+    m_admin.add_route("/debug/trace", "application/json",
+                      [](const std::string &query) { return trace_registry::instance()->render_chrome(query); });
+    if (!m_admin.start(m_admin_addr, m_admin_port)) {
+        LOG_ERROR("Admin port %s:%d unavailable, /metrics disabled", m_admin_addr.c_str(), m_admin_port);
+    }
 }
 
-// 连接分发：使用轮询算法将连接分配给SubReactor
-bool WebServer::dispatch_connection(int connfd, struct sockaddr_in client_address) {
+// 连接分发：轮询算法，一批连接先按 SubReactor 分组，每个 SubReactor 只加一次锁、最多唤醒一次
+bool WebServer::dispatch_connections(const accepted_connection* conns, int count) {
     if (m_sub_reactors.empty()) {
         LOG_ERROR("No SubReactors available!");
+        for (int i = 0; i < count; i++) {
+            close(conns[i].fd);
+        }
         return false;
     }
 
-    // 轮询选择SubReactor
-    int reactor_index = m_next_sub_reactor.fetch_add(1) % m_thread_num;
-
-    bool success = m_sub_reactors[reactor_index]->add_connection(connfd, client_address);
-
-    if (success) {
-        LOG_DEBUG("MainReactor: Dispatched connection %d to SubReactor %d", connfd, reactor_index);
-    } else {
-        LOG_WARN("MainReactor: Failed to dispatch connection %d to SubReactor %d", connfd, reactor_index);
+    unsigned int reactor_num = m_sub_reactors.size();
+    unsigned int first = (unsigned int)m_next_sub_reactor.fetch_add(count);
+    for (std::vector<accepted_connection>& batch : m_dispatch_batches) {
+        batch.clear();
+    }
+    for (int i = 0; i < count; i++) {
+        m_dispatch_batches[(first + i) % reactor_num].push_back(conns[i]);
     }
 
+    bool success = true;
+    for (unsigned int r = 0; r < reactor_num; r++) {
+        const std::vector<accepted_connection>& batch = m_dispatch_batches[r];
+        if (batch.empty()) {
+            continue;
+        }
+        int accepted = m_sub_reactors[r]->add_connections(batch.data(), batch.size());
+        if (accepted < (int)batch.size()) {
+            LOG_WARN("MainReactor: SubReactor %u rejected %d connections", r, (int)batch.size() - accepted);
+            success = false;
+        }
+    }
+    LOG_DEBUG("MainReactor: Dispatched %d connections", count);
     return success;
 }
 
 // 处理新客户端连接（主Reactor）
+// accept4 直接得到非阻塞、CLOEXEC 的 fd，每个连接省掉两次 fcntl；每取满 ACCEPT_BATCH 个整批分发
 bool WebServer::dealclientdata(){
-    struct sockaddr_in client_address;
-    socklen_t client_addrlenth = sizeof(client_address);
-
-    if (0 == m_LISTENTrigmode){  // LT模式
-        int connfd = accept(m_listenfd, (struct sockaddr *)&client_address, &client_addrlenth);
-        if (connfd < 0){
-            LOG_ERROR("LT accept error: %d", errno);
-            LOG_ERROR("accept error: errno=%d (%s)", errno, strerror(errno));
-            return false;
-        }
-
-        // 分发连接到SubReactor
-        return dispatch_connection(connfd, client_address);
-    }
-    else{  // ET模式
-        bool success = true;
-        while (1){
-            int connfd = accept(m_listenfd, (struct sockaddr *)&client_address, &client_addrlenth);
-            if (connfd < 0){
-                if (errno == EAGAIN || errno == EWOULDBLOCK)
-                    break;  // accept已经读取不到连接了，正常结束
-                LOG_ERROR("ET accept error: %d", errno);
-                LOG_ERROR("accept error: errno=%d (%s)", errno, strerror(errno));
-                return false;
+    bool success = true;
+    while (true) {
+        int count = 0;
+        bool drained = false;
+        while (count < ACCEPT_BATCH) {
+            accepted_connection& conn = m_accepted[count];
+            socklen_t client_addrlenth = sizeof(conn.address);
+            int connfd = accept4(m_listenfd, (struct sockaddr *)&conn.address, &client_addrlenth,
+                                 SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (connfd < 0) {
+                // 握手完成后被客户端重置的连接直接跳过
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    LOG_ERROR("accept error: errno=%d (%s)", errno, strerror(errno));
+                    success = false;
+                }
+                drained = true;
+                break;
             }
+            conn.fd = connfd;
+            WS_PROBE2(accept, connfd, ntohs(conn.address.sin_port));
+            count++;
+        }
 
-            // 分发连接到SubReactor
-            if (!dispatch_connection(connfd, client_address)) {
-                success = false;  // 记录失败，但继续处理其他连接
-            }
+        if (count > 0 && !dispatch_connections(m_accepted, count)) {
+            success = false;  // 记录失败，但继续处理其他连接
+        }
+        // LT 模式每次只取一批，没取完的下次 epoll_wait 还会报告；ET 模式必须取到 EAGAIN
+        if (drained || 0 == m_LISTENTrigmode) {
+            break;
         }
-        return success;
     }
+    return success;
 }
 
 
@@ -240,6 +358,10 @@ void WebServer::eventLoop(){
                 LOG_DEBUG("MainReactor: New connection event on listen fd");
                 dealclientdata();
             }
+            // SIGUSR2：转储飞行记录器
+            else if (sockfd == m_flight_fd) {
+                flight_registry::instance()->on_signal();
+            }
             // 处理监听socket异常
             else if (events[i].events & (EPOLLHUP | EPOLLERR | EPOLLRDHUP)) {
                 if (sockfd == m_listenfd) {
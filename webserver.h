@@ -3,6 +3,7 @@
 #include <sys/socket.h>
 #include <sys/timerfd.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <stdio.h>
 #include <unistd.h>
@@ -21,10 +22,13 @@
 #include "./timer/lst_timer.h"
 #include "./utils/utils.h"
 #include "./subreactor.h"
+#include "./userstore/user_store.h"
+#include "./metrics/admin_server.h"
 
 const int MAX_FD = 65536;           // 最大文件描述符
 const int MAX_EVENT_NUMBER = 10000; // 最大事件数
 const int TIMESLOT = 1;             // 最小超时单位
+const int ACCEPT_BATCH = 64;        // 每轮 accept4 最多取的连接数
 
 class WebServer{
 public:
@@ -33,10 +37,16 @@ public:
 
     // 初始化
     void init(int port, std::string user, std::string passWord, std::string databaseName,
-              int log_write, int opt_linger, int trigmode, int sql_num, int thread_num,
-              int close_log);
+              int log_write, int opt_linger, int trigmode, int sql_num, int sql_min_num,
+              int sql_timeout, int sql_slice, int sql_async, int user_store,
+              std::string user_db_path, int header_timeout, int body_timeout,
+              int write_timeout, int idle_timeout, int log_max_mb, int log_keep,
+              int log_overflow, int access_sample, int admin_port, std::string admin_addr,
+              int trace_sample, int defer_accept,
+              int thread_num, int close_log);
     void log_write();
     void sql_pool();
+    void user_store();
     void trig_mode();
 
     // 创建并启动SubReactors
@@ -46,11 +56,14 @@ public:
     void start_sub_reactors();
     void stop_sub_reactors();
 
+    // 管理端口（/metrics），独立线程
+    void admin_listen();
+
     // 主Reactor：处理新客户端连接
     bool dealclientdata();
 
-    // 连接分发
-    bool dispatch_connection(int connfd, struct sockaddr_in client_address);
+    // 连接分发：一批连接按轮询分到各 SubReactor，每个 SubReactor 只加一次锁
+    bool dispatch_connections(const accepted_connection* conns, int count);
 
     // epoll注册创建以及事件循环（主Reactor）
     void eventListen();
@@ -62,6 +75,14 @@ public:
     char *m_root;
     int m_log_write;    // 日志方法 0为同步，1为异步
     int m_close_log;    // 是否关闭日志
+    int m_log_max_mb;   // 单个日志文件最大MB
+    int m_log_keep;     // 保留的日志归档数
+    int m_log_overflow; // 异步日志环满策略
+    int m_access_sample;    // 访问日志采样间隔，0 关闭
+    int m_admin_port;       // 管理端口，0 不开启
+    std::string m_admin_addr;   // 管理端口监听地址
+    int m_trace_sample;     // 请求阶段追踪采样间隔，0 关闭
+    int m_defer_accept;     // TCP_DEFER_ACCEPT 秒数，0 关闭
 
     int m_epollfd;  // 主Reactor的epollfd
 
@@ -70,7 +91,19 @@ public:
     std::string m_user;          // 登陆数据库用户名
     std::string m_passWord;      // 登陆数据库密码
     std::string m_databaseName;  // 使用数据库名
-    int m_sql_num;
+    int m_sql_num;               // 连接池最大连接数
+    int m_sql_min_num;           // 连接池最小连接数
+    int m_sql_timeout;           // 获取连接超时（毫秒）
+    int m_sql_slice;             // 每个SubReactor私有连接数
+    int m_sql_async;             // 是否使用非阻塞数据库查询
+
+    // 用户存储
+    int m_user_store_type;                   // 0: MySQL, 1: 嵌入式mmap存储
+    std::string m_user_db_path;              // 嵌入式存储文件路径
+    std::unique_ptr<UserStore> m_user_store;
+
+    // 连接期限
+    conn_deadlines m_deadlines;              // 请求头/请求体/写停滞/空闲期限（毫秒）
 
     // SubReactor相关
     int m_thread_num;            // SubReactor线程数
@@ -80,13 +113,19 @@ public:
     epoll_event events[MAX_EVENT_NUMBER];
 
     int m_listenfd;
+    int m_flight_fd = -1;   // SIGUSR2 通知的 eventfd
     int m_OPT_LINGER;
     int m_TRIGMode;
     int m_LISTENTrigmode;
     int m_CONNTrigmode;
 
+    // 管理端口
+    admin_server m_admin;
+
     // 连接分发 - 轮询算法
     std::atomic<int> m_next_sub_reactor{0};
+    accepted_connection m_accepted[ACCEPT_BATCH];                      // 本轮 accept4 得到的连接
+    std::vector<std::vector<accepted_connection>> m_dispatch_batches;  // 按 SubReactor 分好的本轮连接
 };
 
 #endif